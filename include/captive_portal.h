@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Captive portal for clients of the soft AP. A DNS responder answers every
+// A query with the AP address, so any hostname a phone looks up lands on the
+// web server, and the OS connectivity probes below get an immediate redirect
+// that makes the phone open its sign-in sheet on the setup page.
+
+#define CAPTIVE_DNS_PORT 53
+#define CAPTIVE_DNS_TTL 60         // seconds; short so answers do not outlive the AP
+#define CAPTIVE_DNS_MAX_PACKET 512 // classic DNS over UDP limit
+#define CAPTIVE_DNS_STACK_SIZE 3072
+
+// Paths fetched by Android, iOS/macOS, Windows and Firefox to detect a
+// captive portal. Register each with handleCaptiveProbe().
+extern const char* const CAPTIVE_PROBE_PATHS[];
+extern const uint8_t CAPTIVE_PROBE_COUNT;
+
+// Starts the responder task, bound to the AP address only so the station
+// side of the network never sees it.
+void beginCaptiveDns(IPAddress apIp, BaseType_t core);
+
+// Rewrites the query in `packet` into its answer in place and returns the
+// answer length, or 0 if the packet should be dropped. Uses no heap and no
+// state, so it can also be fed from a host test.
+size_t buildDnsAnswer(uint8_t* packet, size_t length, size_t capacity, uint32_t ip);
+
+struct CaptiveStats {
+  uint32_t dnsQueries;  // answered
+  uint32_t dnsDropped;  // malformed or not a query
+  uint32_t probes;      // connectivity checks redirected
+};
+
+void countCaptiveProbe();
+CaptiveStats captiveStats();
@@ -0,0 +1,80 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Named colours resolved through a perfect hash built at compile time: one
+// hash, one table probe and one string compare per lookup, no chains of
+// strcmp(). Values match FastLED's CRGB::HTMLColorCode.
+
+struct NamedColor {
+  const char* name;
+  uint32_t rgb;
+};
+
+namespace color_names {
+
+constexpr NamedColor COLORS[] = {
+  {"black", 0x000000},  {"white", 0xFFFFFF},   {"red", 0xFF0000},     {"green", 0x008000},
+  {"blue", 0x0000FF},   {"yellow", 0xFFFF00},  {"purple", 0x800080},  {"cyan", 0x00FFFF},
+  {"magenta", 0xFF00FF}, {"orange", 0xFFA500}, {"pink", 0xFFC0CB},    {"lime", 0x00FF00},
+  {"teal", 0x008080},   {"navy", 0x000080},    {"violet", 0xEE82EE},  {"gold", 0xFFD700},
+  {"amber", 0xFFBF00},  {"warmwhite", 0xFFE4B5}, {"coral", 0xFF7F50}, {"indigo", 0x4B0082},
+};
+constexpr size_t COUNT = sizeof(COLORS) / sizeof(COLORS[0]);
+constexpr size_t TABLE_SIZE = 64; // power of two, comfortably above COUNT
+
+// FNV-1a over lowercased characters, mixed with a seed
+constexpr uint32_t hash(const char* text, size_t length, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i = 0; i < length; i++) {
+    char c = text[i];
+    if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+    h = (h ^ (uint8_t)c) * 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+constexpr size_t length(const char* text) {
+  size_t n = 0;
+  while (text[n] != '\0') n++;
+  return n;
+}
+
+constexpr bool collisionFree(uint32_t seed) {
+  bool used[TABLE_SIZE] = {};
+  for (size_t i = 0; i < COUNT; i++) {
+    size_t slot = hash(COLORS[i].name, length(COLORS[i].name), seed) & (TABLE_SIZE - 1);
+    if (used[slot]) return false;
+    used[slot] = true;
+  }
+  return true;
+}
+
+constexpr uint32_t findSeed() {
+  uint32_t seed = 0;
+  while (!collisionFree(seed)) seed++;
+  return seed;
+}
+
+constexpr uint32_t SEED = findSeed();
+
+struct Table {
+  int8_t slots[TABLE_SIZE]; // index into COLORS, -1 when empty
+};
+
+constexpr Table buildTable() {
+  Table table = {};
+  for (size_t i = 0; i < TABLE_SIZE; i++) table.slots[i] = -1;
+  for (size_t i = 0; i < COUNT; i++) {
+    table.slots[hash(COLORS[i].name, length(COLORS[i].name), SEED) & (TABLE_SIZE - 1)] = (int8_t)i;
+  }
+  return table;
+}
+
+constexpr Table TABLE = buildTable();
+
+} // namespace color_names
+
+// Looks up a colour by name (case-insensitive, not NUL-terminated).
+// Returns false if the name is unknown.
+bool lookupColorName(const char* name, size_t length, uint32_t& rgb);
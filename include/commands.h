@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include "spsc_queue.h"
+#include "led_store.h"
+#include "state_api.h"
+#include "led_timer.h"
+#include "fleet_sync.h"
+
+// Commands posted by the HTTP task and executed by the control loop, which
+// owns the LED, the WiFi connection and NVS. Handlers never touch those
+// directly, so a slow FastLED.show() or flash write cannot hold up a response.
+
+#define COMMAND_QUEUE_SIZE 16
+
+enum class CommandType : uint8_t {
+  SetColor,
+  SetBrightness,
+  ToggleLed,
+  Connect,
+  ClearCredentials,
+  StartScan,
+  ForgetNetwork,
+  SetEffect,
+  SetStrip,
+  ApplyState,
+  AddTimer,
+  DeleteTimer,
+  SetFleet,
+};
+
+struct Command {
+  CommandType type;
+  union {
+    uint32_t color;      // SetColor, 0xRRGGBB
+    uint8_t brightness;  // SetBrightness
+    struct {
+      uint8_t id;        // LedEffect
+      uint16_t period;   // ms per cycle
+    } effect;            // SetEffect
+    struct {
+      char ssid[33];
+      char password[65];
+    } wifi;              // Connect, ForgetNetwork (ssid only)
+    StripConfig strip;   // SetStrip
+    LedUpdate state;     // ApplyState
+    TimerRule timer;     // AddTimer
+    uint8_t timerId;     // DeleteTimer
+    struct {
+      FleetRole role;
+      uint8_t group;
+    } fleet;             // SetFleet
+  };
+};
+
+extern SpscQueue<Command, COMMAND_QUEUE_SIZE> commandQueue;
@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+
+// Server-Sent Events for live UI updates. Browsers subscribe with
+// EventSource on http://<device>:EVENT_STREAM_PORT/events; the stream has its
+// own listener because the HTTP server runs handlers one at a time on its
+// task, and a response that never ends would stall every other request.
+// Must only be used from the control loop.
+
+#define EVENT_STREAM_PORT 81
+#define MAX_EVENT_SUBSCRIBERS 4
+#define EVENT_KEEPALIVE_INTERVAL 15000 // ms between comment pings
+#define EVENT_HANDSHAKE_TIMEOUT 2000   // ms to receive the request headers
+
+void beginEventStream();
+// Accepts and handshakes subscribers, pings idle ones and drops dead ones.
+// Returns true if a new subscriber joined, so the caller can send a snapshot.
+bool serviceEventStream();
+// Sends `data` (a single-line JSON object) as event `name` to every subscriber.
+void broadcastEvent(const char* name, const char* data);
+uint8_t eventSubscriberCount();
@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+#include "state_api.h"
+
+// Synchronised LED changes across several devices on the same network.
+//
+// A node in the Leader role sends every LED change made through its web UI
+// or API to a UDP multicast group instead of applying it right away. The
+// packet carries an apply time FLEET_APPLY_DELAY ms ahead on the leader's
+// millis() clock; the leader and every follower in the target group apply
+// it when their own clock reaches that point.
+//
+// Followers map the leader's clock onto their own from the send timestamps
+// in its packets (a sync beacon every FLEET_BEACON_INTERVAL, plus every
+// state packet). Each sample is local receive time minus leader send time,
+// i.e. clock offset plus network delay, so the smallest of the last
+// FLEET_OFFSET_WINDOW samples is the best estimate. Followers end up late by
+// that smallest delay, which on a LAN is a millisecond or two.
+//
+// Multicast over WiFi is not acknowledged, so state packets go out
+// FLEET_REPEATS times and receivers drop the copies by sequence number.
+// Sequence numbers and send times restart when a node reboots, so packets
+// also carry a random session id drawn at boot; a new session from the same
+// sender is treated like a new leader.
+
+#define FLEET_PORT 4210
+#define FLEET_MULTICAST_GROUP "239.255.70.1"
+#define FLEET_APPLY_DELAY 60        // ms, covers the repeats and a slow receiver
+#define FLEET_BEACON_INTERVAL 1000  // ms
+#define FLEET_OFFSET_WINDOW 8       // samples
+#define FLEET_REPEATS 3
+#define FLEET_PENDING 8             // received updates waiting for their time
+#define FLEET_ALL_GROUPS 0          // target group that every node accepts
+#define FLEET_STACK_SIZE 3072
+
+enum class FleetRole : uint8_t {
+  Off,
+  Follower,
+  Leader,
+};
+
+// Wire format, little-endian, 34 bytes
+enum class FleetPacketType : uint8_t {
+  Beacon,
+  State,
+};
+
+struct __attribute__((packed)) FleetPacket {
+  uint8_t magic[2];  // 'G', 'F'
+  uint8_t version;
+  FleetPacketType type;
+  uint32_t sender;   // low bits of the sender's MAC
+  uint32_t session;  // random, per boot of the sender
+  uint32_t seq;      // per sender, state packets only
+  uint32_t sentAt;   // sender millis()
+  uint32_t applyAt;  // sender millis() at which to apply
+  uint8_t group;
+  uint8_t fields;    // StateField bits
+  uint8_t on;
+  uint8_t brightness;
+  uint8_t color[3];  // r, g, b
+  uint8_t effect;    // LedEffect
+  uint16_t period;
+};
+
+// Loads the role and group from NVS and starts the receiver task on `core`.
+void beginFleetSync(BaseType_t core);
+void setFleetConfig(FleetRole role, uint8_t group); // control loop; saved to NVS
+FleetRole fleetRole();
+uint8_t fleetGroup();
+
+// Control loop: (re)joins the group when the station gets an address and
+// sends the leader's beacons.
+void serviceFleetSync();
+// Leader: sends `update` to the group and queues it locally for the same
+// moment. Returns false (and sends nothing) when not leading or offline, in
+// which case the caller applies the update itself.
+bool sendFleetUpdate(const LedUpdate& update);
+// Control loop: the next queued update whose time has come, if any.
+bool takeFleetUpdate(LedUpdate& update);
+// ms until the next queued update or beacon, at most `limit`.
+uint32_t fleetWaitTime(uint32_t limit);
+
+void encodeFleetState(FleetPacket& packet, const LedUpdate& update);
+void decodeFleetState(const FleetPacket& packet, LedUpdate& update);
+bool validFleetPacket(const uint8_t* data, size_t length);
+
+struct FleetStats {
+  uint32_t leader;         // sender currently followed, 0 if none
+  int32_t offset;          // local millis() minus leader millis(), incl. delay
+  bool synced;
+  uint32_t packetsSent;
+  uint32_t packetsReceived;
+  uint32_t duplicates;
+  uint32_t updatesApplied;
+  uint32_t lateUpdates;    // arrived after their apply time
+  uint32_t dropped;        // pending queue full
+};
+
+FleetStats fleetStats();
+const char* fleetRoleName(FleetRole role);
+bool parseFleetRole(const char* name, FleetRole& role);
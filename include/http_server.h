@@ -0,0 +1,132 @@
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <esp_http_server.h>
+#include <functional>
+
+// HTTP/1.1 server on esp_http_server with the subset of the Arduino WebServer
+// API the handlers use, so they did not have to change.
+//
+// esp_http_server keeps up to HTTP_MAX_CONNECTIONS sockets open with
+// keep-alive and waits on all of them in select() from its own task, so a
+// browser's parallel connections and the POST/303/GET form flow reuse
+// sockets instead of reconnecting, and an idle or half-sent connection no
+// longer holds up everyone else. Requests are still handled one at a time
+// on that task, which is what lets the request accessors below work on a
+// single current request without locking. All buffers (per-socket header
+// buffers in esp_http_server, the body/argument buffers and the route table
+// here) are allocated once at begin().
+
+#define HTTP_MAX_CONNECTIONS 6    // leave sockets for SSE, DNS and the station side
+#define HTTP_MAX_ROUTES 48        // setup() registers 41; test_bench_routes checks there is room
+#define HTTP_MAX_BODY 2048        // larger bodies get 413
+#define HTTP_MAX_QUERY 256
+#define HTTP_MAX_ARGS 24
+#define HTTP_MAX_RESPONSE_HEADERS 8
+#define HTTP_HEADER_POOL_SIZE 384 // storage for sendHeader() names and values
+#define HTTP_RECV_TIMEOUT 5       // s, per socket read
+#define HTTP_SEND_TIMEOUT 5       // s, per socket write
+
+typedef httpd_method_t HTTPMethod;
+#ifndef HTTP_ANY
+#define HTTP_ANY ((HTTPMethod)255)
+#endif
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+class HttpServer {
+public:
+  typedef std::function<void()> Handler;
+
+  explicit HttpServer(uint16_t port) : _port(port) {}
+
+  // Registration, before begin(). With `streamBody` the body is left on the
+  // socket for the handler to read with receive() instead of being buffered.
+  // HEAD requests run the GET route with the body counted instead of sent,
+  // and get its status, headers and Content-Length. Pass head = false for a
+  // GET route with side effects; HEAD on it gets 405. Returns false, and
+  // logs it, when the route table is full.
+  bool on(const char* path, HTTPMethod method, Handler handler, bool streamBody = false, bool head = true);
+  void onNotFound(Handler handler) { _notFound = handler; }
+  uint8_t routeCount() const { return _routeCount; }
+  // Starts the server task on `core` with `stackSize` bytes of stack.
+  bool begin(BaseType_t core, uint32_t stackSize);
+
+  // Current request, valid inside a handler. arg() covers the query string
+  // and urlencoded form bodies; arg("plain") is the raw body.
+  String arg(const char* name) const;
+  bool hasArg(const char* name) const;
+  // The raw body in the server's buffer, NUL-terminated, without the copy
+  // arg("plain") makes. Empty for form bodies, which are split into args.
+  const char* body() const { return _formBody ? "" : _body; }
+  size_t bodyLength() const { return _formBody ? 0 : _bodyLength; }
+  String header(const char* name) const;
+  String hostHeader() const { return header("Host"); }
+  IPAddress localIP() const; // address the client connected to
+  size_t contentLength() const;
+  // Streaming routes: the next part of the body, up to `length` bytes.
+  // Returns 0 at the end of the body and -1 if the client went away.
+  int receive(uint8_t* buffer, size_t length);
+
+  // Response
+  // `first` is accepted for WebServer compatibility; order is not kept
+  void sendHeader(const char* name, const String& value, bool first = false);
+  // Only CONTENT_LENGTH_UNKNOWN matters: the next send() starts a chunked body
+  void setContentLength(size_t length) { _streamNext = length == CONTENT_LENGTH_UNKNOWN; }
+  void send(int code, const char* contentType = nullptr, const String& content = String());
+  void send_P(int code, const char* contentType, const char* data, size_t length);
+  // Body chunks after send() with CONTENT_LENGTH_UNKNOWN; a zero length ends it.
+  void sendContent(const char* data, size_t length);
+  // Body bytes handed to the socket for this request, by all of the above
+  size_t bytesSent() const { return _bytesSent; }
+
+private:
+  struct Route {
+    const char* path;
+    HTTPMethod method;
+    Handler handler;
+    bool streamBody;
+    bool head;
+  };
+  struct Arg {
+    const char* name;
+    const char* value;
+  };
+
+  static esp_err_t dispatch(httpd_req_t* req);
+  esp_err_t handle(httpd_req_t* req);
+  bool readBody();
+  void parseArgs(char* text);
+  void startResponse(int code, const char* contentType);
+  void sendHeadResponse();
+  const char* keep(const char* text);
+
+  uint16_t _port;
+  httpd_handle_t _handle = nullptr;
+  Route _routes[HTTP_MAX_ROUTES];
+  uint8_t _routeCount = 0;
+  Handler _notFound;
+
+  // Per-request state, reset by handle()
+  httpd_req_t* _req = nullptr;
+  char _query[HTTP_MAX_QUERY];
+  char _body[HTTP_MAX_BODY + 1];
+  size_t _bodyLength = 0;
+  size_t _received = 0; // body bytes taken off the socket
+  Arg _args[HTTP_MAX_ARGS];
+  uint8_t _argCount = 0;
+  char _headerPool[HTTP_HEADER_POOL_SIZE];
+  size_t _headerPoolUsed = 0;
+  size_t _bytesSent = 0;
+  // HEAD: the response is collected here and sent by sendHeadResponse()
+  bool _head = false;
+  const char* _headStatus = nullptr;
+  const char* _headType = nullptr;
+  Arg _headHeaders[HTTP_MAX_RESPONSE_HEADERS];
+  uint8_t _headHeaderCount = 0;
+  size_t _headLength = 0;
+  bool _formBody = false;
+  bool _streamNext = false;
+  bool _streaming = false;
+  bool _responded = false;
+  bool _failed = false;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal non-allocating JSON tokenizer (jsmn style). The input is split into
+// a caller-provided token array in document order; tokens point into the
+// input by offset, nothing is copied. Objects list their keys as String
+// tokens, and each key's value follows as its single child.
+
+enum class JsonType : uint8_t {
+  Object,
+  Array,
+  String,     // start/end exclude the quotes, escapes are left in place
+  Primitive,  // number, true, false or null
+};
+
+struct JsonToken {
+  JsonType type;
+  uint16_t start;
+  uint16_t end;    // one past the last character
+  uint16_t size;   // children: keys of an object, items of an array, 1 for a key
+  int16_t parent;
+};
+
+#define JSON_ERROR_NO_TOKENS -1  // token array too small
+#define JSON_ERROR_INVALID   -2  // malformed input
+#define JSON_ERROR_PARTIAL   -3  // input ends inside a value
+
+// Returns the number of tokens used, or one of the JSON_ERROR_* codes.
+int jsonParse(const char* json, size_t length, JsonToken* tokens, uint16_t maxTokens);
+
+// Index of the token following `index` and everything nested in it.
+int jsonSkip(const JsonToken* tokens, int count, int index);
+// Index of the value stored under `key` in the object at `object`, or -1.
+int jsonObjectGet(const char* json, const JsonToken* tokens, int count, int object, const char* key);
+
+bool jsonEquals(const char* json, const JsonToken& token, const char* text);
+bool jsonToBool(const char* json, const JsonToken& token, bool& value);
+// Integers only; fails on fractions, exponents and overflow.
+bool jsonToLong(const char* json, const JsonToken& token, long& value);
+// Copies a String token with escapes resolved. Fails if it does not fit.
+bool jsonToString(const char* json, const JsonToken& token, char* out, size_t size);
@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include <FastLED.h>
+
+// Non-blocking LED effects. serviceLedEffects() is called from every loop()
+// pass; it renders at most one frame per LED_FRAME_INTERVAL into the output
+// back buffer, also while the previous frame is still being sent, and
+// presents it once the strip is free if it differs from what the strip
+// already shows. All animation math is 8-bit integer (lib8tion), no floats
+// or delays.
+//
+// The strip is split into segments, each with its own colour and effect.
+// By default a single segment covers the whole strip.
+
+#define LED_FRAME_INTERVAL 20   // ms, 50 fps
+#define LED_FADE_TIME 400       // ms for colour and on/off cross-fades
+#define LED_SELF_TEST_STEP 200  // ms per colour of the boot self-test
+#define MAX_LED_SEGMENTS 8
+
+enum class LedEffect : uint8_t {
+  Solid,
+  Breathe,
+  Rainbow,
+  Blink,
+};
+
+// Plain data so it can be stored in NVS and passed through the command queue
+struct LedSegment {
+  uint16_t start;
+  uint16_t length;
+  uint32_t color;   // 0xRRGGBB
+  LedEffect effect;
+  uint16_t period;  // ms per effect cycle
+};
+
+struct LedFrameStats {
+  uint32_t frames;       // frames computed
+  uint32_t shows;        // frames handed to the strip
+  uint32_t lateFrames;   // frames that started more than one interval late
+  uint32_t lastMicros;   // CPU time to render the last frame
+  uint32_t avgMicros;    // running average
+  uint32_t maxMicros;
+};
+
+void beginLedEffects();
+// Plays red/green/blue once before showing the target state.
+void startLedSelfTest();
+// On/off and brightness for the whole strip; the colour is applied to every
+// segment. Colour and on/off changes fade.
+void setLedTarget(bool on, const CRGB& color, uint8_t brightness);
+// Applies an effect to every segment.
+void setLedEffect(LedEffect effect, uint16_t periodMs);
+// Replaces the segment table. Segments are clipped to the strip length.
+void setLedSegments(const LedSegment* segments, uint8_t count);
+void serviceLedEffects();
+// Renders the next frame even if nothing changed, for when something else
+// has drawn on the strip (a pixel stream).
+void redrawLedEffects();
+// Milliseconds until serviceLedEffects() next has a frame to render, or
+// `limit` when the strip is static (no effect, fade or self test running).
+uint32_t ledEffectsWaitTime(uint32_t limit);
+
+LedEffect currentLedEffect();
+uint16_t currentLedEffectPeriod();
+uint8_t ledSegmentCount();
+LedSegment ledSegment(uint8_t index);
+LedFrameStats ledFrameStats();
+
+const char* ledEffectName(LedEffect effect);
+// Returns false if `name` is not a known effect.
+bool parseLedEffect(const char* name, LedEffect& effect);
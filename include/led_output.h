@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include <FastLED.h>
+
+// Double-buffered strip output. Frames are rendered into the back buffer and
+// handed to an output task that runs FastLED.show(), so the RMT transfer of
+// one frame (30 us per pixel) overlaps with computing the next one instead
+// of stalling loop(). Only the output task ever calls FastLED.show().
+
+#define LED_PIN     48
+#define LED_TYPE    WS2812B
+#define COLOR_ORDER GRB
+#define MAX_LEDS    1000
+
+#define LED_OUTPUT_CORE 1       // same core as loop(); the task sleeps while RMT sends
+#define LED_OUTPUT_PRIORITY 2   // above loop() so a handed-off frame starts at once
+
+struct LedOutputStats {
+  uint32_t frames;          // frames sent to the strip
+  uint32_t lastShowMicros;  // wall time of the last FastLED.show()
+  uint32_t avgShowMicros;
+  uint32_t maxShowMicros;
+  uint16_t fps;             // frames sent during the last full second
+};
+
+void beginLedOutput(uint16_t count);
+uint16_t ledCount();
+// Changes the strip length. Blanks the old length first so no stale pixels
+// stay lit past the new end. Blocks until the strip is idle.
+void resizeLedOutput(uint16_t count);
+
+// True when the previous frame has been sent and a new one can be presented.
+bool ledOutputReady();
+// Buffer to render the next frame into; valid until presentLedFrame().
+CRGB* ledBackBuffer();
+// Hands the back buffer to the output task. Requires ledOutputReady().
+void presentLedFrame(uint8_t brightness);
+
+LedOutputStats ledOutputStats();
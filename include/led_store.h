@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+#include "led_effects.h"
+
+// Write-behind persistence for the LED state. Updates only mark the state
+// dirty in RAM; pollLedStore() writes it as a single NVS blob once it has
+// been left alone for LED_SAVE_QUIET_PERIOD, and skips the write entirely if
+// flash already holds the same value. Call flushLedStore() before a restart.
+
+#define LED_SAVE_QUIET_PERIOD 2000 // ms without changes before writing
+
+struct LedSettings {
+  bool on;
+  uint8_t brightness;
+  uint8_t r, g, b;
+};
+
+struct LedStoreStats {
+  uint32_t updates;         // updateLedSettings() calls
+  uint32_t writesPerformed; // blobs actually written to flash
+  uint32_t writesAvoided;   // updates that never reached flash
+};
+
+// Reads the stored settings (migrating the old per-field keys if needed).
+// Returns false and leaves `settings` untouched when nothing is stored.
+bool loadLedSettings(LedSettings& settings);
+void updateLedSettings(const LedSettings& settings);
+void pollLedStore();
+void flushLedStore();
+LedStoreStats ledStoreStats();
+
+// Strip length and segment table. Changed rarely, so written immediately.
+struct StripConfig {
+  uint16_t pixelCount;
+  uint8_t segmentCount;
+  LedSegment segments[MAX_LED_SEGMENTS];
+};
+
+// Returns false when no strip configuration has been saved.
+bool loadStripConfig(StripConfig& config);
+void saveStripConfig(const StripConfig& config);
@@ -0,0 +1,70 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+#include "state_api.h"
+
+// Scheduled LED actions. Rules are kept as one binary table in NVS and, at
+// run time, in a min-heap ordered by next fire time: serviceLedTimer() only
+// looks at the top of the heap, so a loop() pass costs O(1) however many
+// rules there are, and O(log n) when one fires.
+//
+// Rules are one-shot (a Unix time) or recurring (a minute of the day on a set
+// of weekdays). Times are local, in the zone configTime() sets. When the
+// clock is set (NTP sync, a jump either way) the heap is rebuilt from the
+// new time; one-shot rules whose time has passed are dropped unfired.
+
+// The table is one 512-byte NVS blob that /timer lists in full. The heap
+// positions are uint8_t, which caps the limit at 127; thousands of rules
+// would need wider ids and a paged table.
+#define MAX_TIMER_RULES 32
+
+enum class TimerAction : uint8_t {
+  On,
+  Off,
+  Color,
+  Brightness,
+  Effect,
+  Sunrise, // switch on at the lowest brightness and ramp up to `level`
+};
+
+// Plain data: stored in NVS as is and passed through the command queue
+struct TimerRule {
+  uint32_t at;       // one-shot: Unix time to fire; 0 for recurring rules
+  uint32_t color;    // Color, Sunrise: 0xRRGGBB
+  uint16_t minute;   // recurring: minute of the day, 0-1439
+  uint16_t duration; // Sunrise: ramp length (s); Effect: period (ms)
+  uint8_t days;      // recurring: weekday mask, bit 0 = Sunday
+  TimerAction action;
+  uint8_t level;     // Brightness, Sunrise: brightness; Effect: LedEffect
+  uint8_t id;        // assigned by addTimerRule()
+};
+
+#define TIMER_DAYS_ALL 0x7F
+#define TIMER_DAYS_WEEKDAYS 0x3E
+
+// The clock rules are evaluated against. Defaults to time(); replace it to
+// drive the scheduler from a simulated clock.
+typedef time_t (*TimerClock)();
+void setTimerClock(TimerClock clock);
+// False until NTP (or whatever the clock is) has set a plausible time.
+bool timerClockValid();
+time_t timerNow();
+
+// Loads the rules. `apply` carries out fired actions on the control loop.
+void beginLedTimer(void (*apply)(const LedUpdate& update));
+// Returns the id given to the rule, or 0 when the table is full.
+uint8_t addTimerRule(const TimerRule& rule);
+bool deleteTimerRule(uint8_t id);
+// Fires due rules and steps a running sunrise ramp. Call from loop().
+void serviceLedTimer();
+// Stops a sunrise ramp, e.g. when the LED is changed by hand.
+void cancelTimerFade();
+
+uint8_t timerRuleCount();
+TimerRule timerRule(uint8_t index);
+// Next time `rule` fires strictly after `after`, or 0 if it never will.
+time_t nextFireTime(const TimerRule& rule, time_t after);
+
+const char* timerActionName(TimerAction action);
+// Returns false if `name` is not a known action.
+bool parseTimerAction(const char* name, TimerAction& action);
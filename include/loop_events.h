@@ -0,0 +1,35 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+// Wake-up sources for the control loop. loop() blocks in waitForLoopEvents()
+// until one of these is set or its next deadline comes up, so the CPU idles
+// (and can clock down) instead of spinning.
+#define LOOP_EVENT_COMMAND BIT0 // the HTTP task queued a command
+#define LOOP_EVENT_WIFI BIT1    // station or AP state changed
+#define LOOP_EVENT_SCAN BIT2    // an async scan finished
+#define LOOP_EVENT_BUTTON BIT3  // boot button edge
+#define LOOP_EVENT_FLEET BIT4   // a fleet update was received
+#define LOOP_EVENT_STREAM BIT5  // a pixel stream started, ended or finished a frame
+#define LOOP_EVENT_ALL (LOOP_EVENT_COMMAND | LOOP_EVENT_WIFI | LOOP_EVENT_SCAN | LOOP_EVENT_BUTTON | LOOP_EVENT_FLEET | \
+                        LOOP_EVENT_STREAM)
+
+// Longest loop() sleeps with nothing due, which bounds how late polled work
+// (SSE accepts, store flushes, timeouts) can run.
+#define LOOP_IDLE_WAIT 100 // ms
+
+// Light sleep stops the CPU between events. Off by default: it only takes
+// effect with the soft AP down, and the LED output must not be mid-frame.
+#ifndef LIGHT_SLEEP_ENABLED
+#define LIGHT_SLEEP_ENABLED 0
+#endif
+
+void beginLoopEvents();
+void notifyLoop(EventBits_t events);
+void notifyLoopFromISR(EventBits_t events);
+// Returns the events that arrived (clearing them), or 0 on timeout.
+EventBits_t waitForLoopEvents(uint32_t timeoutMs);
+
+// Dynamic frequency scaling through esp_pm, plus light sleep when enabled.
+void beginPowerManagement();
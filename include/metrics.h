@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include "http_server.h"
+#include "response_writer.h"
+
+// Fixed-size counters for /metrics (Prometheus text format). Recording is a
+// few integer adds into preallocated slots; nothing here allocates.
+//
+// Route metrics are written and read on the HTTP task only. Loop and WiFi
+// counters are written by the control loop and read by the HTTP task as
+// plain aligned 32-bit words, so a scrape may see them mid-update by one
+// count, which is fine for monitoring. The 64-bit loop time sum is the
+// exception and is updated and read under a lock.
+
+#define MAX_ROUTE_METRICS HTTP_MAX_ROUTES // a slot for every route the server can hold
+#define LATENCY_BUCKETS 10 // plus +Inf
+#define LOOP_BUCKETS 10    // plus +Inf
+
+// Claims a slot for a route. Returns -1, and logs it, when all slots are
+// taken; requests on such routes are counted under path="other".
+int registerRouteMetrics(const char* path, HTTPMethod method);
+// Wrap a handler call: start = beginRequestMetrics(); handler();
+// endRequestMetrics(slot, start, server.bytesSent());
+unsigned long beginRequestMetrics();
+void endRequestMetrics(int slot, unsigned long start, size_t responseBytes);
+
+void recordLoopTime(unsigned long micros);
+void countWifiConnect(bool ok);
+
+// Writes every metric in Prometheus text exposition format.
+void writeMetrics(ResponseWriter& out);
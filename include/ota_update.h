@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+// Firmware updates over the network, written straight into the inactive OTA
+// partition OTA_CHUNK_SIZE bytes at a time while the SHA-256 of the image is
+// computed on the way; the image is never held in RAM.
+//
+// Push:   POST /update?size=<bytes>&sha256=<hex> with the image as the body
+// Pull:   POST /update/pull with url=http://... and sha256=<hex>
+// Status: GET /update
+//
+// A transfer that stops short (dropped connection, or a client sending the
+// image in parts) is paused, not discarded: POST again with offset=<written>
+// and the rest of the image. Paused transfers live in RAM only and are
+// dropped after OTA_RESUME_TIMEOUT or a reboot. The pull mode resumes by
+// itself with HTTP Range requests.
+//
+// A new image boots in the pending-verify state. It is confirmed once it has
+// been healthy (see serviceOta) for OTA_HEALTHY_UPTIME; if that has not
+// happened by OTA_CONFIRM_TIMEOUT, or it crashes first, the bootloader goes
+// back to the previous image.
+//
+// Both POSTs need "Authorization: Bearer <OTA_TOKEN>", checked before any
+// byte reaches flash. The token is set at build time
+// (build_flags = -DOTA_TOKEN=\"...\"); without one, updates are refused.
+
+#define OTA_CHUNK_SIZE 4096
+#define OTA_RESUME_TIMEOUT 300000  // ms a paused transfer is kept
+#define OTA_RESTART_DELAY 1000     // ms between a finished update and the reboot
+#define OTA_HEALTHY_UPTIME 30000   // ms of health before a new image is confirmed
+#define OTA_CONFIRM_TIMEOUT 180000 // ms after boot before an unconfirmed image rolls back
+#define OTA_PULL_RETRIES 5
+#define OTA_PULL_RETRY_DELAY 2000  // ms
+#define OTA_PULL_TIMEOUT 10000     // ms without data before a pull attempt gives up
+#define OTA_PULL_STACK_SIZE 6144
+#define OTA_MAX_URL 192
+
+#ifndef OTA_TOKEN
+#define OTA_TOKEN "" // empty: network updates disabled
+#endif
+
+enum class OtaState : uint8_t {
+  Idle,
+  Receiving,
+  Paused,
+  Done,    // verified and set to boot, restart pending
+  Failed,
+};
+
+enum class OtaResult : uint8_t {
+  Complete,
+  Paused,
+  Failed,
+  Rejected, // not started: bad arguments or another transfer running
+};
+
+// Next part of the image into `buffer`; <= 0 ends this part of the transfer.
+typedef std::function<int(uint8_t* buffer, size_t length)> OtaReader;
+
+struct OtaStatus {
+  OtaState state;
+  bool pull;
+  uint32_t size;
+  uint32_t written;
+  uint32_t transferMillis; // time spent receiving, for throughput
+  uint32_t heapBefore;     // free heap when the transfer started
+  uint32_t heapMin;        // lowest free heap seen during it
+  bool pendingVerify;      // this image has not been confirmed yet
+  char error[48];
+};
+
+// Checks whether the running image still needs confirming.
+void beginOta();
+// False when no OTA_TOKEN is built in.
+bool otaEnabled();
+// Checks an Authorization header against OTA_TOKEN, in constant time.
+bool otaAuthorized(const char* authorization);
+// Feeds one request's worth of image. offset 0 starts a new transfer; any
+// other offset must continue a paused one with the same size and hash.
+OtaResult receiveOtaImage(uint32_t size, const char* sha256, uint32_t offset, OtaReader read, const char*& error);
+// Downloads the image in a background task.
+bool startOtaPull(const char* url, const char* sha256, const char*& error);
+// Control loop: expires paused transfers and confirms or rolls back a new
+// image. `healthy` is the caller's verdict on the running firmware. Returns
+// true when a finished update is waiting for the reboot.
+bool serviceOta(bool healthy);
+
+OtaStatus otaStatus();
+const char* otaRunningPartition();
+const char* otaStateName(OtaState state);
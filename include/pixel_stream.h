@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+
+// Live pixel data over UDP from show controllers and tools such as xLights,
+// LedFx or Hyperion, in either of two standard protocols:
+//
+// DDP     port 4048. Data offset and length are in bytes of RGB data; a
+//         packet with the PUSH flag ends the frame.
+// E1.31   port 5568, unicast or multicast (sACN). PIXEL_STREAM_UNIVERSE
+//         carries the first 170 pixels, the next universe the next 170 and
+//         so on. The frame ends with an E1.31 sync packet when the sender
+//         uses one (its universe's multicast group is joined as well),
+//         otherwise, or while sync packets stop arriving, with the strip's
+//         last universe.
+//
+// The receiver task copies each payload straight from the network stack
+// into the LED back buffer (recvmsg() with the pixel array as the target),
+// so there is no packet buffer or intermediate frame. The control loop
+// takes the strip over from the effects engine on the first packet, hands
+// each complete frame to the output task once, and gives the strip back
+// (fading to the saved state) after PIXEL_STREAM_TIMEOUT without data.
+//
+// Only one frame can be waiting for the strip at a time. Packets that
+// arrive while it waits would overwrite it, so they are dropped, and the
+// frame they belong to is skipped rather than shown torn.
+
+#define PIXEL_STREAM_DDP_PORT 4048
+#define PIXEL_STREAM_E131_PORT 5568
+#define PIXEL_STREAM_UNIVERSE 1          // E1.31 universe of the first pixel
+#define PIXEL_STREAM_UNIVERSE_PIXELS 170 // 510 of the 512 DMX channels
+#define PIXEL_STREAM_TIMEOUT 2500        // ms without packets before the effects come back
+#define PIXEL_STREAM_STACK_SIZE 3072
+
+enum class PixelProtocol : uint8_t {
+  None,
+  Ddp,
+  E131,
+};
+
+struct PixelStreamStats {
+  bool active;               // the stream owns the strip
+  PixelProtocol protocol;    // of the last accepted packet
+  uint32_t packets;          // written into the frame
+  uint32_t packetsDropped;   // malformed, unsupported, or arrived while a frame waited
+  uint32_t packetsLost;      // gaps in the senders' sequence numbers
+  uint32_t frames;           // shown
+  uint32_t framesDropped;    // skipped because packets of theirs were dropped
+  uint32_t sessions;         // times the stream took over the strip
+};
+
+// Opens both ports and starts the receiver task on `core`.
+void beginPixelStream(BaseType_t core);
+// Control loop: takes over the strip, presents finished frames at
+// `brightness` and hands the strip back on timeout. Returns true while the
+// stream owns the strip, in which case the effects engine must not render.
+bool servicePixelStream(uint8_t brightness);
+// ms until servicePixelStream() has something to do, at most `limit`.
+uint32_t pixelStreamWaitTime(uint32_t limit);
+
+PixelStreamStats pixelStreamStats();
+const char* pixelProtocolName(PixelProtocol protocol);
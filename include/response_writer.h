@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include "http_server.h"
+
+// Size of the staging buffer each ResponseWriter carries on the stack.
+#ifndef RESPONSE_BUFFER_SIZE
+#define RESPONSE_BUFFER_SIZE 512
+#endif
+
+// Streams a response through HttpServer in chunks instead of building it in a
+// String. Everything written is staged in a fixed buffer and sent with
+// sendContent() whenever it fills up, so a handler never holds more than
+// RESPONSE_BUFFER_SIZE bytes of the page regardless of its length.
+//
+//   ResponseWriter out(server);
+//   out.begin(200, "text/html");
+//   out.print("<p>Brightness: "); out.print(ledBrightness); out.print("</p>");
+//   out.end();
+class ResponseWriter {
+public:
+  explicit ResponseWriter(HttpServer& server) : _server(server), _length(0) {}
+  ~ResponseWriter() { end(); }
+
+  // Sends the status line and headers; the body follows chunked.
+  void begin(int code, const char* contentType);
+  // Flushes what is left and terminates the chunked body. Safe to call twice.
+  void end();
+
+  void write(const char* data, size_t length);
+  void print(const char* text) { write(text, strlen(text)); }
+  void print(const String& text) { write(text.c_str(), text.length()); }
+  void print(char c) { write(&c, 1); }
+  void print(long value);
+  void print(unsigned long value);
+  void print(int value) { print((long)value); }
+  void print(unsigned int value) { print((unsigned long)value); }
+  void print(const IPAddress& ip);
+
+  // Text escaped for use inside HTML element content or quoted attributes.
+  void printEscaped(const char* text);
+  void printEscaped(const String& text) { printEscaped(text.c_str()); }
+  // Text as a quoted JSON string literal.
+  void printJsonString(const char* text);
+
+private:
+  void flush();
+
+  HttpServer& _server;
+  bool _open = false;
+  char _buffer[RESPONSE_BUFFER_SIZE];
+  size_t _length;
+};
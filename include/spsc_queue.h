@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+
+// Lock-free single-producer/single-consumer ring buffer. push() must only be
+// called from one task and pop() from one other task; the two may run on
+// different cores. N must be a power of two.
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+  // Returns false (and drops the item) when the queue is full.
+  bool push(const T& item) {
+    size_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == N) return false;
+    _items[head & (N - 1)] = item;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false when the queue is empty.
+  bool pop(T& item) {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if (_head.load(std::memory_order_acquire) == tail) return false;
+    item = _items[tail & (N - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+  }
+
+private:
+  T _items[N];
+  std::atomic<size_t> _head{0};
+  std::atomic<size_t> _tail{0};
+};
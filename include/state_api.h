@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+#include "led_effects.h"
+
+// Translation of PUT /api/state bodies into LED/WiFi updates. The body is
+// either one state object or an array of them, applied in order:
+//
+//   {"on":true, "color":"#ff8800", "brightness":128, "effect":"breathe", "period":3000}
+//   {"color":"teal"}  {"color":[255,0,64]}  {"color":{"h":200,"s":100,"v":80}}
+//   {"wifi":{"ssid":"MyNet","password":"secret"}}
+//
+// Parsing uses a fixed token array on the stack and never allocates.
+
+#define MAX_STATE_UPDATES 8
+#define MAX_STATE_TOKENS 96
+
+enum StateField : uint8_t {
+  STATE_ON = 1 << 0,
+  STATE_COLOR = 1 << 1,
+  STATE_BRIGHTNESS = 1 << 2,
+  STATE_EFFECT = 1 << 3,
+  STATE_PERIOD = 1 << 4,
+};
+
+// The LED part of one update; `fields` says which members are set.
+struct LedUpdate {
+  uint8_t fields;
+  bool on;
+  uint32_t color;  // 0xRRGGBB
+  uint8_t brightness;
+  LedEffect effect;
+  uint16_t period;
+};
+
+struct StateUpdate {
+  LedUpdate led;
+  bool connect;  // wifi credentials present
+  char ssid[33];
+  char password[65];
+};
+
+// Fills `updates` and returns how many there are, or -1 with `error` set.
+int parseStateUpdates(const char* json, size_t length, StateUpdate* updates, int maxUpdates, const char*& error);
+
+// "#rrggbb", "rrggbb", "#rgb" or a colour name.
+bool parseColorText(const char* text, size_t length, uint32_t& rgb);
@@ -0,0 +1,16 @@
+// Generated by tools/embed_assets.py from web/ - do not edit.
+#pragma once
+#include <Arduino.h>
+
+// Page shell: PAGE_HEAD + title + PAGE_NAV + content + PAGE_FOOT
+extern const char PAGE_HEAD[] PROGMEM;
+extern const char PAGE_NAV[] PROGMEM;
+extern const char PAGE_FOOT[] PROGMEM;
+
+// Pre-gzipped static assets
+#define APP_CSS_ETAG "\"2342302c9c06\""
+#define APP_JS_ETAG "\"090b573db44b\""
+extern const uint8_t APP_CSS_GZ[] PROGMEM;
+extern const size_t APP_CSS_GZ_LEN;
+extern const uint8_t APP_JS_GZ[] PROGMEM;
+extern const size_t APP_JS_GZ_LEN;
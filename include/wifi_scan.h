@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+
+// Asynchronous WiFi scan with a small result cache. A scan is started with
+// requestWifiScan() and collected by pollWifiScan() from loop(), so nothing
+// ever waits on WiFi.scanNetworks(). Both must be called from the control
+// loop; the cache accessors are safe from the HTTP task.
+
+#define SCAN_CACHE_SIZE 20          // Strongest networks kept per scan
+#define SCAN_CACHE_TTL 30000        // Results younger than this are served as-is (ms)
+#define SCAN_MAX_DURATION 15000     // Give up on a scan that never completes (ms)
+
+struct ScanResult {
+  char ssid[33];
+  uint8_t bssid[6]; // strongest AP seen for this SSID
+  int8_t rssi;
+  uint8_t channel;
+  bool open;
+};
+
+// Returns false if no scan is running afterwards (it could not be started).
+bool requestWifiScan();
+void pollWifiScan();
+
+bool isWifiScanning();
+// True once a scan has completed and is no older than SCAN_CACHE_TTL.
+bool isScanCacheFresh();
+// Milliseconds since the cached results were taken.
+unsigned long scanCacheAge();
+// Incremented each time a scan finishes, whether or not it succeeded, so a caller can wait for a scan it
+// requested rather than reuse older results.
+uint32_t scanGeneration();
+
+// Cached results, deduplicated by SSID and sorted by RSSI (strongest first).
+size_t scanResultCount();
+// Returns a copy so the entry cannot change underneath the caller.
+ScanResult scanResult(size_t index);
@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+
+// Known networks, kept as one NVS blob. Written from the control loop only;
+// the accessors return copies and are safe from the HTTP task.
+//
+// Adding or forgetting a network is written at once. Connect results only
+// update the history in RAM, which ranking reads; pollWifiStore() writes it
+// once no result has come in for WIFI_SAVE_QUIET_PERIOD, so a round of
+// failed candidates costs one write. Call flushWifiStore() before a restart.
+#define MAX_KNOWN_NETWORKS 6
+#define WIFI_SAVE_QUIET_PERIOD 5000 // ms without connect results before writing
+
+struct KnownNetwork {
+  char ssid[33];
+  char password[65];
+  uint16_t lastBoot;      // boot number of the last successful connect, 0 if never
+  uint16_t successes;
+  uint16_t failures;
+  uint16_t avgConnectMillis;
+};
+
+// A known network seen in the latest scan, best first
+struct WifiCandidate {
+  uint8_t network; // index into the known networks
+  int8_t rssi;
+  uint8_t channel;
+  uint8_t bssid[6];
+};
+
+uint8_t knownNetworkCount();
+KnownNetwork knownNetwork(uint8_t index);
+// Returns -1 when `ssid` is not known.
+int findKnownNetwork(const char* ssid);
+// The network connected to most recently, or -1 if none has ever connected.
+int preferredKnownNetwork();
+// Adds the network or updates its password. When the store is full the
+// network with the worst history makes room.
+void rememberNetwork(const char* ssid, const char* password);
+// Also drops the cached link (see WifiLink) if it belongs to `ssid`.
+bool forgetNetwork(const char* ssid);
+void forgetAllNetworks();
+void noteConnectResult(const char* ssid, bool ok, unsigned long elapsed);
+void pollWifiStore();
+void flushWifiStore();
+// Ranks the known networks found in the scan cache by signal strength,
+// adjusted by their connect history. Returns the number of candidates.
+uint8_t rankKnownNetworks(WifiCandidate* candidates, uint8_t maxCandidates);
+
+// Link details of the last successful station connection, used to skip the
+// channel scan and DHCP handshake on the next connect. Only valid for the
+// SSID it was saved with.
+struct WifiLink {
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t ip, gateway, subnet, dns1, dns2;
+};
+
+// Returns false when nothing is cached for `ssid`.
+bool loadWifiLink(const char* ssid, WifiLink& link);
+// Skips the flash write when the cached link is unchanged.
+void saveWifiLink(const char* ssid, const WifiLink& link);
+void clearWifiLink();
+
+// Time-to-connect history, kept in flash so boots can be compared.
+#define CONNECT_LOG_SIZE 8
+
+struct ConnectRecord {
+  uint16_t boot;   // boot number the attempt was made in
+  uint16_t millis; // time to connect, or to give up
+  uint8_t fast;    // started from the cached link
+  uint8_t ok;
+};
+
+// Loads the known networks (moving over the single network saved by older
+// firmware) and the connect log, and advances and saves the boot number.
+// Call once in setup().
+void beginWifiStore();
+void recordConnect(unsigned long elapsed, bool fast, bool ok);
+uint8_t connectLogCount();
+ConnectRecord connectLogEntry(uint8_t index); // 0 is the newest
+
+// Blobs written to flash since boot (networks, link cache and connect log).
+uint32_t wifiStoreWrites();
@@ -0,0 +1,143 @@
+#include "captive_portal.h"
+#include <lwip/sockets.h>
+
+const char* const CAPTIVE_PROBE_PATHS[] = {
+  "/generate_204",               // Android
+  "/gen_204",                    // Android, Chrome OS
+  "/hotspot-detect.html",        // iOS, macOS
+  "/library/test/success.html",  // older iOS
+  "/connecttest.txt",            // Windows 10+
+  "/ncsi.txt",                   // older Windows
+  "/redirect",                   // Windows, after a failed connecttest
+  "/success.txt",                // Firefox
+  "/canonical.html",             // Firefox, Ubuntu
+};
+const uint8_t CAPTIVE_PROBE_COUNT = sizeof(CAPTIVE_PROBE_PATHS) / sizeof(CAPTIVE_PROBE_PATHS[0]);
+
+// Header layout (RFC 1035 4.1.1)
+static const size_t DNS_HEADER_SIZE = 12;
+static const uint8_t FLAG_QR = 0x80;
+static const uint8_t FLAG_AA = 0x04;
+static const uint8_t FLAG_RD = 0x01;
+static const uint8_t FLAG_RA = 0x80;
+static const uint8_t OPCODE_MASK = 0x78;
+static const uint8_t RCODE_NOTIMP = 4;
+static const uint16_t TYPE_A = 1;
+static const uint16_t TYPE_ANY = 255;
+static const uint16_t CLASS_IN = 1;
+
+static uint32_t dnsQueries = 0;
+static uint32_t dnsDropped = 0;
+static uint32_t probes = 0;
+
+static uint16_t read16(const uint8_t* p) {
+  return (p[0] << 8) | p[1];
+}
+
+static void write16(uint8_t* p, uint16_t value) {
+  p[0] = value >> 8;
+  p[1] = value & 0xFF;
+}
+
+size_t buildDnsAnswer(uint8_t* packet, size_t length, size_t capacity, uint32_t ip) {
+  if (length < DNS_HEADER_SIZE || (packet[2] & FLAG_QR)) return 0;
+
+  packet[2] = FLAG_QR | FLAG_AA | (packet[2] & (OPCODE_MASK | FLAG_RD));
+  packet[3] = FLAG_RA;
+  // Authority and additional records (EDNS OPT etc.) are dropped from the answer
+  write16(packet + 6, 0);
+  write16(packet + 8, 0);
+  write16(packet + 10, 0);
+
+  if ((packet[2] & OPCODE_MASK) != 0 || read16(packet + 4) != 1) {
+    // Only standard queries with one question; anything else gets an empty
+    // "not implemented" so the client does not wait for a timeout
+    packet[3] |= RCODE_NOTIMP;
+    write16(packet + 4, 0);
+    return DNS_HEADER_SIZE;
+  }
+
+  // Walk the question name; compression pointers are not valid in a query
+  size_t pos = DNS_HEADER_SIZE;
+  while (pos < length && packet[pos] != 0) {
+    if (packet[pos] & 0xC0) return 0;
+    pos += packet[pos] + 1;
+  }
+  pos++; // root label
+  if (pos + 4 > length) return 0;
+  uint16_t type = read16(packet + pos);
+  uint16_t klass = read16(packet + pos + 2);
+  pos += 4;
+
+  // Other types (AAAA, HTTPS, ...) get NOERROR with no records, which makes
+  // clients fall back to the A record straight away
+  if (klass != CLASS_IN || (type != TYPE_A && type != TYPE_ANY)) return pos;
+
+  if (pos + 16 > capacity) return 0;
+  uint8_t* answer = packet + pos;
+  write16(answer, 0xC000 | DNS_HEADER_SIZE); // name: pointer to the question
+  write16(answer + 2, TYPE_A);
+  write16(answer + 4, CLASS_IN);
+  write16(answer + 6, 0);
+  write16(answer + 8, CAPTIVE_DNS_TTL);
+  write16(answer + 10, 4);
+  // `ip` is in network order already (IPAddress stores it that way)
+  memcpy(answer + 12, &ip, 4);
+  write16(packet + 6, 1);
+  return pos + 16;
+}
+
+static void captiveDnsTask(void* parameter) {
+  uint32_t ip = (uint32_t)(uintptr_t)parameter;
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    Serial.println("Captive DNS: no socket");
+    vTaskDelete(nullptr);
+    return;
+  }
+  struct sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(CAPTIVE_DNS_PORT);
+  local.sin_addr.s_addr = ip;
+  if (bind(sock, (struct sockaddr*)&local, sizeof(local)) < 0) {
+    Serial.println("Captive DNS: bind failed");
+    close(sock);
+    vTaskDelete(nullptr);
+    return;
+  }
+
+  static uint8_t packet[CAPTIVE_DNS_MAX_PACKET];
+  for (;;) {
+    struct sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    // Blocks until a query arrives; the task costs nothing while idle
+    int received = recvfrom(sock, packet, sizeof(packet), 0, (struct sockaddr*)&from, &fromLength);
+    if (received <= 0) continue;
+    size_t length = buildDnsAnswer(packet, received, sizeof(packet), ip);
+    if (length == 0) {
+      dnsDropped++;
+      continue;
+    }
+    sendto(sock, packet, length, 0, (struct sockaddr*)&from, fromLength);
+    dnsQueries++;
+  }
+}
+
+void beginCaptiveDns(IPAddress apIp, BaseType_t core) {
+  xTaskCreatePinnedToCore(captiveDnsTask, "dns", CAPTIVE_DNS_STACK_SIZE,
+                          (void*)(uintptr_t)(uint32_t)apIp, 1, nullptr, core);
+}
+
+void countCaptiveProbe() {
+  probes++;
+}
+
+// Single-writer counters read as whole words, so no lock is needed
+CaptiveStats captiveStats() {
+  CaptiveStats stats;
+  stats.dnsQueries = dnsQueries;
+  stats.dnsDropped = dnsDropped;
+  stats.probes = probes;
+  return stats;
+}
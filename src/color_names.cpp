@@ -0,0 +1,13 @@
+#include "color_names.h"
+#include <string.h>
+#include <strings.h>
+
+bool lookupColorName(const char* name, size_t length, uint32_t& rgb) {
+  using namespace color_names;
+  int8_t index = TABLE.slots[hash(name, length, SEED) & (TABLE_SIZE - 1)];
+  if (index < 0) return false;
+  const NamedColor& color = COLORS[index];
+  if (strlen(color.name) != length || strncasecmp(color.name, name, length) != 0) return false;
+  rgb = color.rgb;
+  return true;
+}
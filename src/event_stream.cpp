@@ -0,0 +1,143 @@
+#include "event_stream.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+struct Subscriber {
+  WiFiClient client;
+  bool streaming;          // handshake done
+  char request[12];        // start of the request line
+  uint8_t requestLength;
+  uint8_t headerEndMatch;  // progress through "\r\n\r\n"
+  unsigned long since;     // accept time, then time of the last write
+};
+
+static WiFiServer eventServer(EVENT_STREAM_PORT);
+static Subscriber subscribers[MAX_EVENT_SUBSCRIBERS];
+
+static const char STREAM_HEADERS[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: keep-alive\r\n\r\n"
+    "retry: 3000\n\n";
+
+static void drop(Subscriber& subscriber) {
+  subscriber.client.stop();
+  subscriber.streaming = false;
+}
+
+// WiFiClient::write() waits for room in the socket's send buffer, so a
+// stalled client would block the control loop for the whole send timeout.
+// This writes only what fits right now; a full buffer or a partial write
+// means the client is gone or too slow, and either way it is dropped.
+static bool writeNow(WiFiClient& client, const char* text, size_t length) {
+  return ::send(client.fd(), text, length, MSG_DONTWAIT) == (ssize_t)length;
+}
+
+static bool send(Subscriber& subscriber, const char* text, size_t length) {
+  if (!writeNow(subscriber.client, text, length)) {
+    drop(subscriber);
+    return false;
+  }
+  subscriber.since = millis();
+  return true;
+}
+
+void beginEventStream() {
+  eventServer.begin();
+  eventServer.setNoDelay(true);
+}
+
+static void acceptSubscribers() {
+  WiFiClient client = eventServer.available();
+  while (client) {
+    Subscriber* slot = nullptr;
+    for (Subscriber& subscriber : subscribers) {
+      if (!subscriber.client.connected()) {
+        slot = &subscriber;
+        break;
+      }
+    }
+    if (slot == nullptr) {
+      static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+      writeNow(client, busy, sizeof(busy) - 1);
+      client.stop();
+    } else {
+      slot->client = client;
+      slot->streaming = false;
+      slot->requestLength = 0;
+      slot->headerEndMatch = 0;
+      slot->since = millis();
+    }
+    client = eventServer.available();
+  }
+}
+
+// Reads request headers as they arrive. Returns true once the handshake for
+// a valid "GET /events" request has been sent.
+static bool handshake(Subscriber& subscriber) {
+  static const char HEADER_END[] = "\r\n\r\n";
+  while (subscriber.client.available()) {
+    char c = subscriber.client.read();
+    if (subscriber.requestLength < sizeof(subscriber.request)) {
+      subscriber.request[subscriber.requestLength++] = c;
+    }
+    if (c == HEADER_END[subscriber.headerEndMatch]) subscriber.headerEndMatch++;
+    else subscriber.headerEndMatch = (c == '\r') ? 1 : 0;
+
+    if (subscriber.headerEndMatch == 4) {
+      if (subscriber.requestLength < 11 || memcmp(subscriber.request, "GET /events", 11) != 0) {
+        static const char notFound[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        send(subscriber, notFound, sizeof(notFound) - 1);
+        drop(subscriber);
+        return false;
+      }
+      if (!send(subscriber, STREAM_HEADERS, sizeof(STREAM_HEADERS) - 1)) return false;
+      subscriber.streaming = true;
+      return true;
+    }
+  }
+  if (millis() - subscriber.since > EVENT_HANDSHAKE_TIMEOUT) drop(subscriber);
+  return false;
+}
+
+bool serviceEventStream() {
+  acceptSubscribers();
+
+  bool joined = false;
+  unsigned long now = millis();
+  for (Subscriber& subscriber : subscribers) {
+    if (!subscriber.client.connected()) {
+      subscriber.streaming = false;
+      continue;
+    }
+    if (!subscriber.streaming) {
+      joined |= handshake(subscriber);
+    } else if (now - subscriber.since > EVENT_KEEPALIVE_INTERVAL) {
+      send(subscriber, ":\n\n", 3);
+    }
+  }
+  return joined;
+}
+
+void broadcastEvent(const char* name, const char* data) {
+  // One write per subscriber so each event goes out as a single segment
+  char message[256];
+  int length = snprintf(message, sizeof(message), "event: %s\ndata: %s\n\n", name, data);
+  if (length < 0 || length >= (int)sizeof(message)) {
+    Serial.printf("Event '%s' too long, not sent.\n", name);
+    return;
+  }
+  for (Subscriber& subscriber : subscribers) {
+    if (subscriber.streaming) send(subscriber, message, length);
+  }
+}
+
+uint8_t eventSubscriberCount() {
+  uint8_t count = 0;
+  for (const Subscriber& subscriber : subscribers) {
+    if (subscriber.streaming) count++;
+  }
+  return count;
+}
@@ -0,0 +1,349 @@
+#include "fleet_sync.h"
+#include <WiFi.h>
+#include <Preferences.h>
+#include <lwip/sockets.h>
+#include "loop_events.h"
+
+static const char* FLEET_NAMESPACE = "fleet";
+static const char* CONFIG_BLOB_KEY = "config";
+static const uint8_t CONFIG_BLOB_VERSION = 1;
+static const uint8_t PACKET_VERSION = 2; // 2: session id
+static const uint8_t KNOWN_FIELDS = STATE_ON | STATE_COLOR | STATE_BRIGHTNESS | STATE_EFFECT | STATE_PERIOD;
+// Followers count as synced while beacons keep arriving
+static const unsigned long SYNC_TIMEOUT = 5 * FLEET_BEACON_INTERVAL;
+// Above the loop and HTTP tasks so receive timestamps are taken promptly
+static const UBaseType_t RECEIVE_PRIORITY = 6;
+
+static const char* const ROLE_NAMES[] = {"off", "follower", "leader"};
+
+struct ConfigBlob {
+  uint8_t version;
+  FleetRole role;
+  uint8_t group;
+};
+
+struct PendingUpdate {
+  bool used;
+  unsigned long applyAt; // local millis()
+  LedUpdate update;
+};
+
+static Preferences store;
+static ConfigBlob config = {CONFIG_BLOB_VERSION, FleetRole::Off, FLEET_ALL_GROUPS};
+static uint32_t selfId = 0;
+static uint32_t selfSession = 0;
+static int rxSocket = -1;
+static int txSocket = -1;
+static uint32_t joinedIp = 0; // station address the group was joined on
+static uint32_t nextSeq = 1;
+static unsigned long lastSent = 0;
+
+// Written by the receiver task and the control loop
+static portMUX_TYPE fleetLock = portMUX_INITIALIZER_UNLOCKED;
+static PendingUpdate pending[FLEET_PENDING];
+static uint32_t leader = 0;
+static uint32_t leaderSession = 0;
+static uint32_t lastSeq = 0;
+static int32_t samples[FLEET_OFFSET_WINDOW];
+static uint8_t sampleCount = 0;
+static uint8_t sampleNext = 0;
+static unsigned long lastSampleAt = 0;
+static FleetStats stats;
+
+// --- Wire format ---
+
+bool validFleetPacket(const uint8_t* data, size_t length) {
+  return length == sizeof(FleetPacket) && data[0] == 'G' && data[1] == 'F' && data[2] == PACKET_VERSION &&
+         data[3] <= (uint8_t)FleetPacketType::State;
+}
+
+static void startPacket(FleetPacket& packet, FleetPacketType type, unsigned long now) {
+  memset(&packet, 0, sizeof(packet));
+  packet.magic[0] = 'G';
+  packet.magic[1] = 'F';
+  packet.version = PACKET_VERSION;
+  packet.type = type;
+  packet.sender = selfId;
+  packet.session = selfSession;
+  packet.sentAt = now;
+}
+
+void encodeFleetState(FleetPacket& packet, const LedUpdate& update) {
+  packet.fields = update.fields & KNOWN_FIELDS;
+  packet.on = update.on ? 1 : 0;
+  packet.brightness = update.brightness;
+  packet.color[0] = update.color >> 16;
+  packet.color[1] = update.color >> 8;
+  packet.color[2] = update.color;
+  packet.effect = (uint8_t)update.effect;
+  packet.period = update.period;
+}
+
+void decodeFleetState(const FleetPacket& packet, LedUpdate& update) {
+  update.fields = packet.fields & KNOWN_FIELDS;
+  update.on = packet.on != 0;
+  update.brightness = packet.brightness;
+  update.color = ((uint32_t)packet.color[0] << 16) | ((uint32_t)packet.color[1] << 8) | packet.color[2];
+  update.effect = (LedEffect)packet.effect;
+  update.period = packet.period;
+  // An effect this build does not know is left out rather than guessed
+  if (packet.effect > (uint8_t)LedEffect::Blink) update.fields &= ~STATE_EFFECT;
+}
+
+// --- Pending updates and the clock offset (callers hold fleetLock) ---
+
+static int32_t offsetLocked() {
+  int32_t best = samples[0];
+  for (uint8_t i = 1; i < sampleCount; i++) {
+    if (samples[i] < best) best = samples[i];
+  }
+  return best;
+}
+
+static bool queueLocked(const LedUpdate& update, unsigned long applyAt) {
+  for (PendingUpdate& slot : pending) {
+    if (slot.used) continue;
+    slot.used = true;
+    slot.applyAt = applyAt;
+    slot.update = update;
+    return true;
+  }
+  stats.dropped++;
+  return false;
+}
+
+static void receive(const FleetPacket& packet, unsigned long now) {
+  bool queued = false;
+  portENTER_CRITICAL(&fleetLock);
+  stats.packetsReceived++;
+  if (packet.sender != leader || packet.session != leaderSession) {
+    // A different leader, or the same one rebooted, has its own clock and
+    // sequence numbers; start over
+    leader = packet.sender;
+    leaderSession = packet.session;
+    lastSeq = packet.seq - 1;
+    sampleCount = 0;
+    sampleNext = 0;
+  }
+  samples[sampleNext] = (int32_t)(now - packet.sentAt);
+  sampleNext = (sampleNext + 1) % FLEET_OFFSET_WINDOW;
+  if (sampleCount < FLEET_OFFSET_WINDOW) sampleCount++;
+  lastSampleAt = now;
+
+  if (packet.type == FleetPacketType::State &&
+      (packet.group == FLEET_ALL_GROUPS || packet.group == config.group)) {
+    if ((int32_t)(packet.seq - lastSeq) <= 0) {
+      stats.duplicates++;
+    } else {
+      lastSeq = packet.seq;
+      LedUpdate update;
+      decodeFleetState(packet, update);
+      unsigned long applyAt = packet.applyAt + offsetLocked();
+      if ((long)(now - applyAt) > 0) stats.lateUpdates++;
+      queued = queueLocked(update, applyAt);
+    }
+  }
+  portEXIT_CRITICAL(&fleetLock);
+  if (queued) notifyLoop(LOOP_EVENT_FLEET);
+}
+
+static void fleetReceiveTask(void* parameter) {
+  static uint8_t buffer[64];
+  for (;;) {
+    int received = recvfrom(rxSocket, buffer, sizeof(buffer), 0, nullptr, nullptr);
+    unsigned long now = millis();
+    if (received <= 0 || !validFleetPacket(buffer, received)) continue;
+    FleetPacket packet;
+    memcpy(&packet, buffer, sizeof(packet));
+    if (packet.sender == selfId || config.role == FleetRole::Off) continue;
+    receive(packet, now);
+  }
+}
+
+// --- Sockets ---
+
+static void sendPacket(const FleetPacket& packet, uint8_t copies) {
+  struct sockaddr_in to;
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_port = htons(FLEET_PORT);
+  to.sin_addr.s_addr = inet_addr(FLEET_MULTICAST_GROUP);
+  for (uint8_t i = 0; i < copies; i++) {
+    if (sendto(txSocket, &packet, sizeof(packet), 0, (struct sockaddr*)&to, sizeof(to)) == sizeof(packet)) {
+      stats.packetsSent++;
+    }
+  }
+  lastSent = packet.sentAt;
+}
+
+static void setMembership(int option, uint32_t ip) {
+  struct ip_mreq request;
+  request.imr_multiaddr.s_addr = inet_addr(FLEET_MULTICAST_GROUP);
+  request.imr_interface.s_addr = ip;
+  setsockopt(rxSocket, IPPROTO_IP, option, &request, sizeof(request));
+}
+
+static void joinGroup(uint32_t ip) {
+  setMembership(IP_ADD_MEMBERSHIP, ip);
+  struct in_addr interface;
+  interface.s_addr = ip;
+  setsockopt(txSocket, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+  joinedIp = ip;
+}
+
+static void leaveGroup() {
+  if (joinedIp == 0) return;
+  // Fails harmlessly when the address is already gone with the link
+  setMembership(IP_DROP_MEMBERSHIP, joinedIp);
+  joinedIp = 0;
+}
+
+static bool openSockets() {
+  rxSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  txSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (rxSocket < 0 || txSocket < 0) return false;
+  int reuse = 1;
+  setsockopt(rxSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(FLEET_PORT);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(rxSocket, (struct sockaddr*)&local, sizeof(local)) < 0) return false;
+  uint8_t ttl = 1; // never leaves the local network
+  setsockopt(txSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  return true;
+}
+
+// --- Control loop ---
+
+void beginFleetSync(BaseType_t core) {
+  store.begin(FLEET_NAMESPACE, true);
+  ConfigBlob saved;
+  if (store.getBytesLength(CONFIG_BLOB_KEY) == sizeof(saved) &&
+      store.getBytes(CONFIG_BLOB_KEY, &saved, sizeof(saved)) == sizeof(saved) &&
+      saved.version == CONFIG_BLOB_VERSION && saved.role <= FleetRole::Leader) {
+    config = saved;
+  }
+  store.end();
+
+  selfId = (uint32_t)ESP.getEfuseMac();
+  selfSession = esp_random();
+  if (!openSockets()) {
+    Serial.println("Fleet: sockets unavailable");
+    return;
+  }
+  xTaskCreatePinnedToCore(fleetReceiveTask, "fleet", FLEET_STACK_SIZE, nullptr, RECEIVE_PRIORITY, nullptr, core);
+}
+
+void setFleetConfig(FleetRole role, uint8_t group) {
+  if (role == config.role && group == config.group) return;
+  config.role = role;
+  config.group = group;
+  store.begin(FLEET_NAMESPACE, false);
+  store.putBytes(CONFIG_BLOB_KEY, &config, sizeof(config));
+  store.end();
+  // serviceFleetSync() joins again if the new role needs it
+  leaveGroup();
+}
+
+FleetRole fleetRole() {
+  return config.role;
+}
+
+uint8_t fleetGroup() {
+  return config.group;
+}
+
+void serviceFleetSync() {
+  if (txSocket < 0) return;
+  uint32_t ip = 0;
+  if (config.role != FleetRole::Off && WiFi.status() == WL_CONNECTED) ip = (uint32_t)WiFi.localIP();
+  if (ip != joinedIp) {
+    leaveGroup();
+    if (ip != 0) joinGroup(ip);
+  }
+
+  unsigned long now = millis();
+  if (config.role == FleetRole::Leader && joinedIp != 0 && now - lastSent >= FLEET_BEACON_INTERVAL) {
+    FleetPacket beacon;
+    startPacket(beacon, FleetPacketType::Beacon, now);
+    sendPacket(beacon, 1);
+  }
+}
+
+bool sendFleetUpdate(const LedUpdate& update) {
+  if (config.role != FleetRole::Leader || joinedIp == 0) return false;
+  unsigned long now = millis();
+  FleetPacket packet;
+  startPacket(packet, FleetPacketType::State, now);
+  packet.seq = nextSeq++;
+  packet.applyAt = now + FLEET_APPLY_DELAY;
+  packet.group = config.group;
+  encodeFleetState(packet, update);
+  sendPacket(packet, FLEET_REPEATS);
+
+  portENTER_CRITICAL(&fleetLock);
+  bool queued = queueLocked(update, packet.applyAt);
+  portEXIT_CRITICAL(&fleetLock);
+  // With the queue full the caller applies it straight away instead
+  return queued;
+}
+
+bool takeFleetUpdate(LedUpdate& update) {
+  unsigned long now = millis();
+  PendingUpdate* due = nullptr;
+  portENTER_CRITICAL(&fleetLock);
+  for (PendingUpdate& slot : pending) {
+    if (!slot.used || (long)(now - slot.applyAt) < 0) continue;
+    if (due == nullptr || (long)(slot.applyAt - due->applyAt) < 0) due = &slot;
+  }
+  if (due != nullptr) {
+    update = due->update;
+    due->used = false;
+    stats.updatesApplied++;
+  }
+  portEXIT_CRITICAL(&fleetLock);
+  return due != nullptr;
+}
+
+uint32_t fleetWaitTime(uint32_t limit) {
+  unsigned long now = millis();
+  uint32_t wait = limit;
+  portENTER_CRITICAL(&fleetLock);
+  for (const PendingUpdate& slot : pending) {
+    if (!slot.used) continue;
+    long left = (long)(slot.applyAt - now);
+    wait = min(wait, (uint32_t)(left > 0 ? left : 0));
+  }
+  portEXIT_CRITICAL(&fleetLock);
+  if (config.role == FleetRole::Leader && joinedIp != 0) {
+    unsigned long since = now - lastSent;
+    wait = min(wait, (uint32_t)(since >= FLEET_BEACON_INTERVAL ? 0 : FLEET_BEACON_INTERVAL - since));
+  }
+  return wait;
+}
+
+FleetStats fleetStats() {
+  portENTER_CRITICAL(&fleetLock);
+  FleetStats copy = stats;
+  copy.leader = leader;
+  copy.offset = sampleCount > 0 ? offsetLocked() : 0;
+  copy.synced = sampleCount > 0 && millis() - lastSampleAt < SYNC_TIMEOUT;
+  portEXIT_CRITICAL(&fleetLock);
+  return copy;
+}
+
+const char* fleetRoleName(FleetRole role) {
+  return ROLE_NAMES[(uint8_t)role];
+}
+
+bool parseFleetRole(const char* name, FleetRole& role) {
+  for (uint8_t i = 0; i < sizeof(ROLE_NAMES) / sizeof(ROLE_NAMES[0]); i++) {
+    if (strcmp(name, ROLE_NAMES[i]) == 0) {
+      role = (FleetRole)i;
+      return true;
+    }
+  }
+  return false;
+}
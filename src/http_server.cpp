@@ -0,0 +1,348 @@
+#include "http_server.h"
+#include <lwip/sockets.h>
+
+// One wildcard handler per method; routing happens in handle() so that
+// notFound, HTTP_ANY and the route table work the way WebServer's did.
+static const httpd_method_t METHODS[] = {
+  HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_DELETE, HTTP_OPTIONS, HTTP_PATCH,
+};
+
+static const char* statusLine(int code) {
+  switch (code) {
+    case 200: return "200 OK";
+    case 202: return "202 Accepted";
+    case 204: return "204 No Content";
+    case 302: return "302 Found";
+    case 303: return "303 See Other";
+    case 304: return "304 Not Modified";
+    case 400: return "400 Bad Request";
+    case 401: return "401 Unauthorized";
+    case 403: return "403 Forbidden";
+    case 404: return "404 Not Found";
+    case 405: return "405 Method Not Allowed";
+    case 408: return "408 Request Timeout";
+    case 409: return "409 Conflict";
+    case 413: return "413 Payload Too Large";
+    case 503: return "503 Service Unavailable";
+    default: return "500 Internal Server Error";
+  }
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// application/x-www-form-urlencoded, decoded in place
+static void urlDecode(char* text) {
+  char* out = text;
+  for (const char* p = text; *p; p++) {
+    int high, low;
+    if (*p == '+') {
+      *out++ = ' ';
+    } else if (*p == '%' && (high = hexValue(p[1])) >= 0 && (low = hexValue(p[2])) >= 0) {
+      *out++ = (char)((high << 4) | low);
+      p += 2;
+    } else {
+      *out++ = *p;
+    }
+  }
+  *out = '\0';
+}
+
+bool HttpServer::on(const char* path, HTTPMethod method, Handler handler, bool streamBody, bool head) {
+  if (_routeCount == HTTP_MAX_ROUTES) {
+    Serial.printf("HTTP: route table full, %s not registered\n", path);
+    return false;
+  }
+  Route& route = _routes[_routeCount++];
+  route.path = path;
+  route.method = method;
+  route.handler = handler;
+  route.streamBody = streamBody;
+  route.head = head;
+  return true;
+}
+
+bool HttpServer::begin(BaseType_t core, uint32_t stackSize) {
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = _port;
+  config.core_id = core;
+  config.stack_size = stackSize;
+  config.max_open_sockets = HTTP_MAX_CONNECTIONS;
+  config.max_uri_handlers = sizeof(METHODS) / sizeof(METHODS[0]);
+  config.max_resp_headers = HTTP_MAX_RESPONSE_HEADERS;
+  config.recv_wait_timeout = HTTP_RECV_TIMEOUT;
+  config.send_wait_timeout = HTTP_SEND_TIMEOUT;
+  // With every socket busy, a new client replaces the longest idle one
+  config.lru_purge_enable = true;
+  config.uri_match_fn = httpd_uri_match_wildcard;
+  if (httpd_start(&_handle, &config) != ESP_OK) {
+    Serial.println("HTTP: server failed to start");
+    return false;
+  }
+  for (httpd_method_t method : METHODS) {
+    httpd_uri_t uri;
+    memset(&uri, 0, sizeof(uri));
+    uri.uri = "/*";
+    uri.method = method;
+    uri.handler = dispatch;
+    uri.user_ctx = this;
+    httpd_register_uri_handler(_handle, &uri);
+  }
+  return true;
+}
+
+esp_err_t HttpServer::dispatch(httpd_req_t* req) {
+  return static_cast<HttpServer*>(req->user_ctx)->handle(req);
+}
+
+esp_err_t HttpServer::handle(httpd_req_t* req) {
+  _req = req;
+  _bodyLength = 0;
+  _received = 0;
+  _body[0] = '\0';
+  _argCount = 0;
+  _headerPoolUsed = 0;
+  _bytesSent = 0;
+  _head = req->method == HTTP_HEAD;
+  _headStatus = nullptr;
+  _headType = nullptr;
+  _headHeaderCount = 0;
+  _headLength = 0;
+  _formBody = false;
+  _streamNext = false;
+  _streaming = false;
+  _responded = false;
+  _failed = false;
+
+  size_t pathLength = strcspn(req->uri, "?");
+  const Route* match = nullptr;
+  bool headRefused = false;
+  for (uint8_t i = 0; i < _routeCount; i++) {
+    const Route& route = _routes[i];
+    if (strlen(route.path) != pathLength || strncmp(route.path, req->uri, pathLength) != 0) continue;
+    if (route.method == HTTP_ANY || route.method == (HTTPMethod)req->method) {
+      match = &route;
+      break;
+    }
+    if (_head && route.method == HTTP_GET) {
+      if (route.head) {
+        match = &route;
+        break;
+      }
+      headRefused = true;
+    }
+  }
+
+  bool streaming = match != nullptr && match->streamBody;
+  if (!streaming && !readBody()) {
+    // What is left of the body is still on the socket, so it is closed
+    if (!_responded) send(408);
+    if (_head) sendHeadResponse();
+    _req = nullptr;
+    return ESP_FAIL;
+  }
+  if (httpd_req_get_url_query_str(req, _query, sizeof(_query)) == ESP_OK) parseArgs(_query);
+  if (_formBody) parseArgs(_body);
+
+  if (match != nullptr) {
+    match->handler();
+  } else if (headRefused) {
+    sendHeader("Allow", "GET");
+    send(405, "text/plain", "Method Not Allowed");
+  } else if (_notFound) {
+    _notFound();
+  } else {
+    send(404, "text/plain", "Not Found");
+  }
+
+  if (!_responded) send(500, "text/plain", "No response");
+  else if (_streaming) sendContent(nullptr, 0);
+  if (_head) sendHeadResponse();
+  // A streaming handler that stopped early leaves body bytes that would be
+  // read as the next request
+  if (streaming && _received < req->content_len) _failed = true;
+  _req = nullptr;
+  // Failing closes the socket, which is all that is left to do after a
+  // write error
+  return _failed ? ESP_FAIL : ESP_OK;
+}
+
+bool HttpServer::readBody() {
+  size_t length = _req->content_len;
+  if (length == 0) return true;
+  if (length > HTTP_MAX_BODY) {
+    send(413, "text/plain", "Request body too large");
+    return false;
+  }
+  while (_bodyLength < length) {
+    int received = httpd_req_recv(_req, _body + _bodyLength, length - _bodyLength);
+    if (received <= 0) return false;
+    _bodyLength += received;
+  }
+  _received = _bodyLength;
+  _body[_bodyLength] = '\0';
+  char type[48];
+  _formBody = httpd_req_get_hdr_value_str(_req, "Content-Type", type, sizeof(type)) != ESP_ERR_NOT_FOUND &&
+              strncmp(type, "application/x-www-form-urlencoded", 33) == 0;
+  return true;
+}
+
+void HttpServer::parseArgs(char* text) {
+  char* next = text;
+  while (next != nullptr && *next != '\0' && _argCount < HTTP_MAX_ARGS) {
+    char* pair = next;
+    next = strchr(pair, '&');
+    if (next != nullptr) *next++ = '\0';
+    char* value = strchr(pair, '=');
+    if (value != nullptr) *value++ = '\0';
+    else value = pair + strlen(pair);
+    urlDecode(pair);
+    urlDecode(value);
+    _args[_argCount].name = pair;
+    _args[_argCount].value = value;
+    _argCount++;
+  }
+}
+
+String HttpServer::arg(const char* name) const {
+  if (strcmp(name, "plain") == 0) return _formBody ? String() : String(_body);
+  for (uint8_t i = 0; i < _argCount; i++) {
+    if (strcmp(_args[i].name, name) == 0) return String(_args[i].value);
+  }
+  return String();
+}
+
+bool HttpServer::hasArg(const char* name) const {
+  if (strcmp(name, "plain") == 0) return !_formBody && _bodyLength > 0;
+  for (uint8_t i = 0; i < _argCount; i++) {
+    if (strcmp(_args[i].name, name) == 0) return true;
+  }
+  return false;
+}
+
+String HttpServer::header(const char* name) const {
+  char value[128];
+  if (httpd_req_get_hdr_value_str(_req, name, value, sizeof(value)) != ESP_OK) return String();
+  return String(value);
+}
+
+size_t HttpServer::contentLength() const {
+  return _req->content_len;
+}
+
+int HttpServer::receive(uint8_t* buffer, size_t length) {
+  size_t left = _req->content_len - _received;
+  if (left == 0) return 0;
+  int received = httpd_req_recv(_req, (char*)buffer, min(length, left));
+  if (received <= 0) return -1;
+  _received += received;
+  return received;
+}
+
+IPAddress HttpServer::localIP() const {
+  struct sockaddr_storage address;
+  socklen_t length = sizeof(address);
+  if (getsockname(httpd_req_to_sockfd(_req), (struct sockaddr*)&address, &length) < 0) return IPAddress();
+  uint32_t ip;
+  if (address.ss_family == AF_INET6) {
+    // IPv4 clients show up as ::ffff:a.b.c.d on the dual-stack listener
+    memcpy(&ip, ((struct sockaddr_in6*)&address)->sin6_addr.s6_addr + 12, 4);
+  } else {
+    ip = ((struct sockaddr_in*)&address)->sin_addr.s_addr;
+  }
+  return IPAddress(ip);
+}
+
+// esp_http_server keeps the header pointers until the response goes out, so
+// names and values are copied into a per-request pool
+const char* HttpServer::keep(const char* text) {
+  size_t length = strlen(text) + 1;
+  if (_headerPoolUsed + length > sizeof(_headerPool)) return nullptr;
+  char* copy = _headerPool + _headerPoolUsed;
+  memcpy(copy, text, length);
+  _headerPoolUsed += length;
+  return copy;
+}
+
+void HttpServer::sendHeader(const char* name, const String& value, bool first) {
+  const char* keptName = keep(name);
+  const char* keptValue = keptName ? keep(value.c_str()) : nullptr;
+  bool kept = keptValue != nullptr;
+  if (kept && _head) {
+    kept = _headHeaderCount < HTTP_MAX_RESPONSE_HEADERS;
+    if (kept) _headHeaders[_headHeaderCount++] = {keptName, keptValue};
+  } else if (kept) {
+    kept = httpd_resp_set_hdr(_req, keptName, keptValue) == ESP_OK;
+  }
+  if (!kept) Serial.printf("HTTP: header %s dropped\n", name);
+}
+
+void HttpServer::startResponse(int code, const char* contentType) {
+  _responded = true;
+  const char* kept = contentType != nullptr ? keep(contentType) : nullptr;
+  if (_head) {
+    _headStatus = statusLine(code);
+    _headType = kept;
+    return;
+  }
+  httpd_resp_set_status(_req, statusLine(code));
+  if (kept != nullptr) httpd_resp_set_type(_req, kept);
+}
+
+// esp_http_server always sends a body of the length it advertises, so the
+// headers of a HEAD response are written to the socket directly, with the
+// Content-Length the GET body would have had.
+void HttpServer::sendHeadResponse() {
+  char block[HTTP_HEADER_POOL_SIZE + 128];
+  int length = snprintf(block, sizeof(block), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n",
+                        _headStatus, _headType ? _headType : "text/html", (unsigned)_headLength);
+  for (uint8_t i = 0; i < _headHeaderCount && length < (int)sizeof(block); i++) {
+    length += snprintf(block + length, sizeof(block) - length, "%s: %s\r\n", _headHeaders[i].name, _headHeaders[i].value);
+  }
+  if (length < (int)sizeof(block)) length += snprintf(block + length, sizeof(block) - length, "\r\n");
+  if (length >= (int)sizeof(block) || httpd_send(_req, block, length) != length) _failed = true;
+}
+
+void HttpServer::send(int code, const char* contentType, const String& content) {
+  if (_responded) return;
+  startResponse(code, contentType);
+  if (_streamNext) {
+    _streamNext = false;
+    _streaming = true;
+    if (content.length() > 0) sendContent(content.c_str(), content.length());
+    return;
+  }
+  if (_head) {
+    _headLength = content.length();
+    return;
+  }
+  if (httpd_resp_send(_req, content.c_str(), content.length()) != ESP_OK) _failed = true;
+  else _bytesSent += content.length();
+}
+
+void HttpServer::send_P(int code, const char* contentType, const char* data, size_t length) {
+  if (_responded) return;
+  startResponse(code, contentType);
+  if (_head) {
+    _headLength = length;
+    return;
+  }
+  if (httpd_resp_send(_req, data, length) != ESP_OK) _failed = true;
+  else _bytesSent += length;
+}
+
+void HttpServer::sendContent(const char* data, size_t length) {
+  if (!_streaming || _failed) return;
+  if (_head) {
+    _headLength += length;
+    if (length == 0) _streaming = false;
+    return;
+  }
+  if (httpd_resp_send_chunk(_req, length > 0 ? data : nullptr, length) != ESP_OK) _failed = true;
+  else _bytesSent += length;
+  if (length == 0) _streaming = false;
+}
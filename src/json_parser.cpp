@@ -0,0 +1,204 @@
+#include "json_parser.h"
+#include <string.h>
+
+static const uint16_t OPEN = 0xFFFF; // end of a container not yet closed
+
+static int addToken(JsonToken* tokens, int& count, uint16_t maxTokens, int parent, JsonType type,
+                    size_t start, size_t end) {
+  if (count >= maxTokens) return JSON_ERROR_NO_TOKENS;
+  if (parent >= 0) {
+    JsonToken& owner = tokens[parent];
+    // Object members must be keys; a key holds exactly one value
+    if (owner.type == JsonType::Object && type != JsonType::String) return JSON_ERROR_INVALID;
+    if (owner.type == JsonType::String && owner.size > 0) return JSON_ERROR_INVALID;
+    owner.size++;
+  } else if (count > 0) {
+    return JSON_ERROR_INVALID; // more than one top-level value
+  }
+  JsonToken& token = tokens[count];
+  token.type = type;
+  token.start = start;
+  token.end = end;
+  token.size = 0;
+  token.parent = parent;
+  return count++;
+}
+
+int jsonParse(const char* json, size_t length, JsonToken* tokens, uint16_t maxTokens) {
+  if (length >= OPEN) return JSON_ERROR_INVALID;
+  int count = 0;
+  int parent = -1;
+  bool afterValue = false; // a value (or key) just ended; ',' ':' or a close may follow
+
+  for (size_t pos = 0; pos < length; pos++) {
+    char c = json[pos];
+    switch (c) {
+      case '{':
+      case '[': {
+        if (afterValue) return JSON_ERROR_INVALID;
+        int index = addToken(tokens, count, maxTokens, parent,
+                             c == '{' ? JsonType::Object : JsonType::Array, pos, OPEN);
+        if (index < 0) return index;
+        parent = index;
+        break;
+      }
+      case '}':
+      case ']': {
+        // Only an empty container may close right after its opening bracket
+        if (!afterValue && (parent < 0 || tokens[parent].size > 0 || tokens[parent].type == JsonType::String)) {
+          return JSON_ERROR_INVALID;
+        }
+        if (parent >= 0 && tokens[parent].type == JsonType::String) parent = tokens[parent].parent;
+        if (parent < 0) return JSON_ERROR_INVALID;
+        JsonToken& container = tokens[parent];
+        if (container.type != (c == '}' ? JsonType::Object : JsonType::Array)) return JSON_ERROR_INVALID;
+        container.end = pos + 1;
+        parent = container.parent;
+        afterValue = true;
+        break;
+      }
+      case '"': {
+        if (afterValue) return JSON_ERROR_INVALID;
+        size_t start = pos + 1;
+        for (pos = start; pos < length && json[pos] != '"'; pos++) {
+          if (json[pos] == '\\') {
+            if (++pos >= length) return JSON_ERROR_PARTIAL;
+          } else if ((unsigned char)json[pos] < 0x20) {
+            return JSON_ERROR_INVALID;
+          }
+        }
+        if (pos >= length) return JSON_ERROR_PARTIAL;
+        int index = addToken(tokens, count, maxTokens, parent, JsonType::String, start, pos);
+        if (index < 0) return index;
+        afterValue = true;
+        break;
+      }
+      case ':':
+        // The value that follows belongs to the key just read
+        if (!afterValue || count == 0 || tokens[count - 1].type != JsonType::String || tokens[count - 1].parent != parent ||
+            parent < 0 || tokens[parent].type != JsonType::Object) {
+          return JSON_ERROR_INVALID;
+        }
+        parent = count - 1;
+        afterValue = false;
+        break;
+      case ',':
+        if (!afterValue) return JSON_ERROR_INVALID;
+        afterValue = false;
+        if (parent >= 0 && tokens[parent].type == JsonType::String) parent = tokens[parent].parent;
+        if (parent < 0) return JSON_ERROR_INVALID;
+        break;
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        break;
+      default: {
+        if (afterValue) return JSON_ERROR_INVALID;
+        if (!(c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')) return JSON_ERROR_INVALID;
+        size_t start = pos;
+        while (pos < length && !strchr(" \t\r\n,:]}", json[pos])) pos++;
+        int index = addToken(tokens, count, maxTokens, parent, JsonType::Primitive, start, pos);
+        if (index < 0) return index;
+        afterValue = true;
+        pos--;
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (tokens[i].end == OPEN) return JSON_ERROR_PARTIAL;
+    // Every key needs its value
+    if (tokens[i].type == JsonType::String && tokens[i].parent >= 0 &&
+        tokens[tokens[i].parent].type == JsonType::Object && tokens[i].size != 1) {
+      return JSON_ERROR_INVALID;
+    }
+  }
+  return count;
+}
+
+int jsonSkip(const JsonToken* tokens, int count, int index) {
+  int next = index + 1;
+  while (next < count && tokens[next].start < tokens[index].end) next++;
+  return next;
+}
+
+int jsonObjectGet(const char* json, const JsonToken* tokens, int count, int object, const char* key) {
+  if (object < 0 || object >= count || tokens[object].type != JsonType::Object) return -1;
+  int index = object + 1;
+  for (uint16_t i = 0; i < tokens[object].size && index + 1 < count; i++) {
+    if (jsonEquals(json, tokens[index], key)) return index + 1;
+    index = jsonSkip(tokens, count, index + 1);
+  }
+  return -1;
+}
+
+bool jsonEquals(const char* json, const JsonToken& token, const char* text) {
+  size_t length = token.end - token.start;
+  return strlen(text) == length && memcmp(json + token.start, text, length) == 0;
+}
+
+bool jsonToBool(const char* json, const JsonToken& token, bool& value) {
+  if (token.type != JsonType::Primitive) return false;
+  if (jsonEquals(json, token, "true")) value = true;
+  else if (jsonEquals(json, token, "false")) value = false;
+  else return false;
+  return true;
+}
+
+bool jsonToLong(const char* json, const JsonToken& token, long& value) {
+  if (token.type != JsonType::Primitive) return false;
+  const char* p = json + token.start;
+  const char* end = json + token.end;
+  bool negative = (*p == '-');
+  if (negative) p++;
+  if (p == end) return false;
+  long result = 0;
+  for (; p < end; p++) {
+    if (*p < '0' || *p > '9') return false;
+    if (result > (2147483647L - (*p - '0')) / 10) return false;
+    result = result * 10 + (*p - '0');
+  }
+  value = negative ? -result : result;
+  return true;
+}
+
+bool jsonToString(const char* json, const JsonToken& token, char* out, size_t size) {
+  if (token.type != JsonType::String || size == 0) return false;
+  size_t n = 0;
+  for (uint16_t i = token.start; i < token.end; i++) {
+    char c = json[i];
+    if (c == '\\') {
+      c = json[++i];
+      switch (c) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': {
+          // Only the ASCII range is kept; anything else becomes '?'
+          if (i + 4 >= token.end) return false;
+          unsigned code = 0;
+          for (int k = 1; k <= 4; k++) {
+            char h = json[i + k];
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= h - '0';
+            else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+            else return false;
+          }
+          i += 4;
+          c = code < 0x80 ? (char)code : '?';
+          break;
+        }
+        default: break; // \" \\ \/
+      }
+    }
+    if (n + 1 >= size) return false;
+    out[n++] = c;
+  }
+  out[n] = '\0';
+  return true;
+}
@@ -0,0 +1,292 @@
+#include "led_effects.h"
+#include "led_output.h"
+
+static const char* const EFFECT_NAMES[] = {"solid", "breathe", "rainbow", "blink"};
+
+// Segment configuration plus the animation state that goes with it
+struct SegmentState {
+  LedSegment config;
+  CRGB color;
+  CRGB fadeFrom;
+  unsigned long colorFadeStart;
+  unsigned long effectStart;
+  CRGB lastUniform;
+};
+
+static SegmentState segments[MAX_LED_SEGMENTS];
+static uint8_t segmentCount = 0;
+
+// On/off fade, expressed as a 0-255 level
+static bool targetOn = false;
+static uint8_t levelFrom = 0;
+static unsigned long levelFadeStart = 0;
+
+static uint8_t brightness = 255;
+static bool selfTestRunning = false;
+static unsigned long selfTestStart = 0;
+
+static unsigned long lastFrameTime = 0;
+static bool forceShow = true;
+// The back buffer holds a rendered frame waiting for the strip to be free
+static bool framePending = false;
+// Strip level the last frame was rendered at
+static uint8_t renderedLevel = 0;
+static LedFrameStats stats = {0, 0, 0, 0, 0, 0};
+
+// 0-255 progress of a fade that started at `start`
+static uint8_t fadeProgress(unsigned long now, unsigned long start) {
+  unsigned long elapsed = now - start;
+  if (elapsed >= LED_FADE_TIME) return 255;
+  return ease8InOutCubic((uint8_t)(elapsed * 255 / LED_FADE_TIME));
+}
+
+static CRGB baseColor(const SegmentState& segment, unsigned long now) {
+  return blend(segment.fadeFrom, segment.color, fadeProgress(now, segment.colorFadeStart));
+}
+
+static uint8_t currentLevel(unsigned long now) {
+  return lerp8by8(levelFrom, targetOn ? 255 : 0, fadeProgress(now, levelFadeStart));
+}
+
+// Position in the segment's effect cycle, 0-255
+static uint8_t effectPhase(const SegmentState& segment, unsigned long now) {
+  uint16_t period = segment.config.period;
+  return (uint8_t)(((now - segment.effectStart) % period) * 256 / period);
+}
+
+// The single colour a non-rainbow segment shows this frame
+static CRGB uniformColor(const SegmentState& segment, unsigned long now, uint8_t level) {
+  CRGB color;
+  switch (segment.config.effect) {
+    case LedEffect::Breathe:
+      // Never fully dark so the LED is visibly on at the bottom of the cycle
+      color = baseColor(segment, now);
+      color.nscale8_video(qadd8(scale8(cubicwave8(effectPhase(segment, now)), 224), 31));
+      break;
+    case LedEffect::Blink:
+      color = effectPhase(segment, now) < 128 ? baseColor(segment, now) : CRGB(CRGB::Black);
+      break;
+    case LedEffect::Solid:
+    default:
+      color = baseColor(segment, now);
+      break;
+  }
+  color.nscale8_video(level);
+  return color;
+}
+
+static void clipSegments() {
+  uint16_t length = ledCount();
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    LedSegment& config = segments[i].config;
+    if (config.start >= length) config.length = 0;
+    else if (config.length > length - config.start) config.length = length - config.start;
+    if (config.period == 0) config.period = 1;
+  }
+}
+
+void beginLedEffects() {
+  LedSegment whole = {0, ledCount(), 0x000000, LedEffect::Solid, 2000};
+  setLedSegments(&whole, 1);
+}
+
+void startLedSelfTest() {
+  selfTestRunning = true;
+  selfTestStart = millis();
+  forceShow = true;
+}
+
+void setLedTarget(bool on, const CRGB& color, uint8_t newBrightness) {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    SegmentState& segment = segments[i];
+    if (color != segment.color) {
+      segment.fadeFrom = baseColor(segment, now);
+      segment.color = color;
+      segment.config.color = ((uint32_t)color.r << 16) | ((uint32_t)color.g << 8) | color.b;
+      segment.colorFadeStart = now;
+    }
+  }
+  if (on != targetOn) {
+    levelFrom = currentLevel(now);
+    targetOn = on;
+    levelFadeStart = now;
+  }
+  if (newBrightness != brightness) {
+    brightness = newBrightness;
+    forceShow = true;
+  }
+}
+
+void setLedEffect(LedEffect effect, uint16_t periodMs) {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    segments[i].config.effect = effect;
+    segments[i].config.period = periodMs > 0 ? periodMs : 1;
+    segments[i].effectStart = now;
+  }
+  forceShow = true;
+}
+
+void setLedSegments(const LedSegment* configs, uint8_t count) {
+  unsigned long now = millis();
+  segmentCount = min(count, (uint8_t)MAX_LED_SEGMENTS);
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    SegmentState& segment = segments[i];
+    segment.config = configs[i];
+    segment.color = CRGB(configs[i].color);
+    segment.fadeFrom = segment.color;
+    segment.colorFadeStart = now - LED_FADE_TIME;
+    segment.effectStart = now;
+  }
+  clipSegments();
+  forceShow = true;
+}
+
+static bool frameChanged(unsigned long now, uint8_t level) {
+  if (forceShow || selfTestRunning) return true;
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    const SegmentState& segment = segments[i];
+    if (segment.config.length == 0) continue;
+    // A rainbow moves every frame, but once dark it stays dark
+    if (segment.config.effect == LedEffect::Rainbow) {
+      if (level > 0 || level != renderedLevel) return true;
+      continue;
+    }
+    if (uniformColor(segment, now, level) != segment.lastUniform) return true;
+  }
+  return false;
+}
+
+// Renders the whole frame. The back buffer holds the frame before last, so
+// every pixel is written, not just the segments that changed.
+static void renderFrame(CRGB* frame, unsigned long now, uint8_t level) {
+  renderedLevel = level;
+  uint16_t length = ledCount();
+  if (selfTestRunning) {
+    unsigned long step = (now - selfTestStart) / LED_SELF_TEST_STEP;
+    if (step < 3) {
+      static const CRGB testColors[] = {CRGB::Red, CRGB::Green, CRGB::Blue};
+      fill_solid(frame, length, testColors[step]);
+      return;
+    }
+    selfTestRunning = false;
+  }
+
+  fill_solid(frame, length, CRGB::Black);
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    SegmentState& segment = segments[i];
+    CRGB* pixels = frame + segment.config.start;
+    uint16_t pixelCount = segment.config.length;
+    if (pixelCount == 0) continue;
+    if (segment.config.effect == LedEffect::Rainbow) {
+      fill_rainbow(pixels, pixelCount, effectPhase(segment, now), pixelCount > 1 ? max(1, 255 / pixelCount) : 0);
+      if (level < 255) {
+        for (uint16_t p = 0; p < pixelCount; p++) pixels[p].nscale8_video(level);
+      }
+    } else {
+      segment.lastUniform = uniformColor(segment, now, level);
+      fill_solid(pixels, pixelCount, segment.lastUniform);
+    }
+  }
+  forceShow = false;
+}
+
+static void presentPendingFrame() {
+  presentLedFrame(brightness);
+  framePending = false;
+  stats.shows++;
+}
+
+void serviceLedEffects() {
+  unsigned long now = millis();
+  // A frame rendered while the previous one was still being sent goes out
+  // as soon as the strip is free, not on the next frame tick
+  if (framePending && ledOutputReady()) presentPendingFrame();
+  if (now - lastFrameTime < LED_FRAME_INTERVAL) return;
+  if (lastFrameTime != 0 && now - lastFrameTime >= 2 * LED_FRAME_INTERVAL) stats.lateFrames++;
+  lastFrameTime = now;
+
+  unsigned long start = micros();
+  uint8_t level = currentLevel(now);
+  bool changed = frameChanged(now, level);
+  if (changed) {
+    // The output task only reads the front buffer, so the back buffer can be
+    // rendered while it sends. A frame still pending is replaced by this one.
+    renderFrame(ledBackBuffer(), now, level);
+    framePending = true;
+    if (ledOutputReady()) presentPendingFrame();
+  }
+  uint32_t elapsed = micros() - start;
+
+  stats.frames++;
+  stats.lastMicros = elapsed;
+  if (elapsed > stats.maxMicros) stats.maxMicros = elapsed;
+  // Exponential moving average, 1/16 weight per frame
+  stats.avgMicros = stats.avgMicros + ((int32_t)elapsed - (int32_t)stats.avgMicros) / 16;
+}
+
+void redrawLedEffects() {
+  // Whatever drew on the strip also used the back buffer
+  framePending = false;
+  forceShow = true;
+}
+
+// True while frames still change on their own
+static bool animating() {
+  if (forceShow || selfTestRunning || framePending) return true;
+  unsigned long now = millis();
+  // One interval past the end so the final fade step still gets rendered
+  if (now - levelFadeStart < LED_FADE_TIME + LED_FRAME_INTERVAL) return true;
+  if (!targetOn) return false; // dark whatever the effect
+  for (uint8_t i = 0; i < segmentCount; i++) {
+    const SegmentState& segment = segments[i];
+    if (segment.config.length == 0) continue;
+    if (segment.config.effect != LedEffect::Solid) return true;
+    if (now - segment.colorFadeStart < LED_FADE_TIME + LED_FRAME_INTERVAL) return true;
+  }
+  return false;
+}
+
+uint32_t ledEffectsWaitTime(uint32_t limit) {
+  if (!animating()) return limit;
+  // A rendered frame waits for the strip: check back shortly
+  if (framePending) return ledOutputReady() ? 0 : 1;
+  unsigned long elapsed = millis() - lastFrameTime;
+  if (elapsed >= LED_FRAME_INTERVAL) return 0;
+  return min(limit, (uint32_t)(LED_FRAME_INTERVAL - elapsed));
+}
+
+LedEffect currentLedEffect() {
+  return segmentCount > 0 ? segments[0].config.effect : LedEffect::Solid;
+}
+
+uint16_t currentLedEffectPeriod() {
+  return segmentCount > 0 ? segments[0].config.period : 0;
+}
+
+uint8_t ledSegmentCount() {
+  return segmentCount;
+}
+
+LedSegment ledSegment(uint8_t index) {
+  return segments[index].config;
+}
+
+LedFrameStats ledFrameStats() {
+  return stats;
+}
+
+const char* ledEffectName(LedEffect value) {
+  return EFFECT_NAMES[(uint8_t)value];
+}
+
+bool parseLedEffect(const char* name, LedEffect& value) {
+  for (uint8_t i = 0; i < sizeof(EFFECT_NAMES) / sizeof(EFFECT_NAMES[0]); i++) {
+    if (strcmp(name, EFFECT_NAMES[i]) == 0) {
+      value = (LedEffect)i;
+      return true;
+    }
+  }
+  return false;
+}
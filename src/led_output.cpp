@@ -0,0 +1,88 @@
+#include "led_output.h"
+#include <atomic>
+
+static CRGB frameBuffers[2][MAX_LEDS];
+static uint8_t backIndex = 1;
+static uint16_t count = 0;
+static CLEDController* controller = nullptr;
+
+static TaskHandle_t outputTask = nullptr;
+static std::atomic<bool> busy{false};
+static uint8_t showBrightness = 255;
+
+static LedOutputStats stats = {0, 0, 0, 0, 0};
+static uint32_t framesThisSecond = 0;
+static unsigned long secondStart = 0;
+
+static void ledOutputTask(void* parameter) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    unsigned long start = micros();
+    FastLED.show(showBrightness);
+    uint32_t elapsed = micros() - start;
+
+    stats.frames++;
+    stats.lastShowMicros = elapsed;
+    if (elapsed > stats.maxShowMicros) stats.maxShowMicros = elapsed;
+    stats.avgShowMicros = stats.avgShowMicros + ((int32_t)elapsed - (int32_t)stats.avgShowMicros) / 16;
+
+    framesThisSecond++;
+    unsigned long now = millis();
+    if (now - secondStart >= 1000) {
+      stats.fps = framesThisSecond;
+      framesThisSecond = 0;
+      secondStart = now;
+    }
+
+    busy.store(false, std::memory_order_release);
+  }
+}
+
+void beginLedOutput(uint16_t ledCountToUse) {
+  count = constrain(ledCountToUse, (uint16_t)1, (uint16_t)MAX_LEDS);
+  backIndex = 1;
+  controller = &FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(frameBuffers[0], count);
+  xTaskCreatePinnedToCore(ledOutputTask, "led", 4096, nullptr, LED_OUTPUT_PRIORITY, &outputTask, LED_OUTPUT_CORE);
+}
+
+uint16_t ledCount() {
+  return count;
+}
+
+bool ledOutputReady() {
+  return !busy.load(std::memory_order_acquire);
+}
+
+CRGB* ledBackBuffer() {
+  return frameBuffers[backIndex];
+}
+
+void presentLedFrame(uint8_t brightness) {
+  controller->setLeds(frameBuffers[backIndex], count);
+  backIndex ^= 1;
+  showBrightness = brightness;
+  busy.store(true, std::memory_order_release);
+  xTaskNotifyGive(outputTask);
+}
+
+void resizeLedOutput(uint16_t newCount) {
+  newCount = constrain(newCount, (uint16_t)1, (uint16_t)MAX_LEDS);
+  if (newCount == count) return;
+  while (!ledOutputReady()) vTaskDelay(1);
+
+  if (newCount < count) {
+    // Blank the pixels that fall off the end while they are still addressed
+    fill_solid(ledBackBuffer(), count, CRGB::Black);
+    presentLedFrame(0);
+    while (!ledOutputReady()) vTaskDelay(1);
+  }
+  count = newCount;
+  fill_solid(frameBuffers[0], MAX_LEDS, CRGB::Black);
+  fill_solid(frameBuffers[1], MAX_LEDS, CRGB::Black);
+  controller->setLeds(frameBuffers[backIndex ^ 1], count);
+}
+
+LedOutputStats ledOutputStats() {
+  return stats;
+}
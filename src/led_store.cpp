@@ -0,0 +1,141 @@
+#include "led_store.h"
+#include <Preferences.h>
+
+static const char* LED_NAMESPACE = "led";
+static const char* LED_BLOB_KEY = "settings";
+static const uint8_t LED_BLOB_VERSION = 1;
+
+// On-flash layout, kept independent of LedSettings
+struct __attribute__((packed)) LedBlob {
+  uint8_t version;
+  uint8_t on;
+  uint8_t brightness;
+  uint8_t r, g, b;
+};
+
+static const char* STRIP_NAMESPACE = "strip";
+static const char* STRIP_BLOB_KEY = "config";
+static const uint8_t STRIP_BLOB_VERSION = 1;
+
+struct StripBlob {
+  uint8_t version;
+  StripConfig config;
+};
+
+static Preferences store;
+static LedBlob flashCopy;          // what flash holds, valid if haveFlashCopy
+static bool haveFlashCopy = false;
+static LedBlob pending;
+static bool dirty = false;
+static unsigned long lastUpdate = 0;
+static LedStoreStats stats = {0, 0, 0};
+
+static LedBlob toBlob(const LedSettings& settings) {
+  LedBlob blob;
+  blob.version = LED_BLOB_VERSION;
+  blob.on = settings.on ? 1 : 0;
+  blob.brightness = settings.brightness;
+  blob.r = settings.r;
+  blob.g = settings.g;
+  blob.b = settings.b;
+  return blob;
+}
+
+bool loadLedSettings(LedSettings& settings) {
+  store.begin(LED_NAMESPACE, true);
+  LedBlob blob;
+  bool found = store.getBytesLength(LED_BLOB_KEY) == sizeof(blob) &&
+               store.getBytes(LED_BLOB_KEY, &blob, sizeof(blob)) == sizeof(blob) &&
+               blob.version == LED_BLOB_VERSION;
+  if (found) {
+    flashCopy = blob;
+    haveFlashCopy = true;
+  } else if (store.isKey("state")) {
+    // Settings written by older firmware, one key per field. The next write
+    // replaces them with the blob.
+    uint32_t color = store.getULong("color", 0xFF0000);
+    blob.version = LED_BLOB_VERSION;
+    blob.on = store.getBool("state", false) ? 1 : 0;
+    blob.brightness = store.getUChar("brightness", 100);
+    blob.r = color >> 16;
+    blob.g = color >> 8;
+    blob.b = color;
+    found = true;
+  }
+  store.end();
+
+  if (found) {
+    settings.on = blob.on != 0;
+    settings.brightness = blob.brightness;
+    settings.r = blob.r;
+    settings.g = blob.g;
+    settings.b = blob.b;
+  }
+  return found;
+}
+
+void updateLedSettings(const LedSettings& settings) {
+  stats.updates++;
+  pending = toBlob(settings);
+  dirty = true;
+  lastUpdate = millis();
+}
+
+static void writePending() {
+  dirty = false;
+  if (haveFlashCopy && memcmp(&pending, &flashCopy, sizeof(pending)) == 0) {
+    return;
+  }
+  store.begin(LED_NAMESPACE, false);
+  if (!haveFlashCopy) {
+    store.remove("state");
+    store.remove("brightness");
+    store.remove("color");
+  }
+  if (store.putBytes(LED_BLOB_KEY, &pending, sizeof(pending)) == sizeof(pending)) {
+    flashCopy = pending;
+    haveFlashCopy = true;
+    stats.writesPerformed++;
+  } else {
+    Serial.println("Failed to save LED settings.");
+  }
+  store.end();
+}
+
+void pollLedStore() {
+  if (dirty && millis() - lastUpdate >= LED_SAVE_QUIET_PERIOD) {
+    writePending();
+  }
+}
+
+void flushLedStore() {
+  if (dirty) writePending();
+}
+
+LedStoreStats ledStoreStats() {
+  LedStoreStats snapshot = stats;
+  snapshot.writesAvoided = snapshot.updates - snapshot.writesPerformed;
+  return snapshot;
+}
+
+bool loadStripConfig(StripConfig& config) {
+  StripBlob blob;
+  store.begin(STRIP_NAMESPACE, true);
+  bool found = store.getBytesLength(STRIP_BLOB_KEY) == sizeof(blob) &&
+               store.getBytes(STRIP_BLOB_KEY, &blob, sizeof(blob)) == sizeof(blob) &&
+               blob.version == STRIP_BLOB_VERSION;
+  store.end();
+  if (found) config = blob.config;
+  return found;
+}
+
+void saveStripConfig(const StripConfig& config) {
+  StripBlob blob;
+  blob.version = STRIP_BLOB_VERSION;
+  blob.config = config;
+  store.begin(STRIP_NAMESPACE, false);
+  if (store.putBytes(STRIP_BLOB_KEY, &blob, sizeof(blob)) != sizeof(blob)) {
+    Serial.println("Failed to save strip configuration.");
+  }
+  store.end();
+}
@@ -0,0 +1,342 @@
+#include "led_timer.h"
+#include <Preferences.h>
+
+static const char* TIMER_NAMESPACE = "timer";
+static const char* RULES_BLOB_KEY = "rules";
+static const uint8_t RULES_BLOB_VERSION = 1;
+static const time_t MIN_VALID_TIME = 1700000000; // Nov 2023; anything earlier is an unset clock
+static const uint8_t SUNRISE_START_LEVEL = 1;
+// Wall time and millis() may drift apart by this much between two passes
+// before it counts as the clock being set (NTP sync, manual change)
+static const long CLOCK_JUMP_TOLERANCE = 5000; // ms
+
+static const char* const ACTION_NAMES[] = {"on", "off", "color", "brightness", "effect", "sunrise"};
+
+struct RulesBlob {
+  uint8_t version;
+  uint8_t count;
+  TimerRule rules[MAX_TIMER_RULES];
+};
+
+struct HeapEntry {
+  time_t next;
+  uint8_t rule; // index into table.rules
+};
+
+static Preferences store;
+static RulesBlob table;
+// Written by the control loop, copied out by the HTTP task
+static portMUX_TYPE tableLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Children of heap[i] are at 2i+1 and 2i+2, computed in uint8_t
+static_assert(MAX_TIMER_RULES <= 127, "heap indices are uint8_t");
+
+static HeapEntry heap[MAX_TIMER_RULES];
+static uint8_t heapSize = 0;
+static bool heapValid = false;
+
+// When serviceLedTimer() last saw the clock, to notice it being set
+static time_t lastWall = 0;
+static unsigned long lastWallMillis = 0;
+
+static void (*applyUpdate)(const LedUpdate& update) = nullptr;
+
+static time_t systemClock() {
+  return time(nullptr);
+}
+
+static TimerClock clockSource = systemClock;
+
+// Sunrise ramp in progress
+static bool fading = false;
+static unsigned long fadeStart = 0;
+static uint32_t fadeMillis = 0;
+static uint8_t fadeTarget = 0;
+static uint8_t fadeLevel = 0;
+
+void setTimerClock(TimerClock clock) {
+  clockSource = clock ? clock : systemClock;
+  heapValid = false;
+}
+
+time_t timerNow() {
+  return clockSource();
+}
+
+bool timerClockValid() {
+  return timerNow() >= MIN_VALID_TIME;
+}
+
+time_t nextFireTime(const TimerRule& rule, time_t after) {
+  if (rule.at != 0) return (time_t)rule.at > after ? (time_t)rule.at : 0;
+  if ((rule.days & TIMER_DAYS_ALL) == 0) return 0;
+
+  struct tm today;
+  localtime_r(&after, &today);
+  for (int offset = 0; offset <= 7; offset++) {
+    struct tm day = today;
+    day.tm_mday += offset;
+    day.tm_hour = rule.minute / 60;
+    day.tm_min = rule.minute % 60;
+    day.tm_sec = 0;
+    day.tm_isdst = -1;
+    time_t candidate = mktime(&day); // also normalises tm_wday
+    if (candidate > after && (rule.days & (1 << day.tm_wday))) return candidate;
+  }
+  return 0;
+}
+
+// --- Min-heap on next fire time ---
+
+static void siftDown(uint8_t i) {
+  for (;;) {
+    uint8_t smallest = i;
+    uint8_t left = 2 * i + 1, right = 2 * i + 2;
+    if (left < heapSize && heap[left].next < heap[smallest].next) smallest = left;
+    if (right < heapSize && heap[right].next < heap[smallest].next) smallest = right;
+    if (smallest == i) return;
+    HeapEntry swap = heap[i];
+    heap[i] = heap[smallest];
+    heap[smallest] = swap;
+    i = smallest;
+  }
+}
+
+static void popHeap() {
+  heap[0] = heap[--heapSize];
+  siftDown(0);
+}
+
+static void removeRule(uint8_t index);
+
+static void rebuildHeap(time_t now) {
+  heapSize = 0;
+  for (uint8_t i = 0; i < table.count; ) {
+    const TimerRule& rule = table.rules[i];
+    time_t next = nextFireTime(rule, now);
+    if (next == 0) {
+      // A one-shot rule whose time passed while the device was off or the
+      // clock was behind will never fire
+      if (rule.at != 0) removeRule(i);
+      else i++;
+      continue;
+    }
+    heap[heapSize].next = next;
+    heap[heapSize].rule = i;
+    heapSize++;
+    i++;
+  }
+  for (int i = heapSize / 2 - 1; i >= 0; i--) siftDown(i);
+  heapValid = true;
+}
+
+// --- Rule table ---
+
+static void saveRules() {
+  portENTER_CRITICAL(&tableLock);
+  RulesBlob blob = table;
+  portEXIT_CRITICAL(&tableLock);
+  // Only the used part of the table is written
+  size_t length = offsetof(RulesBlob, rules) + blob.count * sizeof(TimerRule);
+  store.begin(TIMER_NAMESPACE, false);
+  if (store.putBytes(RULES_BLOB_KEY, &blob, length) != length) {
+    Serial.println("Failed to save timer rules.");
+  }
+  store.end();
+}
+
+void beginLedTimer(void (*apply)(const LedUpdate& update)) {
+  applyUpdate = apply;
+  memset(&table, 0, sizeof(table));
+  store.begin(TIMER_NAMESPACE, true);
+  size_t length = store.getBytesLength(RULES_BLOB_KEY);
+  bool found = length >= offsetof(RulesBlob, rules) && length <= sizeof(table) &&
+               store.getBytes(RULES_BLOB_KEY, &table, length) == length &&
+               table.version == RULES_BLOB_VERSION &&
+               length == offsetof(RulesBlob, rules) + table.count * sizeof(TimerRule);
+  store.end();
+  if (!found) {
+    memset(&table, 0, sizeof(table));
+    table.version = RULES_BLOB_VERSION;
+  }
+  heapValid = false;
+}
+
+uint8_t addTimerRule(const TimerRule& rule) {
+  if (table.count == MAX_TIMER_RULES) return 0;
+  // Smallest id not in use
+  uint8_t id = 1;
+  for (bool taken = true; taken; ) {
+    taken = false;
+    for (uint8_t i = 0; i < table.count; i++) {
+      if (table.rules[i].id == id) {
+        id++;
+        taken = true;
+        break;
+      }
+    }
+  }
+  portENTER_CRITICAL(&tableLock);
+  table.rules[table.count] = rule;
+  table.rules[table.count].id = id;
+  table.count++;
+  portEXIT_CRITICAL(&tableLock);
+  saveRules();
+  heapValid = false;
+  return id;
+}
+
+static void removeRule(uint8_t index) {
+  portENTER_CRITICAL(&tableLock);
+  table.count--;
+  memmove(&table.rules[index], &table.rules[index + 1], (table.count - index) * sizeof(TimerRule));
+  portEXIT_CRITICAL(&tableLock);
+  saveRules();
+}
+
+bool deleteTimerRule(uint8_t id) {
+  for (uint8_t i = 0; i < table.count; i++) {
+    if (table.rules[i].id == id) {
+      removeRule(i);
+      heapValid = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t timerRuleCount() {
+  return table.count;
+}
+
+TimerRule timerRule(uint8_t index) {
+  portENTER_CRITICAL(&tableLock);
+  TimerRule rule = table.rules[index];
+  portEXIT_CRITICAL(&tableLock);
+  return rule;
+}
+
+// --- Firing ---
+
+void cancelTimerFade() {
+  fading = false;
+}
+
+static void fire(const TimerRule& rule) {
+  LedUpdate update;
+  memset(&update, 0, sizeof(update));
+  switch (rule.action) {
+    case TimerAction::On:
+      update.fields = STATE_ON;
+      update.on = true;
+      break;
+    case TimerAction::Off:
+      update.fields = STATE_ON;
+      update.on = false;
+      break;
+    case TimerAction::Color:
+      update.fields = STATE_COLOR;
+      update.color = rule.color;
+      break;
+    case TimerAction::Brightness:
+      update.fields = STATE_BRIGHTNESS;
+      update.brightness = rule.level;
+      break;
+    case TimerAction::Effect:
+      update.fields = STATE_EFFECT | STATE_PERIOD;
+      update.effect = (LedEffect)rule.level;
+      update.period = rule.duration;
+      break;
+    case TimerAction::Sunrise:
+      update.fields = STATE_ON | STATE_COLOR | STATE_BRIGHTNESS;
+      update.on = true;
+      update.color = rule.color;
+      update.brightness = SUNRISE_START_LEVEL;
+      fading = rule.level > SUNRISE_START_LEVEL && rule.duration > 0;
+      fadeStart = millis();
+      fadeMillis = rule.duration * 1000UL;
+      fadeTarget = rule.level;
+      fadeLevel = SUNRISE_START_LEVEL;
+      break;
+  }
+  if (rule.action != TimerAction::Sunrise) fading = false;
+  if (applyUpdate) applyUpdate(update);
+}
+
+// Brightness rises linearly; each step is applied only when the level changes.
+static void serviceFade() {
+  if (!fading) return;
+  unsigned long elapsed = millis() - fadeStart;
+  uint8_t level = elapsed >= fadeMillis ? fadeTarget
+                : SUNRISE_START_LEVEL + (uint32_t)(fadeTarget - SUNRISE_START_LEVEL) * elapsed / fadeMillis;
+  if (level == fadeLevel) return;
+  fadeLevel = level;
+  if (level == fadeTarget) fading = false;
+  LedUpdate update;
+  memset(&update, 0, sizeof(update));
+  update.fields = STATE_BRIGHTNESS;
+  update.brightness = level;
+  if (applyUpdate) applyUpdate(update);
+}
+
+// True when the wall clock moved by a different amount than millis() since
+// the last call, i.e. it was set rather than just ticking
+static bool clockJumped(time_t now) {
+  unsigned long nowMillis = millis();
+  long drift = (long)(now - lastWall) * 1000 - (long)(nowMillis - lastWallMillis);
+  bool jumped = lastWall != 0 && (drift > CLOCK_JUMP_TOLERANCE || drift < -CLOCK_JUMP_TOLERANCE);
+  lastWall = now;
+  lastWallMillis = nowMillis;
+  return jumped;
+}
+
+void serviceLedTimer() {
+  serviceFade();
+  time_t now = timerNow();
+  if (now < MIN_VALID_TIME) return;
+  // Fire times computed before the clock was set are meaningless: a jump
+  // back would delay every rule by the jump, one forward would fire all the
+  // rules in between at once
+  if (clockJumped(now)) heapValid = false;
+  if (!heapValid) rebuildHeap(now);
+
+  while (heapSize > 0 && heap[0].next <= now) {
+    uint8_t index = heap[0].rule;
+    TimerRule rule = table.rules[index];
+    fire(rule);
+    if (rule.at != 0) {
+      // One-shot rules are done. Rather than rebuilding the heap, drop the
+      // entry and renumber the ones behind it in the table.
+      popHeap();
+      removeRule(index);
+      for (uint8_t i = 0; i < heapSize; i++) {
+        if (heap[i].rule > index) heap[i].rule--;
+      }
+      continue;
+    }
+    // From now if this pass came late, so a missed occurrence fires once
+    // rather than once per occurrence missed
+    time_t next = nextFireTime(rule, max(now, heap[0].next));
+    if (next == 0) {
+      popHeap();
+    } else {
+      heap[0].next = next;
+      siftDown(0);
+    }
+  }
+}
+
+const char* timerActionName(TimerAction action) {
+  uint8_t index = (uint8_t)action;
+  return index < sizeof(ACTION_NAMES) / sizeof(ACTION_NAMES[0]) ? ACTION_NAMES[index] : "on";
+}
+
+bool parseTimerAction(const char* name, TimerAction& action) {
+  for (uint8_t i = 0; i < sizeof(ACTION_NAMES) / sizeof(ACTION_NAMES[0]); i++) {
+    if (strcmp(name, ACTION_NAMES[i]) == 0) {
+      action = (TimerAction)i;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,44 @@
+#include "loop_events.h"
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+
+// 80 MHz keeps the APB clock, and with it RMT and UART timing, unchanged
+static const int CPU_MAX_MHZ = 240;
+static const int CPU_MIN_MHZ = 80;
+
+static EventGroupHandle_t loopEvents = nullptr;
+
+void beginLoopEvents() {
+  loopEvents = xEventGroupCreate();
+}
+
+void notifyLoop(EventBits_t events) {
+  if (loopEvents) xEventGroupSetBits(loopEvents, events);
+}
+
+void IRAM_ATTR notifyLoopFromISR(EventBits_t events) {
+  if (!loopEvents) return;
+  BaseType_t woken = pdFALSE;
+  if (xEventGroupSetBitsFromISR(loopEvents, events, &woken) == pdTRUE && woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+EventBits_t waitForLoopEvents(uint32_t timeoutMs) {
+  return xEventGroupWaitBits(loopEvents, LOOP_EVENT_ALL, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeoutMs)) & LOOP_EVENT_ALL;
+}
+
+void beginPowerManagement() {
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_pm_config_t config;
+#else
+  esp_pm_config_esp32s3_t config;
+#endif
+  config.max_freq_mhz = CPU_MAX_MHZ;
+  config.min_freq_mhz = CPU_MIN_MHZ;
+  config.light_sleep_enable = LIGHT_SLEEP_ENABLED;
+  esp_err_t err = esp_pm_configure(&config);
+  if (err != ESP_OK) {
+    Serial.printf("Power management not available: %s\n", esp_err_to_name(err));
+  }
+}
@@ -1,20 +1,33 @@
 #include <WiFi.h>
-#include <WebServer.h>
 #include <time.h>
-#include <Preferences.h>
 #include <FastLED.h>
+#include "web_assets.h"
+#include "http_server.h"
+#include "response_writer.h"
+#include "wifi_scan.h"
+#include "commands.h"
+#include "led_store.h"
+#include "led_effects.h"
+#include "led_output.h"
+#include "event_stream.h"
+#include "state_api.h"
+#include "wifi_store.h"
+#include "metrics.h"
+#include "loop_events.h"
+#include "led_timer.h"
+#include "captive_portal.h"
+#include "fleet_sync.h"
+#include "ota_update.h"
+#include "pixel_stream.h"
 
-// RGB LED Configuration for ESP32-S3-DevKitC-1
-#define LED_PIN     48
-#define NUM_LEDS    1
-#define LED_TYPE    WS2812B
-#define COLOR_ORDER GRB
-CRGB leds[NUM_LEDS];
+// RGB LED Configuration for ESP32-S3-DevKitC-1 (pin and type: led_output.h)
+#define DEFAULT_NUM_LEDS 1
 
 // LED state variables
 bool ledState = false;
 uint8_t ledBrightness = 100; // 0-255
 CRGB currentColor = CRGB::Red; // Default color
+bool streamingPixels = false; // a pixel stream owns the strip (pixel_stream.h)
 
 // AP Mode Credentials
 const char* ap_ssid = "LED_CONFIG";
@@ -25,31 +38,66 @@ IPAddress local_ip(192, 168, 4, 1);
 IPAddress gateway(192, 168, 4, 1);
 IPAddress subnet(255, 255, 255, 0);
 
-WebServer server(80);
-Preferences preferences;
+HttpServer server(80);
+
+// The web server runs in its own task on the other core; everything else
+// stays in loop() and is driven through commandQueue.
+const BaseType_t WEB_SERVER_CORE = 0;
+const uint32_t WEB_SERVER_STACK_SIZE = 8192;
+SpscQueue<Command, COMMAND_QUEUE_SIZE> commandQueue;
 
 const char* ntpServer = "pool.ntp.org";
+const long GMT_OFFSET_SEC = 19800; // GMT+5:30
+// The zone configTime() sets, applied at boot so timer rules entered before
+// the first NTP sync are read as local time too
+const char* TIME_ZONE = "UTC-5:30";
 
-// WiFi credentials storage
-String sta_ssid = "";
-String sta_password = "";
+// The network being joined or connected to, one of the known networks in
+// wifi_store. Fixed buffers because the HTTP task reads them while the
+// control loop may be replacing them.
+char sta_ssid[33] = "";
+char sta_password[65] = "";
 
 // Boot button configuration
 const int BOOT_BUTTON_PIN = 0;
 const unsigned long LONG_PRESS_TIME = 3000;
 unsigned long buttonPressTime = 0;
-bool lastButtonState = HIGH;
+bool buttonHeld = false;
+volatile bool apStopped = false; // set from the WiFi event task
 
 // --- REFACTORED State Management Variables ---
 bool isConnecting = false;
 unsigned long connectionStartTime = 0;
 const unsigned long CONNECTION_TIMEOUT = 15000; // 15 seconds
+const unsigned long CANDIDATE_TIMEOUT = 10000; // per ranked network, channel and BSSID already known
+const unsigned long FAST_CONNECT_TIMEOUT = 4000; // cached link, before falling back to a scan
+unsigned long connectionTimeout = CONNECTION_TIMEOUT;
+bool fastConnectAttempt = false;
+unsigned long connectAttemptStart = 0; // unlike connectionStartTime, not reset between networks
 bool connectionAttempted = false;
 bool connectedToWiFi = false;
 
+// Known networks found by the selection scan, tried best first
+WifiCandidate candidates[MAX_KNOWN_NETWORKS];
+uint8_t candidateCount = 0;
+uint8_t nextCandidate = 0;
+bool waitingForScan = false;
+uint32_t awaitedScan = 0; // scanGeneration() when the scan was requested
+
+// Background roaming: with a weak signal, scan now and then and move to a
+// known AP that is clearly stronger.
+const unsigned long ROAM_CHECK_INTERVAL = 60000;
+const int ROAM_RSSI_THRESHOLD = -70; // dBm, no scans above this
+const int ROAM_MIN_GAIN = 10;        // dB over the current AP
+unsigned long lastRoamCheck = 0;
+bool roamScanPending = false;
+uint32_t roamScan = 0;
+int roamFrom = -1; // network to go back to if roaming fails
+
 
 // Function declarations
-String getSimplePage(String title, String content);
+void beginPage(ResponseWriter& out, const char* title);
+void endPage(ResponseWriter& out);
 void updateRGBLED();
 void loadLedState();
 void saveLedState();
@@ -58,356 +106,1514 @@ void handleToggleLed();
 void handleSetColor();
 void handleSetBrightness();
 void handleClearCredentials();
+void publishWifiState();
+
+// Page shell lives in flash (see web/ and tools/embed_assets.py). Handlers
+// stream their content between beginPage() and endPage().
+void beginPage(ResponseWriter& out, const char* title) {
+  out.begin(200, "text/html");
+  out.print(PAGE_HEAD);
+  out.print(title);
+  out.print(PAGE_NAV);
+}
+
+void endPage(ResponseWriter& out) {
+  out.print(PAGE_FOOT);
+  out.end();
+}
+
+// Serve a pre-gzipped asset. URLs are versioned with the ETag, so browsers
+// may cache them for a long time and only revalidate when it changes.
+void sendGzipAsset(const char* contentType, const char* etag, const uint8_t* data, size_t length) {
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "public, max-age=31536000");
+  if (server.header("If-None-Match") == etag) {
+    server.send(304);
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, contentType, (PGM_P)data, length);
+}
 
-// Lightweight HTML templates (Same as yours, no changes needed here but using F() macro is recommended)
-String getSimplePage(String title, String content) {
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width,initial-scale=1'>";
-  html += "<title>" + title + "</title>";
-  html += "<style>";
-  // Base styles
-  html += "body{font-family:Arial;margin:0;padding:20px;background:#f0f0f0;min-height:100vh;transition:background 0.3s;}";
-  html += ".container{max-width:600px;margin:0 auto;background:white;padding:20px;border-radius:10px;transition:background 0.3s,color 0.3s;}";
-  html += ".nav{margin-bottom:20px;} .nav a{margin-right:15px;text-decoration:none;color:#007bff;transition:color 0.3s;}";
-  html += ".status-success{background:#d4edda;color:#155724;padding:10px;border-radius:5px;margin:10px 0;}";
-  html += ".status-danger{background:#f8d7da;color:#721c24;padding:10px;border-radius:5px;margin:10px 0;}";
-  html += ".status-warning{background:#fff3cd;color:#856404;padding:10px;border-radius:5px;margin:10px 0;}";
-  html += ".network{background:#e9ecef;margin:5px 0;padding:10px;border-radius:5px;cursor:pointer;transition:background 0.3s;}";
-  html += ".network:hover{background:#dee2e6;}";
-  html += ".selected{background:#28a745;color:white;}";
-  html += "input,button{padding:8px;margin:5px 0;border:1px solid #ccc;border-radius:4px;}";
-  html += "button{background:#007bff;color:white;cursor:pointer;}";
-  html += "a{color:#007bff;text-decoration:none;}";
-  html += "a:hover{text-decoration:underline;}";
-  // Dark mode toggle styles
-  html += ".toggle-container{position:fixed;top:20px;right:20px;z-index:1000;}";
-  html += ".toggle-input{width:0;height:0;visibility:hidden;}";
-  html += ".toggle-label{width:60px;height:30px;position:relative;display:block;background:#ebebeb;border-radius:30px;box-shadow:inset 0px 2px 8px rgba(0,0,0,0.4);cursor:pointer;transition:0.3s;}";
-  html += ".toggle-label:after{content:'';width:26px;height:26px;position:absolute;top:2px;left:2px;background:linear-gradient(180deg,#ffcc89,#d8860b);border-radius:26px;box-shadow:0px 2px 5px rgba(0,0,0,0.2);transition:0.3s;}";
-  html += ".toggle-input:checked + .toggle-label{background:#242424;}";
-  html += ".toggle-input:checked + .toggle-label:after{left:32px;background:linear-gradient(180deg,#777777,#3a3a3a);}";
-  html += ".toggle-label:active:after{width:32px;}";
-  // SVG styles for toggle
-  html += ".toggle-label svg{position:absolute;width:16px;top:7px;z-index:100;transition:0.3s;}";
-  html += ".toggle-label svg.sun{left:6px;fill:#ffffff;}";
-  html += ".toggle-label svg.moon{right:6px;fill:#7e7e7e;}";
-  html += ".toggle-input:checked + .toggle-label svg.sun{fill:#7e7e7e;}";
-  html += ".toggle-input:checked + .toggle-label svg.moon{fill:#ffffff;}";
-  // Dark mode styles - using body class approach
-  html += "body.dark-mode{background:#1a1a1a;}";
-  html += "body.dark-mode .container{background:#2d2d2d;color:#ffffff;}";
-  html += "body.dark-mode .nav a{color:#66b3ff;}";
-  html += "body.dark-mode .network{background:#404040;color:#ffffff;}";
-  html += "body.dark-mode .network:hover{background:#505050;}";
-  html += "body.dark-mode input{background:#404040;color:#ffffff;border-color:#666;}";
-  html += "body.dark-mode .status-success{background:#155724;color:#d4edda;}";
-  html += "body.dark-mode .status-danger{background:#721c24;color:#f8d7da;}";
-  html += "body.dark-mode .status-warning{background:#856404;color:#fff3cd;}";
-  html += "body.dark-mode button{background:#0d6efd;border-color:#0d6efd;}";
-  html += "</style></head><body>";
-  // Add the toggle at the top
-  html += "<div class='toggle-container'>";
-  html += "<input type='checkbox' id='dark-mode' class='toggle-input'/>";
-  html += "<label for='dark-mode' class='toggle-label'>";
-  html += "<svg class='sun' viewBox='0 0 24 24' fill='none' xmlns='http://www.w3.org/2000/svg'>";
-  html += "<path d='M12 3V4M12 20V21M4 12H3M6.31412 6.31412L5.5 5.5M17.6859 6.31412L18.5 5.5M6.31412 17.69L5.5 18.5001M17.6859 17.69L18.5 18.5001M21 12H20M16 12C16 14.2091 14.2091 16 12 16C9.79086 16 8 14.2091 8 12C8 9.79086 9.79086 8 12 8C14.2091 8 16 9.79086 16 12Z' stroke='currentColor' stroke-width='2' stroke-linecap='round' stroke-linejoin='round'/>";
-  html += "</svg>";
-  html += "<svg class='moon' viewBox='0 0 24 24' fill='none' xmlns='http://www.w3.org/2000/svg'>";
-  html += "<path d='M3.32031 11.6835C3.32031 16.6541 7.34975 20.6835 12.3203 20.6835C16.1075 20.6835 19.3483 18.3443 20.6768 15.032C19.6402 15.4486 18.5059 15.6834 17.3203 15.6834C12.3497 15.6834 8.32031 11.654 8.32031 6.68342C8.32031 5.50338 8.55165 4.36259 8.96453 3.32996C5.65605 4.66028 3.32031 7.89912 3.32031 11.6835Z' stroke='currentColor' stroke-width='2' stroke-linecap='round' stroke-linejoin='round'/>";
-  html += "</svg>";
-  html += "</label>";
-  html += "</div>";
-  html += "<div class='container'>";
-  html += "<div class='nav'>";
-  html += "<a href='/'>GLOW by zamil</a>";
-  html += "<a href='/wifi-setup'>WiFi Setup</a>";
-  html += "<a href='/led'>LED Control</a>";
-  html += "<a href='/timer'>Timer</a>";
-  html += "<a href='/info'>Info</a>";
-  html += "</div>";
-  html += content;
-  html += "</div>";
-  // Add JavaScript to handle dark mode toggle
-  html += "<script>";
-  html += "const toggle = document.getElementById('dark-mode');";
-  html += "const body = document.body;";
-  html += "toggle.addEventListener('change', function() {";
-  html += "  if (this.checked) {";
-  html += "    body.classList.add('dark-mode');";
-  html += "    localStorage.setItem('darkMode', 'enabled');";
-  html += "  } else {";
-  html += "    body.classList.remove('dark-mode');";
-  html += "    localStorage.setItem('darkMode', 'disabled');";
-  html += "  }";
-  html += "});";
-  html += "if (localStorage.getItem('darkMode') === 'enabled') {";
-  html += "  body.classList.add('dark-mode');";
-  html += "  toggle.checked = true;";
-  html += "}";
-  html += "</script>";
-  html += "</body></html>";
-  return html;
-}
-
-// --- LED state functions (No changes needed) ---
+void handleAppCss() {
+  sendGzipAsset("text/css", APP_CSS_ETAG, APP_CSS_GZ, APP_CSS_GZ_LEN);
+}
+
+void handleAppJs() {
+  sendGzipAsset("application/javascript", APP_JS_ETAG, APP_JS_GZ, APP_JS_GZ_LEN);
+}
+
+// --- LED state functions ---
 void loadLedState() {
-  preferences.begin("led", true);
-  ledState = preferences.getBool("state", false);
-  ledBrightness = preferences.getUChar("brightness", 100);
-  uint32_t colorValue = preferences.getULong("color", 0xFF0000); // Default red
-  currentColor = CRGB(colorValue);
-  preferences.end();
+  LedSettings settings;
+  if (loadLedSettings(settings)) {
+    ledState = settings.on;
+    ledBrightness = settings.brightness;
+    currentColor = CRGB(settings.r, settings.g, settings.b);
+  }
   updateRGBLED();
 }
 
+// Hands the state to the LED store, which writes it once changes settle
 void saveLedState() {
-  preferences.begin("led", false);
-  preferences.putBool("state", ledState);
-  preferences.putUChar("brightness", ledBrightness);
-  preferences.putULong("color", ((uint32_t)currentColor.r << 16) | ((uint32_t)currentColor.g << 8) | currentColor.b);
-  preferences.end();
+  LedSettings settings = {ledState, ledBrightness, currentColor.r, currentColor.g, currentColor.b};
+  updateLedSettings(settings);
 }
 
+// The effects engine fades to the new state over the next frames
 void updateRGBLED() {
-  if (ledState) {
-    leds[0] = currentColor;
-    FastLED.setBrightness(ledBrightness);
-  } else {
-    leds[0] = CRGB::Black;
-  }
-  FastLED.show();
+  setLedTarget(ledState, currentColor, ledBrightness);
 }
 
 // --- Web Handlers (Mostly unchanged, using F() macro for memory) ---
 
 void handleLed() {
-  String content = "<h1>RGB LED Control</h1>";
-  content += "<p>LED is currently <strong>" + String(ledState ? "ON" : "OFF") + "</strong></p>";
-  content += "<p>Brightness: " + String(ledBrightness) + "/255</p>";
-  content += "<p>Color: RGB(" + String(currentColor.r) + ", " + String(currentColor.g) + ", " + String(currentColor.b) + ")</p>";
-  content += "<form action='/toggle-led' method='POST'><button type='submit'>" + String(ledState ? "Turn OFF" : "Turn ON") + "</button></form>";
-  content += "<hr><h3>Color Selection</h3>";
-  content += "<form action='/set-color' method='POST'>";
-  content += "<button type='submit' name='color' value='red'>Red</button>";
-  content += "<button type='submit' name='color' value='green'>Green</button>";
-  content += "<button type='submit' name='color' value='blue'>Blue</button>";
-  content += "<button type='submit' name='color' value='yellow'>Yellow</button>";
-  content += "<button type='submit' name='color' value='purple'>Purple</button>";
-  content += "<button type='submit' name='color' value='cyan'>Cyan</button>";
-  content += "<button type='submit' name='color' value='white'>White</button>";
-  content += "</form>";
-  content += "<hr><h3>Brightness Control</h3>";
-  content += "<form action='/set-brightness' method='POST'>";
-  content += "<input type='range' name='brightness' min='10' max='255' value='" + String(ledBrightness) + "'>";
-  content += "<br><button type='submit'>Set Brightness</button>";
-  content += "</form>";
-  server.send(200, "text/html", getSimplePage("LED Control", content));
+  ResponseWriter out(server);
+  beginPage(out, "LED Control");
+  out.print("<h1>RGB LED Control</h1>");
+  out.print("<p>LED is currently <strong data-live='led-state'>"); out.print(ledState ? "ON" : "OFF"); out.print("</strong></p>");
+  out.print("<p>Brightness: <span data-live='led-brightness'>"); out.print(ledBrightness); out.print("</span>/255</p>");
+  out.print("<p>Color: RGB(<span data-live='led-color'>"); out.print(currentColor.r); out.print(", "); out.print(currentColor.g); out.print(", "); out.print(currentColor.b); out.print("</span>)</p>");
+  out.print("<form action='/toggle-led' method='POST' data-ajax><button type='submit' data-live='led-toggle'>"); out.print(ledState ? "Turn OFF" : "Turn ON"); out.print("</button></form>");
+  out.print("<hr><h3>Color Selection</h3>");
+  out.print("<form action='/set-color' method='POST' data-ajax>");
+  out.print("<button type='submit' name='color' value='red'>Red</button>");
+  out.print("<button type='submit' name='color' value='green'>Green</button>");
+  out.print("<button type='submit' name='color' value='blue'>Blue</button>");
+  out.print("<button type='submit' name='color' value='yellow'>Yellow</button>");
+  out.print("<button type='submit' name='color' value='purple'>Purple</button>");
+  out.print("<button type='submit' name='color' value='cyan'>Cyan</button>");
+  out.print("<button type='submit' name='color' value='white'>White</button>");
+  out.print("</form>");
+  out.print("<hr><h3>Brightness Control</h3>");
+  out.print("<form action='/set-brightness' method='POST' data-ajax>");
+  out.print("<input type='range' name='brightness' min='10' max='255' value='"); out.print(ledBrightness); out.print("'>");
+  out.print("<br><button type='submit'>Set Brightness</button>");
+  out.print("</form>");
+  out.print("<hr><h3>Effect</h3>");
+  out.print("<p>Current effect: <span data-live='led-effect'>"); out.print(ledEffectName(currentLedEffect())); out.print("</span></p>");
+  out.print("<form action='/api/effect' method='POST' data-ajax><input type='hidden' name='redirect' value='1'>");
+  out.print("<input type='number' name='period' min='100' max='60000' value='"); out.print(currentLedEffectPeriod()); out.print("'> ms<br>");
+  out.print("<button type='submit' name='effect' value='solid'>Solid</button>");
+  out.print("<button type='submit' name='effect' value='breathe'>Breathe</button>");
+  out.print("<button type='submit' name='effect' value='rainbow'>Rainbow</button>");
+  out.print("<button type='submit' name='effect' value='blink'>Blink</button>");
+  out.print("</form>");
+  out.print("<hr><h3>Fleet</h3>");
+  out.print("<p>A leader sends its LED changes to every device in its group, and they all apply them at the same moment.</p>");
+  out.print("<form action='/api/fleet' method='POST'><input type='hidden' name='redirect' value='1'><select name='role'>");
+  for (uint8_t r = 0; r <= (uint8_t)FleetRole::Leader; r++) {
+    const char* name = fleetRoleName((FleetRole)r);
+    out.print("<option value='"); out.print(name); out.print(r == (uint8_t)fleetRole() ? "' selected>" : "'>"); out.print(name); out.print("</option>");
+  }
+  out.print("</select> Group <input type='number' name='group' min='0' max='255' value='"); out.print(fleetGroup()); out.print("'>");
+  out.print(" <small>(0 = all)</small><br><button type='submit'>Save</button></form>");
+  endPage(out);
 }
 
-void handleToggleLed() {
-  ledState = !ledState;
-  updateRGBLED();
-  saveLedState();
+// Queue a command and wake the control loop. Returns false when full.
+bool queueCommand(const Command& command) {
+  if (!commandQueue.push(command)) return false;
+  notifyLoop(LOOP_EVENT_COMMAND);
+  return true;
+}
+
+// Queue a command for the control loop. Replies 503 and returns false when
+// the queue is full so the handler can bail out.
+bool postCommand(const Command& command) {
+  if (queueCommand(command)) return true;
+  server.send(503, "text/plain", "Busy, try again");
+  return false;
+}
+
+// Plain form posts go back to the LED page. Posts made by the page script
+// (ajax=1) just get 204; the new state arrives over the event stream.
+void redirectToLedPage() {
+  if (server.hasArg("ajax")) {
+    server.send(204);
+    return;
+  }
   server.sendHeader("Location", "/led", true);
   server.send(303, "text/plain", "");
 }
 
+void handleToggleLed() {
+  Command command;
+  command.type = CommandType::ToggleLed;
+  if (!postCommand(command)) return;
+  redirectToLedPage();
+}
+
+// Accepts a colour name or hex code; anything else leaves the colour as is
 void handleSetColor() {
   if (server.hasArg("color")) {
     String color = server.arg("color");
-    if (color == "red") currentColor = CRGB::Red;
-    else if (color == "green") currentColor = CRGB::Green;
-    else if (color == "blue") currentColor = CRGB::Blue;
-    else if (color == "yellow") currentColor = CRGB::Yellow;
-    else if (color == "purple") currentColor = CRGB::Purple;
-    else if (color == "cyan") currentColor = CRGB::Cyan;
-    else if (color == "white") currentColor = CRGB::White;
-    updateRGBLED();
-    saveLedState();
+    Command command;
+    command.type = CommandType::SetColor;
+    if (parseColorText(color.c_str(), color.length(), command.color) && !postCommand(command)) return;
   }
-  server.sendHeader("Location", "/led", true);
-  server.send(303, "text/plain", "");
+  redirectToLedPage();
 }
 
 void handleSetBrightness() {
   if (server.hasArg("brightness")) {
-    ledBrightness = server.arg("brightness").toInt();
-    if (ledBrightness < 10) ledBrightness = 10;
-    if (ledBrightness > 255) ledBrightness = 255;
-    updateRGBLED();
-    saveLedState();
+    long brightness = server.arg("brightness").toInt();
+    if (brightness < 10) brightness = 10;
+    if (brightness > 255) brightness = 255;
+    Command command;
+    command.type = CommandType::SetBrightness;
+    command.brightness = (uint8_t)brightness;
+    if (!postCommand(command)) return;
   }
-  server.sendHeader("Location", "/led", true);
-  server.send(303, "text/plain", "");
+  redirectToLedPage();
+}
+
+void sendEffectJson() {
+  LedFrameStats frame = ledFrameStats();
+  ResponseWriter out(server);
+  out.begin(200, "application/json");
+  out.print("{\"effect\":\""); out.print(ledEffectName(currentLedEffect()));
+  out.print("\",\"period\":"); out.print(currentLedEffectPeriod());
+  out.print(",\"frame\":{\"interval_ms\":"); out.print(LED_FRAME_INTERVAL);
+  out.print(",\"frames\":"); out.print(frame.frames);
+  out.print(",\"shows\":"); out.print(frame.shows);
+  out.print(",\"late\":"); out.print(frame.lateFrames);
+  out.print(",\"last_us\":"); out.print(frame.lastMicros);
+  out.print(",\"avg_us\":"); out.print(frame.avgMicros);
+  out.print(",\"max_us\":"); out.print(frame.maxMicros);
+  LedOutputStats output = ledOutputStats();
+  out.print("},\"output\":{\"pixels\":"); out.print(ledCount());
+  out.print(",\"fps\":"); out.print(output.fps);
+  out.print(",\"shown\":"); out.print(output.frames);
+  out.print(",\"show_avg_us\":"); out.print(output.avgShowMicros);
+  out.print(",\"show_max_us\":"); out.print(output.maxShowMicros);
+  // Share of the loop core spent rendering, in tenths of a percent
+  out.print(",\"render_load_permille\":"); out.print(frame.avgMicros * output.fps / 1000);
+  out.print("}}");
+  out.end();
+}
+
+void handleGetEffect() {
+  sendEffectJson();
+}
+
+// POST effect=<solid|breathe|rainbow|blink>[&period=<ms>]
+void handleSetEffect() {
+  LedEffect effect;
+  if (!server.hasArg("effect") || !parseLedEffect(server.arg("effect").c_str(), effect)) {
+    server.send(400, "text/plain", "Unknown effect");
+    return;
+  }
+  long period = server.hasArg("period") ? server.arg("period").toInt() : currentLedEffectPeriod();
+  if (period < 100) period = 100;
+  if (period > 60000) period = 60000;
+
+  Command command;
+  command.type = CommandType::SetEffect;
+  command.effect.id = (uint8_t)effect;
+  command.effect.period = (uint16_t)period;
+  if (!postCommand(command)) return;
+
+  if (server.hasArg("redirect")) {
+    redirectToLedPage();
+    return;
+  }
+  server.send(202, "application/json", "{\"queued\":true}");
+}
+
+// GET /api/fleet
+void handleGetFleet() {
+  FleetStats stats = fleetStats();
+  char leader[9];
+  snprintf(leader, sizeof(leader), "%08lx", (unsigned long)stats.leader);
+  ResponseWriter out(server);
+  out.begin(200, "application/json");
+  out.print("{\"role\":\""); out.print(fleetRoleName(fleetRole()));
+  out.print("\",\"group\":"); out.print(fleetGroup());
+  out.print(",\"leader\":\""); out.print(stats.leader ? leader : "");
+  out.print("\",\"synced\":"); out.print(stats.synced ? "true" : "false");
+  out.print(",\"offset_ms\":"); out.print((long)stats.offset);
+  out.print(",\"sent\":"); out.print(stats.packetsSent);
+  out.print(",\"received\":"); out.print(stats.packetsReceived);
+  out.print(",\"duplicates\":"); out.print(stats.duplicates);
+  out.print(",\"applied\":"); out.print(stats.updatesApplied);
+  out.print(",\"late\":"); out.print(stats.lateUpdates);
+  out.print(",\"dropped\":"); out.print(stats.dropped);
+  out.print('}');
+  out.end();
+}
+
+// POST /api/fleet with role=off|follower|leader and group=0..255
+void handleSetFleet() {
+  FleetRole role = fleetRole();
+  if (server.hasArg("role") && !parseFleetRole(server.arg("role").c_str(), role)) {
+    server.send(400, "text/plain", "Unknown role");
+    return;
+  }
+  long group = server.hasArg("group") ? server.arg("group").toInt() : fleetGroup();
+  if (group < 0 || group > 255) {
+    server.send(400, "text/plain", "Group must be 0-255");
+    return;
+  }
+
+  Command command;
+  command.type = CommandType::SetFleet;
+  command.fleet.role = role;
+  command.fleet.group = (uint8_t)group;
+  if (!postCommand(command)) return;
+
+  if (server.hasArg("redirect")) {
+    redirectToLedPage();
+    return;
+  }
+  server.send(202, "application/json", "{\"queued\":true}");
+}
+
+void sendSegmentsJson() {
+  ResponseWriter out(server);
+  out.begin(200, "application/json");
+  out.print("{\"pixels\":"); out.print(ledCount());
+  out.print(",\"max_pixels\":"); out.print(MAX_LEDS);
+  out.print(",\"segments\":[");
+  for (uint8_t i = 0; i < ledSegmentCount(); i++) {
+    LedSegment segment = ledSegment(i);
+    char color[8];
+    snprintf(color, sizeof(color), "#%06lx", (unsigned long)(segment.color & 0xFFFFFF));
+    if (i > 0) out.print(',');
+    out.print("{\"start\":"); out.print(segment.start);
+    out.print(",\"length\":"); out.print(segment.length);
+    out.print(",\"color\":\""); out.print(color);
+    out.print("\",\"effect\":\""); out.print(ledEffectName(segment.effect));
+    out.print("\",\"period\":"); out.print(segment.period);
+    out.print('}');
+  }
+  out.print("]}");
+  out.end();
+}
+
+void handleGetSegments() {
+  sendSegmentsJson();
+}
+
+// Parses one "start:length:rrggbb:effect[:period]" entry and advances `p`
+// past it and its trailing comma.
+bool parseSegment(const char*& p, uint16_t pixels, LedSegment& segment) {
+  char* end;
+  unsigned long start = strtoul(p, &end, 10);
+  if (*end != ':') return false;
+  unsigned long length = strtoul(end + 1, &end, 10);
+  if (*end != ':') return false;
+  unsigned long color = strtoul(end + 1, &end, 16);
+  if (*end != ':') return false;
+
+  const char* name = end + 1;
+  size_t nameLength = strcspn(name, ":,");
+  char effectName[12];
+  if (nameLength >= sizeof(effectName)) return false;
+  memcpy(effectName, name, nameLength);
+  effectName[nameLength] = '\0';
+  LedEffect effect;
+  if (!parseLedEffect(effectName, effect)) return false;
+  p = name + nameLength;
+
+  unsigned long period = 2000;
+  if (*p == ':') {
+    period = strtoul(p + 1, &end, 10);
+    p = end;
+  }
+  if (*p == ',') p++;
+  else if (*p != '\0') return false;
+
+  if (length == 0 || start + length > pixels || color > 0xFFFFFF || period < 100 || period > 60000) {
+    return false;
+  }
+  segment.start = start;
+  segment.length = length;
+  segment.color = color;
+  segment.effect = effect;
+  segment.period = period;
+  return true;
+}
+
+// POST pixels=<count>[&segments=<start>:<length>:<rrggbb>:<effect>:<period>,...]
+// Without segments the whole strip becomes one segment using the current
+// colour and effect.
+void handleSetSegments() {
+  long pixels = server.hasArg("pixels") ? server.arg("pixels").toInt() : ledCount();
+  if (pixels < 1 || pixels > MAX_LEDS) {
+    server.send(400, "text/plain", "pixels out of range");
+    return;
+  }
+
+  Command command;
+  command.type = CommandType::SetStrip;
+  StripConfig& strip = command.strip;
+  strip.pixelCount = (uint16_t)pixels;
+  strip.segmentCount = 0;
+
+  String list = server.arg("segments");
+  const char* p = list.c_str();
+  while (*p != '\0') {
+    if (strip.segmentCount == MAX_LED_SEGMENTS) {
+      server.send(400, "text/plain", "Too many segments");
+      return;
+    }
+    if (!parseSegment(p, strip.pixelCount, strip.segments[strip.segmentCount])) {
+      server.send(400, "text/plain", "Bad segment, expected start:length:rrggbb:effect:period");
+      return;
+    }
+    strip.segmentCount++;
+  }
+  if (strip.segmentCount == 0) {
+    LedSegment& segment = strip.segments[strip.segmentCount++];
+    segment.start = 0;
+    segment.length = strip.pixelCount;
+    segment.color = ((uint32_t)currentColor.r << 16) | ((uint32_t)currentColor.g << 8) | currentColor.b;
+    segment.effect = currentLedEffect();
+    segment.period = currentLedEffectPeriod();
+  }
+
+  if (!postCommand(command)) return;
+  server.send(202, "application/json", "{\"queued\":true}");
+}
+
+// GET /api/state
+void handleGetState() {
+  char color[8];
+  snprintf(color, sizeof(color), "#%02x%02x%02x", currentColor.r, currentColor.g, currentColor.b);
+  ResponseWriter out(server);
+  out.begin(200, "application/json");
+  out.print("{\"on\":"); out.print(ledState ? "true" : "false");
+  out.print(",\"color\":\""); out.print(color);
+  out.print("\",\"rgb\":["); out.print(currentColor.r); out.print(','); out.print(currentColor.g); out.print(','); out.print(currentColor.b);
+  out.print("],\"brightness\":"); out.print(ledBrightness);
+  out.print(",\"effect\":\""); out.print(ledEffectName(currentLedEffect()));
+  out.print("\",\"period\":"); out.print(currentLedEffectPeriod());
+  out.print(",\"pixels\":"); out.print(ledCount());
+  out.print(",\"wifi\":{\"connected\":"); out.print(WiFi.status() == WL_CONNECTED ? "true" : "false");
+  out.print(",\"connecting\":"); out.print(isConnecting ? "true" : "false");
+  out.print(",\"ssid\":"); out.printJsonString(sta_ssid);
+  out.print(",\"ip\":\""); out.print(WiFi.localIP());
+  out.print("\",\"rssi\":"); out.print(WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0);
+  out.print("}}");
+  out.end();
+}
+
+void sendJsonError(int code, const char* message) {
+  ResponseWriter out(server);
+  out.begin(code, "application/json");
+  out.print("{\"error\":"); out.printJsonString(message); out.print('}');
+  out.end();
+}
+
+// PUT /api/state with one state object or an array of them (see state_api.h).
+// The whole batch is validated before anything is queued.
+void handlePutState() {
+  if (server.bodyLength() == 0) {
+    sendJsonError(400, "Expected a JSON body");
+    return;
+  }
+  StateUpdate updates[MAX_STATE_UPDATES];
+  const char* error = "";
+  int count = parseStateUpdates(server.body(), server.bodyLength(), updates, MAX_STATE_UPDATES, error);
+  if (count < 0) {
+    sendJsonError(400, error);
+    return;
+  }
+
+  size_t needed = 0;
+  for (int i = 0; i < count; i++) {
+    needed += (updates[i].led.fields != 0) + updates[i].connect;
+  }
+  if (COMMAND_QUEUE_SIZE - commandQueue.size() < needed) {
+    sendJsonError(503, "Busy, try again");
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    Command command;
+    if (updates[i].led.fields != 0) {
+      command.type = CommandType::ApplyState;
+      command.state = updates[i].led;
+      queueCommand(command);
+    }
+    if (updates[i].connect) {
+      command.type = CommandType::Connect;
+      strlcpy(command.wifi.ssid, updates[i].ssid, sizeof(command.wifi.ssid));
+      strlcpy(command.wifi.password, updates[i].password, sizeof(command.wifi.password));
+      queueCommand(command);
+    }
+  }
+  ResponseWriter out(server);
+  out.begin(202, "application/json");
+  out.print("{\"queued\":"); out.print(count); out.print('}');
+  out.end();
 }
 
 void clearStoredCredentials() {
   Serial.println("Clearing stored WiFi credentials...");
-  preferences.begin("wifi", false);
-  preferences.remove("ssid");
-  preferences.remove("password");
-  preferences.end();
+  forgetAllNetworks();
   Serial.println("Credentials cleared. Restarting...");
+  flushLedStore();
   delay(1000);
   ESP.restart();
 }
 
-void handleClearCredentials() {
+// Runs on the control loop (CommandType::ClearCredentials)
+void forgetCredentials() {
   // Disconnect from WiFi before clearing
   WiFi.disconnect(true);
-  delay(1000);
-  
-  preferences.begin("wifi", false);
-  preferences.remove("ssid");
-  preferences.remove("password");
-  preferences.end();
-  
-  sta_ssid = "";
-  sta_password = "";
+  forgetAllNetworks();
+
+  sta_ssid[0] = '\0';
+  sta_password[0] = '\0';
+  isConnecting = false;
+  waitingForScan = false;
+  candidateCount = 0;
   connectionAttempted = false;
   connectedToWiFi = false;
-  
-  String content = "<h1>Credentials Cleared</h1>";
-  content += "<div class='status-success'>";
-  content += "<p>✅ All WiFi credentials have been cleared successfully.</p>";
-  content += "<p>The device will now only operate in Access Point mode.</p>";
-  content += "<p><a href='/wifi-setup'>Setup New Connection</a></p>";
-  content += "</div>";
-  
-  server.send(200, "text/html", getSimplePage("Cleared", content));
+}
+
+void handleClearCredentials() {
+  Command command;
+  command.type = CommandType::ClearCredentials;
+  if (!postCommand(command)) return;
+
+  ResponseWriter out(server);
+  beginPage(out, "Cleared");
+  out.print("<h1>Credentials Cleared</h1>");
+  out.print("<div class='status-success'>");
+  out.print("<p>✅ All WiFi credentials have been cleared successfully.</p>");
+  out.print("<p>The device will now only operate in Access Point mode.</p>");
+  out.print("<p><a href='/wifi-setup'>Setup New Connection</a></p>");
+  out.print("</div>");
+  endPage(out);
 }
 
 
 void handleHome() {
-  String content = "<h1>ESP32 WiFi Manager</h1>";
+  ResponseWriter out(server);
+  beginPage(out, "Home");
+  out.print("<h1>ESP32 WiFi Manager</h1>");
   if (WiFi.status() == WL_CONNECTED) {
-    content += "<p><strong>WiFi Status:</strong> Connected to " + WiFi.SSID() + " (" + WiFi.localIP().toString() + ")</p>";
+    out.print("<p><strong>WiFi Status:</strong> Connected to "); out.printEscaped(WiFi.SSID()); out.print(" ("); out.print(WiFi.localIP()); out.print(")</p>");
   } else {
-    content += "<p><strong>WiFi Status:</strong> Not connected - <a href='/wifi-setup'>Configure WiFi</a></p>";
+    out.print("<p><strong>WiFi Status:</strong> Not connected - <a href='/wifi-setup'>Configure WiFi</a></p>");
   }
-  content += "<p><strong>LED Status:</strong> " + String(ledState ? "ON" : "OFF") + "</p>";
-  content += "<p><strong>AP IP Address:</strong> " + WiFi.softAPIP().toString() + "</p>";
-  server.send(200, "text/html", getSimplePage("Home", content));
+  out.print("<p><strong>LED Status:</strong> "); out.print(ledState ? "ON" : "OFF"); out.print("</p>");
+  out.print("<p><strong>AP IP Address:</strong> "); out.print(WiFi.softAPIP()); out.print("</p>");
+  endPage(out);
 }
 
 void handleWifiSetup() {
-    String content = "<h1>WiFi Setup</h1>";
+    ResponseWriter out(server);
+    beginPage(out, "WiFi Setup");
+    out.print("<h1>WiFi Setup</h1>");
 
     if (connectionAttempted) {
         if (connectedToWiFi) {
-            content += "<div class='status-success'>✅ Connected to <strong>" + sta_ssid + "</strong> (" + WiFi.localIP().toString() + ")</div>";
+            out.print("<div class='status-success'>✅ Connected to <strong>"); out.printEscaped(sta_ssid); out.print("</strong> ("); out.print(WiFi.localIP()); out.print(")</div>");
         } else {
-            content += "<div class='status-danger'>❌ Failed to connect to <strong>" + sta_ssid + "</strong>. Please check the password and try again.</div>";
+            out.print("<div class='status-danger'>❌ Failed to connect to <strong>"); out.printEscaped(sta_ssid); out.print("</strong>. Please check the password and try again.</div>");
         }
     }
 
-    if (sta_ssid.length() > 0) {
-        content += "<div class='status-warning'><p>Current stored network: <strong>" + sta_ssid + "</strong> <a href='/clear-credentials' style='margin-left:10px;'>Clear Credentials</a></p></div>";
+    uint8_t known = knownNetworkCount();
+    if (known > 0) {
+        out.print("<h3>Saved Networks</h3>");
+        for (uint8_t i = 0; i < known; i++) {
+            KnownNetwork network = knownNetwork(i);
+            out.print("<div class='network'><form action='/forget-network' method='POST' style='float:right;margin:0'>");
+            out.print("<input type='hidden' name='ssid' value='"); out.printEscaped(network.ssid); out.print("'><button type='submit'>Forget</button></form>");
+            out.print("<strong>"); out.printEscaped(network.ssid); out.print("</strong>");
+            if (connectedToWiFi && strcmp(network.ssid, sta_ssid) == 0) out.print(" (connected)");
+            out.print("<br><small>"); out.print(network.successes); out.print(" connects, "); out.print(network.failures); out.print(" failures");
+            if (network.successes > 0) {
+                out.print(", avg "); out.print(network.avgConnectMillis); out.print(" ms, last in boot "); out.print(network.lastBoot);
+            }
+            out.print("</small></div>");
+        }
+        out.print("<p><a href='/clear-credentials'>Clear All Credentials</a></p>");
+    }
+
+    out.print("<h3>Available Networks</h3>");
+    out.print("<button onclick='loadNetworks()'>Scan for Networks</button>");
+    out.print("<div id='scan-results' style='margin-top:10px;'></div>");
+
+    out.print("<div id='connection-form' style='display:none; margin-top:20px;'>");
+    out.print("<h3>Connect to <span id='selected-ssid'></span></h3>");
+    out.print("<form action='/connect' method='POST'>");
+    out.print("<input type='hidden' id='ssid' name='ssid'>");
+    out.print("<input type='password' name='password' placeholder='WiFi Password' required>");
+    out.print("<button type='submit'>Connect</button>");
+    out.print("</form></div>");
+
+    endPage(out);
+}
+
+// Known networks with their connect history (never the passwords)
+void handleNetworksJson() {
+    ResponseWriter out(server);
+    out.begin(200, "application/json");
+    out.print("{\"current\":"); out.printJsonString(connectedToWiFi ? sta_ssid : "");
+    out.print(",\"networks\":[");
+    uint8_t known = knownNetworkCount();
+    for (uint8_t i = 0; i < known; i++) {
+        KnownNetwork network = knownNetwork(i);
+        if (i > 0) out.print(',');
+        out.print("{\"ssid\":"); out.printJsonString(network.ssid);
+        out.print(",\"successes\":"); out.print(network.successes);
+        out.print(",\"failures\":"); out.print(network.failures);
+        out.print(",\"avgConnectMs\":"); out.print(network.avgConnectMillis);
+        out.print(",\"lastBoot\":"); out.print(network.lastBoot);
+        out.print('}');
+    }
+    out.print("],\"max\":"); out.print(MAX_KNOWN_NETWORKS);
+    out.print('}');
+    out.end();
+}
+
+void handleForgetNetwork() {
+    if (!server.hasArg("ssid")) {
+        server.send(400, "text/plain", "Bad Request");
+        return;
     }
+    Command command;
+    command.type = CommandType::ForgetNetwork;
+    strlcpy(command.wifi.ssid, server.arg("ssid").c_str(), sizeof(command.wifi.ssid));
+    if (!postCommand(command)) return;
+    server.sendHeader("Location", "/wifi-setup");
+    server.send(303);
+}
 
-    content += "<h3>Available Networks</h3>";
-    content += "<button onclick='loadNetworks()'>Scan for Networks</button>";
-    content += "<div id='scan-results' style='margin-top:10px;'></div>";
-    
-    content += "<div id='connection-form' style='display:none; margin-top:20px;'>";
-    content += "<h3>Connect to <span id='selected-ssid'></span></h3>";
-    content += "<form action='/connect' method='POST'>";
-    content += "<input type='hidden' id='ssid' name='ssid'>";
-    content += "<input type='password' name='password' placeholder='WiFi Password' required>";
-    content += "<button type='submit'>Connect</button>";
-    content += "</form></div>";
-    
-    content += "<script>";
-    content += "function selectNetwork(ssid){document.getElementById('selected-ssid').textContent=ssid;document.getElementById('ssid').value=ssid;document.getElementById('connection-form').style.display='block';document.querySelectorAll('.network').forEach(n=>n.classList.remove('selected'));event.currentTarget.classList.add('selected');}";
-    content += "function loadNetworks(){const e=document.getElementById('scan-results');e.innerHTML='Scanning...';fetch('/scan').then(r=>r.text()).then(d=>e.innerHTML=d).catch(err=>e.innerHTML='Scan failed.');}";
-    content += "</script>";
-
-    server.send(200, "text/html", getSimplePage("WiFi Setup", content));
+void requestScan() {
+    // A full queue just means the scan starts on the client's next poll
+    Command command;
+    command.type = CommandType::StartScan;
+    queueCommand(command);
 }
 
+// Answers from the scan cache. When it is stale a background scan is
+// started and the client is told to poll again.
 void handleScan() {
-    String content = "";
-    int n = WiFi.scanNetworks();
-    if (n == 0) {
-        content = "No networks found.";
-    } else {
-        for (int i = 0; i < n; ++i) {
-            String ssid = WiFi.SSID(i);
-            int rssi = WiFi.RSSI(i);
-            String security = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? "Open" : "Secured";
-            content += "<div class='network' onclick='selectNetwork(\"" + ssid + "\")'>";
-            content += "<strong>" + ssid + "</strong> (" + String(rssi) + " dBm) - " + security;
-            content += "</div>";
-        }
+    if (!isScanCacheFresh()) {
+        requestScan();
+        server.sendHeader("Retry-After", "1");
+        server.send(202, "text/plain", "scanning");
+        return;
+    }
+    ResponseWriter out(server);
+    out.begin(200, "text/plain");
+    if (scanResultCount() == 0) {
+        out.print("No networks found.");
+    }
+    for (size_t i = 0; i < scanResultCount(); ++i) {
+        ScanResult network = scanResult(i);
+        // The SSID only ever appears as entity-escaped text: the click handler
+        // reads it back from data-ssid, so it is never parsed as script.
+        out.print("<div class='network' data-ssid=\""); out.printEscaped(network.ssid); out.print("\" onclick='selectNetwork(this)'>");
+        out.print("<strong>"); out.printEscaped(network.ssid); out.print("</strong> ("); out.print(network.rssi); out.print(" dBm) - ");
+        out.print(network.open ? "Open" : "Secured");
+        out.print("</div>");
     }
-    server.send(200, "text/plain", content);
+    out.end();
 }
 
+// Same cache as JSON for the setup page to render. While a refresh is in
+// progress the previous results are returned with status 202.
+void handleScanJson() {
+    bool fresh = isScanCacheFresh();
+    if (!fresh) {
+        requestScan();
+        server.sendHeader("Retry-After", "1");
+    }
+    ResponseWriter out(server);
+    out.begin(fresh ? 200 : 202, "application/json");
+    out.print("{\"scanning\":"); out.print(isWifiScanning() ? "true" : "false");
+    out.print(",\"age\":"); out.print(scanCacheAge());
+    out.print(",\"networks\":[");
+    for (size_t i = 0; i < scanResultCount(); ++i) {
+        ScanResult network = scanResult(i);
+        if (i > 0) out.print(',');
+        out.print("{\"ssid\":"); out.printJsonString(network.ssid);
+        out.print(",\"rssi\":"); out.print(network.rssi);
+        out.print(",\"ch\":"); out.print(network.channel);
+        out.print(",\"open\":"); out.print(network.open ? "true" : "false");
+        out.print('}');
+    }
+    out.print("]}");
+    out.end();
+}
 
-void handleConnect() {
-  if (server.hasArg("ssid") && server.hasArg("password")) {
-    sta_ssid = server.arg("ssid");
-    sta_password = server.arg("password");
-
-    Serial.println("New credentials received for: " + sta_ssid);
-    preferences.begin("wifi", false);
-    preferences.putString("ssid", sta_ssid);
-    preferences.putString("password", sta_password);
-    preferences.end();
-    
-    // --- FIX: Start the connection attempt HERE, only ONCE ---
+
+void selectNetwork(int index) {
+  KnownNetwork network = knownNetwork(index);
+  strlcpy(sta_ssid, network.ssid, sizeof(sta_ssid));
+  strlcpy(sta_password, network.password, sizeof(sta_password));
+}
+
+// Joins the cached AP directly on its channel, with its DHCP lease as a
+// static config, skipping both the channel scan and DHCP.
+void startFastConnect(const WifiLink& link) {
+  fastConnectAttempt = true;
+  connectionStartTime = millis();
+  connectionTimeout = FAST_CONNECT_TIMEOUT;
+  WiFi.config(IPAddress(link.ip), IPAddress(link.gateway), IPAddress(link.subnet), IPAddress(link.dns1), IPAddress(link.dns2));
+  WiFi.begin(sta_ssid, sta_password, link.channel, link.bssid);
+}
+
+// Lets the driver find the AP, on the given channel/BSSID when a scan saw it.
+void startFullConnect(unsigned long timeout, int32_t channel = 0, const uint8_t* bssid = nullptr) {
+  fastConnectAttempt = false;
+  connectionStartTime = millis();
+  connectionTimeout = timeout;
+  WiFi.config(IPAddress(), IPAddress(), IPAddress()); // back to DHCP
+  WiFi.begin(sta_ssid, sta_password, channel, bssid);
+}
+
+// Returns false once every candidate has been tried.
+bool tryNextCandidate() {
+  while (nextCandidate < candidateCount) {
+    const WifiCandidate& candidate = candidates[nextCandidate++];
+    if (candidate.network >= knownNetworkCount()) continue; // forgotten meanwhile
+    selectNetwork(candidate.network);
+    Serial.printf("Trying %s (%d dBm)\n", sta_ssid, candidate.rssi);
+    WiFi.disconnect();
+    startFullConnect(CANDIDATE_TIMEOUT, candidate.channel, candidate.bssid);
+    return true;
+  }
+  return false;
+}
+
+void tryRankedNetworks() {
+  waitingForScan = false;
+  candidateCount = rankKnownNetworks(candidates, MAX_KNOWN_NETWORKS);
+  nextCandidate = 0;
+  if (tryNextCandidate()) return;
+
+  // Nothing known in range, or a hidden network: try the last one used
+  int preferred = preferredKnownNetwork();
+  if (preferred < 0) return;
+  selectNetwork(preferred);
+  Serial.printf("No known network found by the scan, trying %s\n", sta_ssid);
+  startFullConnect(CONNECTION_TIMEOUT);
+}
+
+// One scan ranks the known networks; monitorConnection() tries them once it
+// completes.
+void beginNetworkSelection() {
+  isConnecting = true;
+  fastConnectAttempt = false;
+  connectionStartTime = millis();
+  connectionTimeout = SCAN_MAX_DURATION + 1000; // pollWifiScan() gives up first
+  candidateCount = 0;
+  waitingForScan = requestWifiScan();
+  awaitedScan = scanGeneration();
+  if (!waitingForScan) tryRankedNetworks();
+}
+
+// Boot: straight to the last network if its link is cached, otherwise pick
+// from a scan.
+void connectToKnownNetworks() {
+  int preferred = preferredKnownNetwork();
+  if (preferred < 0) return;
+  selectNetwork(preferred);
+  isConnecting = true;
+  candidateCount = 0;
+  connectAttemptStart = millis();
+  WifiLink link;
+  if (loadWifiLink(sta_ssid, link)) {
+    startFastConnect(link);
+  } else {
+    beginNetworkSelection();
+  }
+}
+
+void saveCurrentWifiLink() {
+  WifiLink link;
+  memcpy(link.bssid, WiFi.BSSID(), sizeof(link.bssid));
+  link.channel = WiFi.channel();
+  link.ip = WiFi.localIP();
+  link.gateway = WiFi.gatewayIP();
+  link.subnet = WiFi.subnetMask();
+  link.dns1 = WiFi.dnsIP(0);
+  link.dns2 = WiFi.dnsIP(1);
+  saveWifiLink(sta_ssid, link);
+}
+
+// Called from loop() while a connection attempt is running
+void monitorConnection() {
+  if (waitingForScan) {
+    if (scanGeneration() != awaitedScan) tryRankedNetworks();
+    else if (millis() - connectionStartTime > connectionTimeout) tryRankedNetworks();
+    return;
+  }
+
+  if (WiFi.status() == WL_CONNECTED) {
+    Serial.println("");
+    Serial.println("✅ WiFi Connected!");
+    Serial.print("IP Address: ");
+    Serial.println(WiFi.localIP());
+    unsigned long elapsed = millis() - connectAttemptStart;
+    Serial.printf("Connected in %lu ms (%s)\n", elapsed, fastConnectAttempt ? "cached link" : "full scan");
+    isConnecting = false;
+    connectedToWiFi = true;
+    candidateCount = 0;
+    roamFrom = -1;
+    recordConnect(elapsed, fastConnectAttempt, true);
+    countWifiConnect(true);
+    noteConnectResult(sta_ssid, true, elapsed);
+    saveCurrentWifiLink();
+    configTime(GMT_OFFSET_SEC, 0, ntpServer);
+    publishWifiState();
+    return;
+  }
+  if (millis() - connectionStartTime <= connectionTimeout) return;
+
+  if (fastConnectAttempt) {
+    Serial.println("Cached WiFi link failed, scanning for known networks.");
+    clearWifiLink();
+    WiFi.disconnect();
+    beginNetworkSelection();
+    return;
+  }
+  noteConnectResult(sta_ssid, false, 0);
+  if (tryNextCandidate()) return;
+  if (roamFrom >= 0 && roamFrom < knownNetworkCount()) {
+    Serial.println("Roaming failed, going back.");
+    selectNetwork(roamFrom);
+    roamFrom = -1;
+    WiFi.disconnect();
+    startFullConnect(CONNECTION_TIMEOUT);
+    return;
+  }
+
+  Serial.println("❌ Connection failed (timeout).");
+  isConnecting = false;
+  connectedToWiFi = false;
+  recordConnect(millis() - connectAttemptStart, false, false);
+  countWifiConnect(false);
+  publishWifiState();
+
+  // Disconnect cleanly and forcefully restart the AP to ensure it's available.
+  WiFi.disconnect(true);
+  delay(100);
+  WiFi.mode(WIFI_AP_STA);
+  WiFi.softAP(ap_ssid, ap_password);
+  WiFi.softAPConfig(local_ip, gateway, subnet);
+  Serial.println("AP has been re-initialized to ensure availability.");
+}
+
+// Called from loop() while connected. Costs one RSSI read a minute unless
+// the signal is weak.
+void serviceRoaming() {
+  if (!connectedToWiFi || WiFi.status() != WL_CONNECTED) {
+    roamScanPending = false;
+    return;
+  }
+  if (roamScanPending) {
+    if (scanGeneration() == roamScan) return;
+    roamScanPending = false;
+    int current = WiFi.RSSI();
+    candidateCount = rankKnownNetworks(candidates, MAX_KNOWN_NETWORKS);
+    if (candidateCount == 0 || candidates[0].rssi < current + ROAM_MIN_GAIN ||
+        memcmp(candidates[0].bssid, WiFi.BSSID(), sizeof(candidates[0].bssid)) == 0) {
+      candidateCount = 0;
+      return;
+    }
+    Serial.printf("Roaming from %d dBm to %s (%d dBm)\n", current, knownNetwork(candidates[0].network).ssid, candidates[0].rssi);
+    roamFrom = findKnownNetwork(sta_ssid);
     isConnecting = true;
-    connectionStartTime = millis();
-    connectionAttempted = true; 
     connectedToWiFi = false;
-    WiFi.begin(sta_ssid.c_str(), sta_password.c_str());
-    Serial.println("Connection attempt started immediately.");
+    connectAttemptStart = millis();
+    nextCandidate = 0;
+    tryNextCandidate();
+    publishWifiState();
+    return;
+  }
+  if (millis() - lastRoamCheck < ROAM_CHECK_INTERVAL) return;
+  lastRoamCheck = millis();
+  if (WiFi.RSSI() >= ROAM_RSSI_THRESHOLD) return;
+  roamScanPending = requestWifiScan();
+  roamScan = scanGeneration();
+}
+
+// Runs on the control loop (CommandType::Connect)
+void connectWithNewCredentials(const char* ssid, const char* password) {
+  Serial.printf("New credentials received for: %s\n", ssid);
+  rememberNetwork(ssid, password);
+  strlcpy(sta_ssid, ssid, sizeof(sta_ssid));
+  strlcpy(sta_password, password, sizeof(sta_password));
+
+  // --- FIX: Start the connection attempt HERE, only ONCE ---
+  connectionAttempted = true;
+  connectedToWiFi = false;
+  isConnecting = true;
+  waitingForScan = false;
+  candidateCount = 0;
+  roamFrom = -1;
+  connectAttemptStart = millis();
+  WiFi.disconnect();
+  WifiLink link;
+  if (loadWifiLink(sta_ssid, link)) {
+    startFastConnect(link);
+  } else {
+    startFullConnect(CONNECTION_TIMEOUT);
+  }
+  Serial.println("Connection attempt started immediately.");
+}
+
+void handleConnect() {
+  if (server.hasArg("ssid") && server.hasArg("password")) {
+    Command command;
+    command.type = CommandType::Connect;
+    strlcpy(command.wifi.ssid, server.arg("ssid").c_str(), sizeof(command.wifi.ssid));
+    strlcpy(command.wifi.password, server.arg("password").c_str(), sizeof(command.wifi.password));
+    if (!postCommand(command)) return;
 
     // Send a response page immediately
-    String content = "<h1>Connecting...</h1>";
-    content += "<p>Attempting to connect to <strong>" + sta_ssid + "</strong>. The device will connect within 15 seconds.</p>";
-    content += "<p>If connection succeeds, you can access this device at its new IP address. If it fails, the configuration AP will remain active.</p>";
-    content += "<p>Page will redirect in 5 seconds...</p>";
-    content += "<script>setTimeout(() => { window.location.href = '/wifi-setup'; }, 5000);</script>";
-    server.send(200, "text/html", getSimplePage("Connecting", content));
+    ResponseWriter out(server);
+    beginPage(out, "Connecting");
+    out.print("<h1>Connecting...</h1>");
+    out.print("<p>Attempting to connect to <strong>"); out.printEscaped(command.wifi.ssid); out.print("</strong>. The device will connect within 15 seconds.</p>");
+    out.print("<p>If connection succeeds, you can access this device at its new IP address. If it fails, the configuration AP will remain active.</p>");
+    out.print("<p data-live='wifi-status'>Waiting for the connection result...</p>");
+    // Fallback in case the event stream is not reachable
+    out.print("<script>setTimeout(() => { window.location.href = '/wifi-setup'; }, 20000);</script>");
+    endPage(out);
+  } else {
+    server.send(400, "text/plain", "Bad Request");
+  }
+}
+
+// --- Timer ---
+const char* const DAY_NAMES[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+void printTime(ResponseWriter& out, time_t when, const char* format) {
+  struct tm local;
+  localtime_r(&when, &local);
+  char text[32];
+  strftime(text, sizeof(text), format, &local);
+  out.print(text);
+}
+
+void printHexColor(ResponseWriter& out, uint32_t color) {
+  char text[8];
+  snprintf(text, sizeof(text), "#%06lx", (unsigned long)(color & 0xFFFFFF));
+  out.print(text);
+}
+
+// "Weekdays 07:00: sunrise to #ff8000 at 200 over 30 min"
+void printTimerRule(ResponseWriter& out, const TimerRule& rule) {
+  if (rule.at != 0) {
+    out.print("Once "); printTime(out, rule.at, "%Y-%m-%d %H:%M");
+  } else {
+    if (rule.days == TIMER_DAYS_ALL) out.print("Daily");
+    else if (rule.days == TIMER_DAYS_WEEKDAYS) out.print("Weekdays");
+    else if (rule.days == (TIMER_DAYS_ALL & ~TIMER_DAYS_WEEKDAYS)) out.print("Weekends");
+    else {
+      bool first = true;
+      for (uint8_t d = 0; d < 7; d++) {
+        if (!(rule.days & (1 << d))) continue;
+        if (!first) out.print(", ");
+        out.print(DAY_NAMES[d]);
+        first = false;
+      }
+    }
+    char text[16];
+    snprintf(text, sizeof(text), " %02u:%02u", rule.minute / 60, rule.minute % 60);
+    out.print(text);
+  }
+  out.print(": "); out.print(timerActionName(rule.action));
+  switch (rule.action) {
+    case TimerAction::Color:
+      out.print(' '); printHexColor(out, rule.color);
+      break;
+    case TimerAction::Brightness:
+      out.print(' '); out.print(rule.level);
+      break;
+    case TimerAction::Effect:
+      out.print(' '); out.print(ledEffectName((LedEffect)rule.level));
+      out.print(" ("); out.print(rule.duration); out.print(" ms)");
+      break;
+    case TimerAction::Sunrise:
+      out.print(" to "); printHexColor(out, rule.color); out.print(" at "); out.print(rule.level);
+      out.print(" over "); out.print(rule.duration / 60); out.print(" min");
+      break;
+    default:
+      break;
+  }
+}
+
+void handleTimer() {
+  ResponseWriter out(server);
+  beginPage(out, "Timer");
+  out.print("<h1>Timer</h1>");
+  time_t now = timerNow();
+  if (timerClockValid()) {
+    out.print("<p><strong>Device time:</strong> "); printTime(out, now, "%a %d %b %Y %H:%M"); out.print("</p>");
+  } else {
+    out.print("<div class='status-warning'>The clock is not set yet. Rules run once the device is online and has synced with NTP.</div>");
+  }
+
+  out.print("<h3>Rules</h3>");
+  uint8_t count = timerRuleCount();
+  if (count == 0) out.print("<p>No rules yet.</p>");
+  for (uint8_t i = 0; i < count; i++) {
+    TimerRule rule = timerRule(i);
+    out.print("<div class='network'><form action='/timer/delete' method='POST' style='float:right;margin:0'>");
+    out.print("<input type='hidden' name='id' value='"); out.print(rule.id); out.print("'><button type='submit'>Delete</button></form>");
+    printTimerRule(out, rule);
+    time_t next = timerClockValid() ? nextFireTime(rule, now) : 0;
+    if (next != 0) {
+      out.print("<br><small>Next: "); printTime(out, next, "%a %d %b %H:%M"); out.print("</small>");
+    }
+    out.print("</div>");
+  }
+
+  out.print("<h3>Add Rule</h3>");
+  out.print("<form action='/timer/add' method='POST'>");
+  out.print("<input type='time' name='time' required> <input type='date' name='date'><br>");
+  out.print("<small>Leave the date empty to repeat on the days ticked below (none ticked = daily).</small><br>");
+  for (uint8_t d = 0; d < 7; d++) {
+    out.print("<label><input type='checkbox' name='d"); out.print(d); out.print("'>"); out.print(DAY_NAMES[d]); out.print("</label> ");
+  }
+  out.print("<br><select name='action'>");
+  for (uint8_t a = 0; a <= (uint8_t)TimerAction::Sunrise; a++) {
+    const char* name = timerActionName((TimerAction)a);
+    out.print("<option value='"); out.print(name); out.print("'>"); out.print(name); out.print("</option>");
+  }
+  out.print("</select> <input type='color' name='color' value='#ff8000'>");
+  out.print(" Brightness <input type='number' name='level' min='1' max='255' value='255'><br>");
+  out.print("Effect <select name='effect'>");
+  for (uint8_t e = 0; e <= (uint8_t)LedEffect::Blink; e++) {
+    const char* name = ledEffectName((LedEffect)e);
+    out.print("<option value='"); out.print(name); out.print("'>"); out.print(name); out.print("</option>");
+  }
+  out.print("</select> <input type='number' name='period' min='100' max='60000' value='2000'> ms");
+  out.print(" Sunrise <input type='number' name='fade' min='1' max='240' value='30'> min<br>");
+  out.print("<button type='submit'>Add</button></form>");
+  endPage(out);
+}
+
+// POST /timer/add: time=HH:MM, optional date=YYYY-MM-DD (one-shot), d0..d6
+// weekday boxes, action, color, level, effect, period (ms), fade (minutes)
+void handleAddTimer() {
+  TimerRule rule;
+  memset(&rule, 0, sizeof(rule));
+  unsigned hour, minute;
+  if (sscanf(server.arg("time").c_str(), "%u:%u", &hour, &minute) != 2 || hour > 23 || minute > 59 ||
+      !parseTimerAction(server.arg("action").c_str(), rule.action)) {
+    server.send(400, "text/plain", "Expected time=HH:MM and a valid action");
+    return;
+  }
+  rule.minute = hour * 60 + minute;
+
+  String date = server.arg("date");
+  if (date.length() > 0) {
+    struct tm local;
+    memset(&local, 0, sizeof(local));
+    if (sscanf(date.c_str(), "%d-%d-%d", &local.tm_year, &local.tm_mon, &local.tm_mday) != 3) {
+      server.send(400, "text/plain", "Expected date=YYYY-MM-DD");
+      return;
+    }
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_isdst = -1;
+    time_t at = mktime(&local);
+    if (at <= 0 || (timerClockValid() && at <= timerNow())) {
+      server.send(400, "text/plain", "That time has already passed");
+      return;
+    }
+    rule.at = at;
   } else {
+    for (uint8_t d = 0; d < 7; d++) {
+      char name[3] = {'d', (char)('0' + d), '\0'};
+      if (server.hasArg(name)) rule.days |= 1 << d;
+    }
+    if (rule.days == 0) rule.days = TIMER_DAYS_ALL;
+  }
+
+  String color = server.arg("color");
+  if (!parseColorText(color.c_str(), color.length(), rule.color)) rule.color = 0xFF8000;
+  rule.level = constrain(server.hasArg("level") ? server.arg("level").toInt() : 255L, 1L, 255L);
+  if (rule.action == TimerAction::Effect) {
+    LedEffect effect;
+    if (!parseLedEffect(server.arg("effect").c_str(), effect)) {
+      server.send(400, "text/plain", "Unknown effect");
+      return;
+    }
+    rule.level = (uint8_t)effect;
+    rule.duration = constrain(server.hasArg("period") ? server.arg("period").toInt() : 2000L, 100L, 60000L);
+  } else if (rule.action == TimerAction::Sunrise) {
+    rule.duration = constrain(server.hasArg("fade") ? server.arg("fade").toInt() : 30L, 1L, 240L) * 60;
+  }
+
+  Command command;
+  command.type = CommandType::AddTimer;
+  command.timer = rule;
+  if (!postCommand(command)) return;
+  server.sendHeader("Location", "/timer");
+  server.send(303);
+}
+
+void handleDeleteTimer() {
+  long id = server.arg("id").toInt();
+  if (id <= 0 || id > 255) {
     server.send(400, "text/plain", "Bad Request");
+    return;
+  }
+  Command command;
+  command.type = CommandType::DeleteTimer;
+  command.timerId = id;
+  if (!postCommand(command)) return;
+  server.sendHeader("Location", "/timer");
+  server.send(303);
+}
+
+void handleTimersJson() {
+  time_t now = timerNow();
+  bool valid = timerClockValid();
+  ResponseWriter out(server);
+  out.begin(200, "application/json");
+  out.print("{\"now\":"); out.print((unsigned long)now);
+  out.print(",\"clockValid\":"); out.print(valid ? "true" : "false");
+  out.print(",\"rules\":[");
+  uint8_t count = timerRuleCount();
+  for (uint8_t i = 0; i < count; i++) {
+    TimerRule rule = timerRule(i);
+    if (i > 0) out.print(',');
+    out.print("{\"id\":"); out.print(rule.id);
+    out.print(",\"at\":"); out.print((unsigned long)rule.at);
+    out.print(",\"minute\":"); out.print(rule.minute);
+    out.print(",\"days\":"); out.print(rule.days);
+    out.print(",\"action\":\""); out.print(timerActionName(rule.action));
+    out.print("\",\"color\":\""); printHexColor(out, rule.color);
+    out.print("\",\"level\":"); out.print(rule.level);
+    out.print(",\"duration\":"); out.print(rule.duration);
+    out.print(",\"next\":"); out.print((unsigned long)(valid ? nextFireTime(rule, now) : 0));
+    out.print('}');
   }
+  out.print("]}");
+  out.end();
 }
 
 void handleInfo() {
-  String content = "<h1>System Information</h1>";
-  content += "<h3>Station Mode</h3>";
-  content += "<p><strong>Status:</strong> " + String(WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected") + "</p>";
+  ResponseWriter out(server);
+  beginPage(out, "Info");
+  out.print("<h1>System Information</h1>");
+  out.print("<h3>Station Mode</h3>");
+  out.print("<p><strong>Status:</strong> "); out.print(WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected"); out.print("</p>");
   if (WiFi.status() == WL_CONNECTED) {
-    content += "<p><strong>Network:</strong> " + WiFi.SSID() + "</p>";
-    content += "<p><strong>IP:</strong> " + WiFi.localIP().toString() + "</p>";
+    out.print("<p><strong>Network:</strong> "); out.printEscaped(WiFi.SSID()); out.print("</p>");
+    out.print("<p><strong>IP:</strong> "); out.print(WiFi.localIP()); out.print("</p>");
+  }
+  uint8_t connects = connectLogCount();
+  if (connects > 0) {
+    out.print("<p><strong>Recent Connects:</strong></p><ul>");
+    for (uint8_t i = 0; i < connects; i++) {
+      ConnectRecord record = connectLogEntry(i);
+      out.print("<li>Boot "); out.print(record.boot); out.print(": ");
+      if (record.ok) {
+        out.print(record.millis); out.print(" ms"); out.print(record.fast ? " (cached link)" : " (full scan)");
+      } else {
+        out.print("failed after "); out.print(record.millis); out.print(" ms");
+      }
+      out.print("</li>");
+    }
+    out.print("</ul>");
   }
-  content += "<h3>Access Point</h3>";
-  content += "<p><strong>SSID:</strong> " + String(ap_ssid) + "</p>";
-  content += "<p><strong>IP:</strong> " + WiFi.softAPIP().toString() + "</p>";
-  content += "<h3>System</h3>";
-  content += "<p><strong>Free Memory:</strong> " + String(ESP.getFreeHeap()) + " bytes</p>";
-  content += "<p><strong>Uptime:</strong> " + String(millis() / 1000) + " seconds</p>";
-  server.send(200, "text/html", getSimplePage("Info", content));
+  out.print("<h3>Access Point</h3>");
+  out.print("<p><strong>SSID:</strong> "); out.print(ap_ssid); out.print("</p>");
+  out.print("<p><strong>IP:</strong> "); out.print(WiFi.softAPIP()); out.print("</p>");
+  out.print("<h3>System</h3>");
+  out.print("<p><strong>Free Memory:</strong> <span data-live='heap-free'>"); out.print(ESP.getFreeHeap()); out.print("</span> bytes</p>");
+  out.print("<p><strong>Uptime:</strong> "); out.print(millis() / 1000); out.print(" seconds</p>");
+  LedStoreStats ledStats = ledStoreStats();
+  LedFrameStats frame = ledFrameStats();
+  LedOutputStats output = ledOutputStats();
+  out.print("<p><strong>LED Strip:</strong> "); out.print(ledCount()); out.print(" pixels, "); out.print(ledSegmentCount()); out.print(" segments, "); out.print(output.fps); out.print(" fps</p>");
+  out.print("<p><strong>LED Frame Time:</strong> render "); out.print(frame.avgMicros); out.print(" us avg, "); out.print(frame.maxMicros); out.print(" us max; show "); out.print(output.avgShowMicros); out.print(" us avg ("); out.print(frame.lateFrames); out.print(" late frames)</p>");
+  PixelStreamStats stream = pixelStreamStats();
+  out.print("<p><strong>Pixel Stream:</strong> "); out.print(stream.active ? "active" : "idle"); out.print(" ("); out.print(pixelProtocolName(stream.protocol)); out.print("), ");
+  out.print(stream.frames); out.print(" frames shown, "); out.print(stream.framesDropped); out.print(" dropped; ");
+  out.print(stream.packets); out.print(" packets, "); out.print(stream.packetsDropped); out.print(" dropped, "); out.print(stream.packetsLost); out.print(" lost</p>");
+  out.print("<p><strong>LED Settings Saves:</strong> "); out.print(ledStats.writesPerformed); out.print(" written, "); out.print(ledStats.writesAvoided); out.print(" avoided</p>");
+  endPage(out);
 }
 
 
+// Redirect to the setup page, which makes phones show their sign-in sheet
+void redirectToPortal() {
+  server.sendHeader("Location", String("http://") + local_ip.toString() + "/wifi-setup");
+  server.sendHeader("Cache-Control", "no-store");
+  server.send(302);
+}
+
+void handleCaptiveProbe() {
+  countCaptiveProbe();
+  redirectToPortal();
+}
+
 void handleNotFound() {
+  // Every name resolves to us on the AP, so a request for some other host is
+  // a browser that wanted the internet: send it to the portal instead
+  if (server.localIP() == local_ip && server.hostHeader() != local_ip.toString()) {
+    redirectToPortal();
+    return;
+  }
   server.send(404, "text/plain", "Not Found");
 }
 
-void handleBootButton() {
-  bool currentState = digitalRead(BOOT_BUTTON_PIN);
-  if (currentState == LOW && lastButtonState == HIGH) { // Button just pressed
+// --- Firmware update (see ota_update.h) ---
+void handleUpdateStatus() {
+  OtaStatus status = otaStatus();
+  ResponseWriter out(server);
+  out.begin(200, "application/json");
+  out.print("{\"state\":\""); out.print(otaStateName(status.state));
+  out.print("\",\"mode\":\""); out.print(status.pull ? "pull" : "push");
+  out.print("\",\"size\":"); out.print((unsigned long)status.size);
+  out.print(",\"written\":"); out.print((unsigned long)status.written);
+  out.print(",\"kb_per_s\":");
+  out.print((unsigned long)(status.transferMillis ? (uint64_t)status.written * 1000 / 1024 / status.transferMillis : 0));
+  out.print(",\"heap_before\":"); out.print((unsigned long)status.heapBefore);
+  out.print(",\"heap_min\":"); out.print((unsigned long)status.heapMin);
+  out.print(",\"running\":"); out.printJsonString(otaRunningPartition());
+  out.print(",\"pending_verify\":"); out.print(status.pendingVerify ? "true" : "false");
+  out.print(",\"error\":"); out.printJsonString(status.error);
+  out.print('}');
+  out.end();
+}
+
+// Answers and returns false unless the request carries the OTA token
+bool authorizeUpdate() {
+  if (!otaEnabled()) {
+    sendJsonError(403, "Updates are disabled: no OTA_TOKEN in this build");
+    return false;
+  }
+  if (!otaAuthorized(server.header("Authorization").c_str())) {
+    server.sendHeader("WWW-Authenticate", "Bearer");
+    sendJsonError(401, "Missing or wrong token");
+    return false;
+  }
+  return true;
+}
+
+// POST /update?size=<bytes>&sha256=<hex>[&offset=<written>], image as the body
+void handleUpdate() {
+  if (!authorizeUpdate()) return;
+  uint32_t offset = strtoul(server.arg("offset").c_str(), nullptr, 10);
+  uint32_t size = server.hasArg("size") ? strtoul(server.arg("size").c_str(), nullptr, 10) : offset + server.contentLength();
+  const char* error = "";
+  OtaResult result = receiveOtaImage(size, server.arg("sha256").c_str(), offset,
+                                     [](uint8_t* buffer, size_t length) { return server.receive(buffer, length); }, error);
+  switch (result) {
+    case OtaResult::Complete:
+    case OtaResult::Paused:
+      // A paused transfer answers too, for clients that send the image in parts
+      handleUpdateStatus();
+      break;
+    case OtaResult::Failed:
+      sendJsonError(400, error);
+      break;
+    case OtaResult::Rejected:
+      sendJsonError(409, error);
+      break;
+  }
+}
+
+// POST /update/pull with url=http://... and sha256=<hex>
+void handleUpdatePull() {
+  if (!authorizeUpdate()) return;
+  const char* error = "";
+  if (!startOtaPull(server.arg("url").c_str(), server.arg("sha256").c_str(), error)) {
+    sendJsonError(409, error);
+    return;
+  }
+  server.send(202, "application/json", "{\"queued\":true}");
+}
+
+// Runs on the control loop once an update is in place
+void restartForUpdate() {
+  Serial.println("Restarting into the new firmware...");
+  flushLedStore();
+  flushWifiStore();
+  ESP.restart();
+}
+
+void handleMetrics() {
+  ResponseWriter out(server);
+  out.begin(200, "text/plain; version=0.0.4");
+  writeMetrics(out);
+  out.end();
+}
+
+// server.on() with request count, latency and response size recorded
+void route(const char* path, HTTPMethod method, void (*handler)(), bool streamBody = false, bool head = true) {
+  int slot = registerRouteMetrics(path, method);
+  server.on(path, method, [slot, handler]() {
+    unsigned long start = beginRequestMetrics();
+    handler();
+    endRequestMetrics(slot, start, server.bytesSent());
+  }, streamBody, head);
+}
+
+void IRAM_ATTR onBootButtonChange() {
+  notifyLoopFromISR(LOOP_EVENT_BUTTON);
+}
+
+// Edges arrive by interrupt; while the button is held loop() wakes for the
+// long-press deadline. Bounces only restart the press.
+void handleBootButton(bool changed) {
+  if (!changed && !buttonHeld) return;
+  bool pressed = digitalRead(BOOT_BUTTON_PIN) == LOW;
+  if (pressed && !buttonHeld) {
+    buttonHeld = true;
     buttonPressTime = millis();
+  } else if (!pressed) {
+    buttonHeld = false;
+  } else if (millis() - buttonPressTime >= LONG_PRESS_TIME) {
+    buttonHeld = false;
+    clearStoredCredentials();
+  }
+}
+
+// Runs on the WiFi event task: note what happened and wake the loop
+void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      notifyLoop(LOOP_EVENT_WIFI);
+      break;
+    case ARDUINO_EVENT_WIFI_AP_STOP:
+      apStopped = true;
+      notifyLoop(LOOP_EVENT_WIFI);
+      break;
+    case ARDUINO_EVENT_WIFI_SCAN_DONE:
+      notifyLoop(LOOP_EVENT_SCAN);
+      break;
+    default:
+      break;
+  }
+}
+
+void restartAccessPoint() {
+  WiFi.softAP(ap_ssid, ap_password);
+  WiFi.softAPConfig(local_ip, gateway, subnet);
+}
+
+// Station changes outside a connection attempt (monitorConnection() handles
+// those): a dropped link and the driver's own reconnect.
+void handleWifiEvents() {
+  if (apStopped) {
+    apStopped = false;
+    Serial.println("AP has disappeared! Restarting it...");
+    restartAccessPoint();
+  }
+  if (isConnecting) return;
+  bool up = WiFi.status() == WL_CONNECTED;
+  if (connectedToWiFi && !up) {
+    Serial.println("WiFi connection lost, waiting for the driver to reconnect.");
+    connectedToWiFi = false;
+    publishWifiState();
+  } else if (!connectedToWiFi && up && sta_ssid[0] != '\0') {
+    Serial.println("WiFi reconnected.");
+    connectedToWiFi = true;
+    countWifiConnect(true);
+    publishWifiState();
+  }
+}
+
+// How long loop() may block before something is due
+uint32_t loopSleepTime() {
+  uint32_t wait = pixelStreamWaitTime(LOOP_IDLE_WAIT);
+  if (!streamingPixels) wait = ledEffectsWaitTime(wait);
+  wait = fleetWaitTime(wait);
+  if (buttonHeld) {
+    unsigned long held = millis() - buttonPressTime;
+    wait = min(wait, (uint32_t)(held >= LONG_PRESS_TIME ? 0 : LONG_PRESS_TIME - held));
   }
-  if (currentState == HIGH && lastButtonState == LOW) { // Button just released
-    if (millis() - buttonPressTime >= LONG_PRESS_TIME) {
-      clearStoredCredentials();
+  return wait;
+}
+
+// --- Live updates over the event stream ---
+void publishLedState() {
+  char data[128];
+  snprintf(data, sizeof(data), "{\"on\":%s,\"r\":%u,\"g\":%u,\"b\":%u,\"brightness\":%u,\"effect\":\"%s\",\"period\":%u}",
+           ledState ? "true" : "false", currentColor.r, currentColor.g, currentColor.b, ledBrightness,
+           ledEffectName(currentLedEffect()), currentLedEffectPeriod());
+  broadcastEvent("led", data);
+}
+
+void publishWifiState() {
+  const char* state = "idle";
+  if (isConnecting) state = "connecting";
+  else if (connectedToWiFi) state = "connected";
+  else if (connectionAttempted) state = "failed";
+  char data[96];
+  IPAddress ip = WiFi.localIP();
+  snprintf(data, sizeof(data), "{\"state\":\"%s\",\"ip\":\"%u.%u.%u.%u\",\"rssi\":%d}",
+           state, ip[0], ip[1], ip[2], ip[3], connectedToWiFi ? (int)WiFi.RSSI() : 0);
+  broadcastEvent("wifi", data);
+}
+
+void publishHeap() {
+  char data[80];
+  snprintf(data, sizeof(data), "{\"free\":%u,\"min\":%u,\"subscribers\":%u}",
+           (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap(), eventSubscriberCount());
+  broadcastEvent("heap", data);
+}
+
+void serviceLiveUpdates() {
+  static unsigned long lastHeapUpdate = 0;
+  if (serviceEventStream()) {
+    publishLedState();
+    publishWifiState();
+    publishHeap();
+  }
+  if (millis() - lastHeapUpdate > 5000) {
+    publishHeap();
+    lastHeapUpdate = millis();
+  }
+}
+
+void applyLedUpdate(const LedUpdate& update) {
+  if (update.fields & STATE_ON) ledState = update.on;
+  if (update.fields & STATE_COLOR) currentColor = CRGB(update.color);
+  if (update.fields & STATE_BRIGHTNESS) ledBrightness = update.brightness;
+  if (update.fields & (STATE_ON | STATE_COLOR | STATE_BRIGHTNESS)) {
+    updateRGBLED();
+    saveLedState();
+  }
+  if (update.fields & (STATE_EFFECT | STATE_PERIOD)) {
+    LedEffect effect = (update.fields & STATE_EFFECT) ? update.effect : currentLedEffect();
+    uint16_t period = (update.fields & STATE_PERIOD) ? update.period : currentLedEffectPeriod();
+    setLedEffect(effect, period);
+  }
+}
+
+// The LED change a command makes, for sending to the fleet
+bool ledCommandUpdate(const Command& command, LedUpdate& update) {
+  switch (command.type) {
+    case CommandType::SetColor:
+      update.fields = STATE_COLOR;
+      update.color = command.color;
+      return true;
+    case CommandType::SetBrightness:
+      update.fields = STATE_BRIGHTNESS;
+      update.brightness = command.brightness;
+      return true;
+    case CommandType::ToggleLed:
+      update.fields = STATE_ON;
+      update.on = !ledState;
+      return true;
+    case CommandType::SetEffect:
+      update.fields = STATE_EFFECT | STATE_PERIOD;
+      update.effect = (LedEffect)command.effect.id;
+      update.period = command.effect.period;
+      return true;
+    case CommandType::ApplyState:
+      update = command.state;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Drains commands posted by the HTTP task. Runs on the control loop only.
+void processCommands() {
+  Command command;
+  bool ledChanged = false;
+  while (commandQueue.pop(command)) {
+    // A leader hands LED changes to the fleet and applies them together
+    // with its group, in applyFleetUpdates()
+    LedUpdate shared;
+    if (fleetRole() == FleetRole::Leader && ledCommandUpdate(command, shared) && sendFleetUpdate(shared)) continue;
+    switch (command.type) {
+      case CommandType::SetColor:
+        currentColor = CRGB(command.color);
+        updateRGBLED();
+        saveLedState();
+        ledChanged = true;
+        break;
+      case CommandType::SetBrightness:
+        ledBrightness = command.brightness;
+        updateRGBLED();
+        saveLedState();
+        ledChanged = true;
+        break;
+      case CommandType::ToggleLed:
+        ledState = !ledState;
+        updateRGBLED();
+        saveLedState();
+        ledChanged = true;
+        break;
+      case CommandType::Connect:
+        connectWithNewCredentials(command.wifi.ssid, command.wifi.password);
+        publishWifiState();
+        break;
+      case CommandType::ClearCredentials:
+        forgetCredentials();
+        publishWifiState();
+        break;
+      case CommandType::ForgetNetwork:
+        forgetNetwork(command.wifi.ssid);
+        break;
+      case CommandType::StartScan:
+        requestWifiScan();
+        break;
+      case CommandType::SetEffect:
+        setLedEffect((LedEffect)command.effect.id, command.effect.period);
+        ledChanged = true;
+        break;
+      case CommandType::ApplyState:
+        applyLedUpdate(command.state);
+        ledChanged = true;
+        break;
+      case CommandType::AddTimer:
+        if (addTimerRule(command.timer) == 0) Serial.println("Timer table is full.");
+        break;
+      case CommandType::DeleteTimer:
+        deleteTimerRule(command.timerId);
+        break;
+      case CommandType::SetFleet:
+        setFleetConfig(command.fleet.role, command.fleet.group);
+        break;
+      case CommandType::SetStrip:
+        resizeLedOutput(command.strip.pixelCount);
+        setLedSegments(command.strip.segments, command.strip.segmentCount);
+        saveStripConfig(command.strip);
+        ledChanged = true;
+        break;
     }
   }
-  lastButtonState = currentState;
+  // One update for a burst of commands, e.g. a dragged slider. A manual
+  // change also ends a running sunrise.
+  if (ledChanged) {
+    cancelTimerFade();
+    publishLedState();
+  }
+}
+
+// Fleet updates whose apply time has come, from a leader or this node
+void applyFleetUpdates() {
+  LedUpdate update;
+  bool changed = false;
+  while (takeFleetUpdate(update)) {
+    applyLedUpdate(update);
+    changed = true;
+  }
+  if (changed) {
+    cancelTimerFade();
+    publishLedState();
+  }
+}
+
+// Fired timer rules (led_timer), on the control loop
+void applyTimerUpdate(const LedUpdate& update) {
+  applyLedUpdate(update);
+  publishLedState();
 }
 
 // --- SETUP ---
@@ -416,24 +1622,32 @@ void setup() {
   Serial.println("\nStarting up...");
 
   // Initialize FastLED
-  FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS);
+  StripConfig strip;
+  bool haveStrip = loadStripConfig(strip);
+  beginLedOutput(haveStrip ? strip.pixelCount : DEFAULT_NUM_LEDS);
+  beginLedEffects();
   loadLedState();
-  // Test LED
-  leds[0] = CRGB::Red; FastLED.show(); delay(200);
-  leds[0] = CRGB::Green; FastLED.show(); delay(200);
-  leds[0] = CRGB::Blue; FastLED.show(); delay(200);
-  updateRGBLED();
+  setenv("TZ", TIME_ZONE, 1);
+  tzset();
+  beginLedTimer(applyTimerUpdate);
+  // A saved segment table brings back its own colours and effects
+  if (haveStrip) setLedSegments(strip.segments, strip.segmentCount);
+  // Test LED, played by the effects engine while setup() carries on
+  startLedSelfTest();
 
   // Initialize boot button
+  beginLoopEvents();
   pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(BOOT_BUTTON_PIN), onBootButtonChange, CHANGE);
 
-  // Load saved credentials
-  preferences.begin("wifi", true);
-  sta_ssid = preferences.getString("ssid", "");
-  sta_password = preferences.getString("password", "");
-  preferences.end();
+  // Load saved networks
+  beginWifiStore();
+  beginFleetSync(WEB_SERVER_CORE);
+  beginPixelStream(WEB_SERVER_CORE);
+  beginOta();
   
   // ALWAYS start in dual mode. This is crucial.
+  WiFi.onEvent(onWifiEvent);
   WiFi.mode(WIFI_AP_STA);
   
   // Start the Access Point
@@ -441,76 +1655,93 @@ void setup() {
   WiFi.softAPConfig(local_ip, gateway, subnet);
   Serial.print("AP Started. IP Address: ");
   Serial.println(WiFi.softAPIP());
+  beginCaptiveDns(local_ip, WEB_SERVER_CORE);
 
   // If we have credentials, start the connection process
-  if (sta_ssid.length() > 0) {
-    Serial.println("Found stored credentials for: " + sta_ssid);
-    isConnecting = true;
-    connectionStartTime = millis();
+  if (knownNetworkCount() > 0) {
+    Serial.printf("Found %u stored networks.\n", knownNetworkCount());
     // --- FIX: Start the connection attempt HERE, only ONCE ---
-    WiFi.begin(sta_ssid.c_str(), sta_password.c_str()); 
+    connectToKnownNetworks();
   } else {
     Serial.println("No stored WiFi credentials.");
   }
 
   // Setup web server routes
-  server.on("/", HTTP_GET, handleHome);
-  server.on("/wifi-setup", HTTP_GET, handleWifiSetup);
-  server.on("/scan", HTTP_GET, handleScan);
-  server.on("/connect", HTTP_POST, handleConnect);
-  server.on("/clear-credentials", HTTP_GET, handleClearCredentials);
-  server.on("/led", HTTP_GET, handleLed);
-  server.on("/toggle-led", HTTP_POST, handleToggleLed);
-  server.on("/set-color", HTTP_POST, handleSetColor);
-  server.on("/set-brightness", HTTP_POST, handleSetBrightness);
-  server.on("/info", HTTP_GET, handleInfo);
-  server.onNotFound(handleNotFound);
-
-  server.begin();
+  route("/", HTTP_GET, handleHome);
+  route("/wifi-setup", HTTP_GET, handleWifiSetup);
+  route("/scan", HTTP_GET, handleScan);
+  route("/api/scan.json", HTTP_GET, handleScanJson);
+  route("/connect", HTTP_POST, handleConnect);
+  // Not on HEAD: a link checker or monitoring probe must not wipe the networks
+  route("/clear-credentials", HTTP_GET, handleClearCredentials, false, false);
+  route("/forget-network", HTTP_POST, handleForgetNetwork);
+  route("/api/networks", HTTP_GET, handleNetworksJson);
+  route("/led", HTTP_GET, handleLed);
+  route("/toggle-led", HTTP_POST, handleToggleLed);
+  route("/set-color", HTTP_POST, handleSetColor);
+  route("/set-brightness", HTTP_POST, handleSetBrightness);
+  route("/api/effect", HTTP_GET, handleGetEffect);
+  route("/api/effect", HTTP_POST, handleSetEffect);
+  route("/api/state", HTTP_GET, handleGetState);
+  route("/api/state", HTTP_PUT, handlePutState);
+  route("/api/segments", HTTP_GET, handleGetSegments);
+  route("/api/segments", HTTP_POST, handleSetSegments);
+  route("/api/fleet", HTTP_GET, handleGetFleet);
+  route("/api/fleet", HTTP_POST, handleSetFleet);
+  route("/timer", HTTP_GET, handleTimer);
+  route("/timer/add", HTTP_POST, handleAddTimer);
+  route("/timer/delete", HTTP_POST, handleDeleteTimer);
+  route("/api/timers", HTTP_GET, handleTimersJson);
+  route("/info", HTTP_GET, handleInfo);
+  route("/metrics", HTTP_GET, handleMetrics);
+  route("/update", HTTP_GET, handleUpdateStatus);
+  route("/update", HTTP_POST, handleUpdate, true);
+  route("/update/pull", HTTP_POST, handleUpdatePull);
+  route("/app.css", HTTP_GET, handleAppCss);
+  route("/app.js", HTTP_GET, handleAppJs);
+  for (uint8_t i = 0; i < CAPTIVE_PROBE_COUNT; i++) {
+    route(CAPTIVE_PROBE_PATHS[i], HTTP_ANY, handleCaptiveProbe);
+  }
+  server.onNotFound([]() {
+    unsigned long start = beginRequestMetrics();
+    handleNotFound();
+    endRequestMetrics(-1, start, server.bytesSent());
+  });
+
+  server.begin(WEB_SERVER_CORE, WEB_SERVER_STACK_SIZE);
+  beginEventStream();
   Serial.println("Web server started.");
+  beginPowerManagement();
 }
 
 // --- MAIN LOOP ---
+// Blocks until an event (command, WiFi, scan, button) or the next deadline,
+// then runs whatever is due.
 void loop() {
-  handleBootButton();
-  server.handleClient();
+  EventBits_t events = waitForLoopEvents(loopSleepTime());
+  unsigned long loopStart = micros();
+  processCommands();
+  applyFleetUpdates();
+  serviceFleetSync();
+  serviceLedTimer();
+  handleBootButton(events & LOOP_EVENT_BUTTON);
+  pollWifiScan();
+  pollLedStore();
+  pollWifiStore();
+  // Live pixels replace the effects until the stream times out
+  streamingPixels = servicePixelStream(ledBrightness);
+  if (!streamingPixels) serviceLedEffects();
+  serviceLiveUpdates();
 
   // --- Centralized WiFi Connection Monitoring ---
+  if (events & LOOP_EVENT_WIFI) handleWifiEvents();
   if (isConnecting) {
-    // Check for successful connection
-    if (WiFi.status() == WL_CONNECTED) {
-      Serial.println("");
-      Serial.println("✅ WiFi Connected!");
-      Serial.print("IP Address: ");
-      Serial.println(WiFi.localIP());
-      isConnecting = false;
-      connectedToWiFi = true;
-      configTime(19800, 0, ntpServer); // GMT+5:30 = 19800 seconds
-    }
-    // Check for connection timeout
-    else if (millis() - connectionStartTime > CONNECTION_TIMEOUT) {
-      Serial.println("❌ Connection failed (timeout).");
-      isConnecting = false;
-      connectedToWiFi = false;
-      
-      // Disconnect cleanly and forcefully restart the AP to ensure it's available.
-      WiFi.disconnect(true); 
-      delay(100);
-      WiFi.mode(WIFI_AP_STA);
-      WiFi.softAP(ap_ssid, ap_password);
-      WiFi.softAPConfig(local_ip, gateway, subnet);
-      Serial.println("AP has been re-initialized to ensure availability.");
-    }
+    monitorConnection();
+  } else {
+    serviceRoaming();
   }
+  // A new image counts as healthy once it is back on its network
+  if (serviceOta(connectedToWiFi || knownNetworkCount() == 0)) restartForUpdate();
 
-  // Optional: Periodically check if the AP has died for any reason and restart it
-  static unsigned long lastApCheck = 0;
-  if (millis() - lastApCheck > 5000) { // Check every 5 seconds
-      if (WiFi.softAPIP() == IPAddress(0,0,0,0)) {
-          Serial.println("AP has disappeared! Restarting it...");
-          WiFi.softAP(ap_ssid, ap_password);
-          WiFi.softAPConfig(local_ip, gateway, subnet);
-      }
-      lastApCheck = millis();
-  }
+  recordLoopTime(micros() - loopStart);
 }
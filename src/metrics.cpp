@@ -0,0 +1,261 @@
+#include "metrics.h"
+#include <WiFi.h>
+#include "led_store.h"
+#include "led_output.h"
+#include "wifi_store.h"
+#include "event_stream.h"
+#include "captive_portal.h"
+#include "fleet_sync.h"
+#include "pixel_stream.h"
+
+// Upper bounds in microseconds
+static const uint32_t LATENCY_BOUNDS[LATENCY_BUCKETS] = {
+  1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000,
+};
+static const uint32_t LOOP_BOUNDS[LOOP_BUCKETS] = {
+  50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000,
+};
+
+struct RouteMetrics {
+  const char* path;
+  HTTPMethod method;
+  uint32_t requests;
+  uint32_t bytes;
+  uint64_t totalMicros;
+  uint32_t buckets[LATENCY_BUCKETS + 1];
+};
+
+// Last slot collects routes that did not get one of their own
+static RouteMetrics routes[MAX_ROUTE_METRICS + 1];
+static uint8_t routeCount = 0;
+
+static uint32_t loopIterations = 0;
+static uint32_t loopMaxMicros = 0;
+static uint64_t loopTotalMicros = 0;
+static portMUX_TYPE loopSumLock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t loopBuckets[LOOP_BUCKETS + 1];
+
+static uint32_t wifiConnects = 0;
+static uint32_t wifiConnectFailures = 0;
+
+static uint8_t bucketFor(const uint32_t* bounds, uint8_t count, unsigned long value) {
+  uint8_t i = 0;
+  while (i < count && value > bounds[i]) i++;
+  return i;
+}
+
+int registerRouteMetrics(const char* path, HTTPMethod method) {
+  if (routeCount == MAX_ROUTE_METRICS) {
+    Serial.printf("Metrics: no slot left, %s counted as other\n", path);
+    return -1;
+  }
+  routes[routeCount].path = path;
+  routes[routeCount].method = method;
+  return routeCount++;
+}
+
+unsigned long beginRequestMetrics() {
+  return micros();
+}
+
+void endRequestMetrics(int slot, unsigned long start, size_t responseBytes) {
+  unsigned long elapsed = micros() - start;
+  RouteMetrics& route = routes[slot < 0 ? MAX_ROUTE_METRICS : slot];
+  route.requests++;
+  route.bytes += responseBytes;
+  route.totalMicros += elapsed;
+  route.buckets[bucketFor(LATENCY_BOUNDS, LATENCY_BUCKETS, elapsed)]++;
+}
+
+void recordLoopTime(unsigned long micros) {
+  loopIterations++;
+  portENTER_CRITICAL(&loopSumLock);
+  loopTotalMicros += micros;
+  portEXIT_CRITICAL(&loopSumLock);
+  if (micros > loopMaxMicros) loopMaxMicros = micros;
+  loopBuckets[bucketFor(LOOP_BOUNDS, LOOP_BUCKETS, micros)]++;
+}
+
+void countWifiConnect(bool ok) {
+  if (ok) wifiConnects++;
+  else wifiConnectFailures++;
+}
+
+static const char* methodName(HTTPMethod method) {
+  switch (method) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_PUT: return "PUT";
+    case HTTP_DELETE: return "DELETE";
+    case HTTP_PATCH: return "PATCH";
+    case HTTP_HEAD: return "HEAD";
+    case HTTP_OPTIONS: return "OPTIONS";
+    default: return "ANY";
+  }
+}
+
+// Microseconds as seconds with six decimals, without going through float
+static void printSeconds(ResponseWriter& out, uint64_t micros) {
+  char text[24];
+  snprintf(text, sizeof(text), "%lu.%06lu", (unsigned long)(micros / 1000000), (unsigned long)(micros % 1000000));
+  out.print(text);
+}
+
+static void printHeader(ResponseWriter& out, const char* name, const char* type, const char* help) {
+  out.print("# HELP "); out.print(name); out.print(' '); out.print(help);
+  out.print("\n# TYPE "); out.print(name); out.print(' '); out.print(type); out.print('\n');
+}
+
+static void printMetric(ResponseWriter& out, const char* name, unsigned long value) {
+  out.print(name); out.print(' '); out.print(value); out.print('\n');
+}
+
+static void printLabels(ResponseWriter& out, const RouteMetrics& route) {
+  out.print("{path=\""); out.print(route.path ? route.path : "other");
+  out.print("\",method=\""); out.print(route.path ? methodName(route.method) : "ANY"); out.print('"');
+}
+
+static void writeRouteMetrics(ResponseWriter& out) {
+  printHeader(out, "http_requests_total", "counter", "Requests handled per route.");
+  for (uint8_t i = 0; i <= MAX_ROUTE_METRICS; i++) {
+    const RouteMetrics& route = routes[i];
+    if (i >= routeCount && i < MAX_ROUTE_METRICS) continue;
+    out.print("http_requests_total"); printLabels(out, route); out.print("} "); out.print(route.requests); out.print('\n');
+  }
+  printHeader(out, "http_response_bytes_total", "counter", "Response body bytes per route.");
+  for (uint8_t i = 0; i <= MAX_ROUTE_METRICS; i++) {
+    const RouteMetrics& route = routes[i];
+    if (i >= routeCount && i < MAX_ROUTE_METRICS) continue;
+    out.print("http_response_bytes_total"); printLabels(out, route); out.print("} "); out.print(route.bytes); out.print('\n');
+  }
+  printHeader(out, "http_request_duration_seconds", "histogram", "Handler run time per route.");
+  for (uint8_t i = 0; i <= MAX_ROUTE_METRICS; i++) {
+    const RouteMetrics& route = routes[i];
+    if (i >= routeCount && i < MAX_ROUTE_METRICS) continue;
+    if (route.requests == 0) continue;
+    uint32_t cumulative = 0;
+    for (uint8_t b = 0; b <= LATENCY_BUCKETS; b++) {
+      cumulative += route.buckets[b];
+      out.print("http_request_duration_seconds_bucket"); printLabels(out, route);
+      out.print(",le=\"");
+      if (b < LATENCY_BUCKETS) printSeconds(out, LATENCY_BOUNDS[b]);
+      else out.print("+Inf");
+      out.print("\"} "); out.print(cumulative); out.print('\n');
+    }
+    out.print("http_request_duration_seconds_sum"); printLabels(out, route); out.print("} "); printSeconds(out, route.totalMicros); out.print('\n');
+    out.print("http_request_duration_seconds_count"); printLabels(out, route); out.print("} "); out.print(route.requests); out.print('\n');
+  }
+}
+
+// Upper bound of the bucket holding the 99th percentile
+static uint32_t loopP99Micros(const uint32_t* buckets, uint32_t total) {
+  uint32_t target = total - total / 100;
+  uint32_t cumulative = 0;
+  for (uint8_t b = 0; b < LOOP_BUCKETS; b++) {
+    cumulative += buckets[b];
+    if (cumulative >= target) return LOOP_BOUNDS[b];
+  }
+  return loopMaxMicros;
+}
+
+// 64 bits are written in two halves, so a plain read could see a torn value
+static uint64_t loopSumMicros() {
+  portENTER_CRITICAL(&loopSumLock);
+  uint64_t sum = loopTotalMicros;
+  portEXIT_CRITICAL(&loopSumLock);
+  return sum;
+}
+
+static void writeLoopMetrics(ResponseWriter& out) {
+  uint32_t buckets[LOOP_BUCKETS + 1];
+  memcpy(buckets, loopBuckets, sizeof(buckets));
+  uint32_t total = 0;
+  for (uint8_t b = 0; b <= LOOP_BUCKETS; b++) total += buckets[b];
+
+  printHeader(out, "loop_duration_seconds", "histogram", "Control loop iteration time.");
+  uint32_t cumulative = 0;
+  for (uint8_t b = 0; b <= LOOP_BUCKETS; b++) {
+    cumulative += buckets[b];
+    out.print("loop_duration_seconds_bucket{le=\"");
+    if (b < LOOP_BUCKETS) printSeconds(out, LOOP_BOUNDS[b]);
+    else out.print("+Inf");
+    out.print("\"} "); out.print(cumulative); out.print('\n');
+  }
+  out.print("loop_duration_seconds_sum "); printSeconds(out, loopSumMicros()); out.print('\n');
+  out.print("loop_duration_seconds_count "); out.print(total); out.print('\n');
+  printHeader(out, "loop_duration_max_seconds", "gauge", "Longest control loop iteration since boot.");
+  out.print("loop_duration_max_seconds "); printSeconds(out, loopMaxMicros); out.print('\n');
+  printHeader(out, "loop_duration_p99_seconds", "gauge", "99th percentile loop time (bucket upper bound).");
+  out.print("loop_duration_p99_seconds "); printSeconds(out, total ? loopP99Micros(buckets, total) : 0); out.print('\n');
+}
+
+void writeMetrics(ResponseWriter& out) {
+  printHeader(out, "uptime_seconds", "counter", "Seconds since boot.");
+  printMetric(out, "uptime_seconds", millis() / 1000);
+  printHeader(out, "heap_free_bytes", "gauge", "Free heap.");
+  printMetric(out, "heap_free_bytes", ESP.getFreeHeap());
+  printHeader(out, "heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+  printMetric(out, "heap_min_free_bytes", ESP.getMinFreeHeap());
+  printHeader(out, "heap_largest_free_block_bytes", "gauge", "Largest allocatable block; low against heap_free_bytes means fragmentation.");
+  printMetric(out, "heap_largest_free_block_bytes", ESP.getMaxAllocHeap());
+
+  writeLoopMetrics(out);
+  writeRouteMetrics(out);
+
+  bool connected = WiFi.status() == WL_CONNECTED;
+  printHeader(out, "wifi_connected", "gauge", "1 when the station is connected.");
+  printMetric(out, "wifi_connected", connected ? 1 : 0);
+  printHeader(out, "wifi_rssi_dbm", "gauge", "Signal strength of the current AP.");
+  out.print("wifi_rssi_dbm "); out.print(connected ? (long)WiFi.RSSI() : 0L); out.print('\n');
+  printHeader(out, "wifi_connects_total", "counter", "Successful station connections, including reconnects and roams.");
+  printMetric(out, "wifi_connects_total", wifiConnects);
+  printHeader(out, "wifi_connect_failures_total", "counter", "Connection attempts that gave up.");
+  printMetric(out, "wifi_connect_failures_total", wifiConnectFailures);
+
+  LedStoreStats ledStats = ledStoreStats();
+  printHeader(out, "nvs_writes_total", "counter", "Blobs written to flash since boot.");
+  out.print("nvs_writes_total{store=\"led\"} "); out.print(ledStats.writesPerformed); out.print('\n');
+  out.print("nvs_writes_total{store=\"wifi\"} "); out.print(wifiStoreWrites()); out.print('\n');
+  printHeader(out, "nvs_writes_avoided_total", "counter", "LED updates that never reached flash.");
+  printMetric(out, "nvs_writes_avoided_total", ledStats.writesAvoided);
+
+  LedOutputStats output = ledOutputStats();
+  printHeader(out, "led_frames_total", "counter", "Frames shown on the strip.");
+  printMetric(out, "led_frames_total", output.frames);
+  printHeader(out, "led_show_max_seconds", "gauge", "Longest FastLED.show() call.");
+  out.print("led_show_max_seconds "); printSeconds(out, output.maxShowMicros); out.print('\n');
+  printHeader(out, "sse_subscribers", "gauge", "Connected event stream clients.");
+  printMetric(out, "sse_subscribers", eventSubscriberCount());
+
+  CaptiveStats captive = captiveStats();
+  printHeader(out, "captive_dns_queries_total", "counter", "DNS queries answered on the soft AP.");
+  printMetric(out, "captive_dns_queries_total", captive.dnsQueries);
+  printHeader(out, "captive_dns_dropped_total", "counter", "Malformed DNS packets ignored.");
+  printMetric(out, "captive_dns_dropped_total", captive.dnsDropped);
+  printHeader(out, "captive_probes_total", "counter", "Connectivity checks redirected to the portal.");
+  printMetric(out, "captive_probes_total", captive.probes);
+
+  FleetStats fleet = fleetStats();
+  printHeader(out, "fleet_synced", "gauge", "1 while a fleet leader's beacons are arriving.");
+  printMetric(out, "fleet_synced", fleet.synced ? 1 : 0);
+  printHeader(out, "fleet_clock_offset_ms", "gauge", "Local clock minus the leader's, including network delay.");
+  out.print("fleet_clock_offset_ms "); out.print((long)fleet.offset); out.print('\n');
+  printHeader(out, "fleet_packets_total", "counter", "Fleet packets by direction.");
+  out.print("fleet_packets_total{direction=\"sent\"} "); out.print(fleet.packetsSent); out.print('\n');
+  out.print("fleet_packets_total{direction=\"received\"} "); out.print(fleet.packetsReceived); out.print('\n');
+  printHeader(out, "fleet_updates_applied_total", "counter", "Fleet LED updates applied at their scheduled time.");
+  printMetric(out, "fleet_updates_applied_total", fleet.updatesApplied);
+  printHeader(out, "fleet_updates_late_total", "counter", "Fleet updates that arrived after their apply time.");
+  printMetric(out, "fleet_updates_late_total", fleet.lateUpdates);
+
+  PixelStreamStats stream = pixelStreamStats();
+  printHeader(out, "pixel_stream_active", "gauge", "1 while a DDP or E1.31 stream owns the strip.");
+  printMetric(out, "pixel_stream_active", stream.active ? 1 : 0);
+  printHeader(out, "pixel_stream_packets_total", "counter", "Pixel stream packets by outcome.");
+  out.print("pixel_stream_packets_total{result=\"written\"} "); out.print(stream.packets); out.print('\n');
+  out.print("pixel_stream_packets_total{result=\"dropped\"} "); out.print(stream.packetsDropped); out.print('\n');
+  out.print("pixel_stream_packets_total{result=\"lost\"} "); out.print(stream.packetsLost); out.print('\n');
+  printHeader(out, "pixel_stream_frames_total", "counter", "Pixel stream frames by outcome.");
+  out.print("pixel_stream_frames_total{result=\"shown\"} "); out.print(stream.frames); out.print('\n');
+  out.print("pixel_stream_frames_total{result=\"dropped\"} "); out.print(stream.framesDropped); out.print('\n');
+}
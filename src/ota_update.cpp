@@ -0,0 +1,382 @@
+#include "ota_update.h"
+#include <HTTPClient.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+static const char* const STATE_NAMES[] = {"idle", "receiving", "paused", "done", "failed"};
+
+struct Session {
+  OtaStatus status;
+  const esp_partition_t* target;
+  esp_ota_handle_t handle;
+  bool handleOpen;
+  mbedtls_sha256_context sha;
+  uint8_t expected[32];
+  unsigned long pausedAt;
+  unsigned long doneAt;
+};
+
+static Session session;
+// Set while one task streams into the session; the HTTP task (push) and
+// the pull task take turns through claim()/release()
+static bool busy = false;
+static portMUX_TYPE otaLock = portMUX_INITIALIZER_UNLOCKED;
+// Only touched by the task holding the claim
+static uint8_t chunk[OTA_CHUNK_SIZE];
+static char pullUrl[OTA_MAX_URL];
+
+static bool pendingVerify = false;
+static bool healthy = false;
+static unsigned long healthySince = 0;
+
+// The Arduino core confirms a pending image as soon as it boots unless told
+// that the application will do it; serviceOta() does, after a health check.
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+static bool claim() {
+  portENTER_CRITICAL(&otaLock);
+  bool claimed = !busy;
+  busy = true;
+  portEXIT_CRITICAL(&otaLock);
+  return claimed;
+}
+
+static void release() {
+  portENTER_CRITICAL(&otaLock);
+  busy = false;
+  portEXIT_CRITICAL(&otaLock);
+}
+
+static void setState(OtaState state) {
+  portENTER_CRITICAL(&otaLock);
+  session.status.state = state;
+  portEXIT_CRITICAL(&otaLock);
+}
+
+static bool parseSha256(const char* hex, uint8_t* digest) {
+  if (hex == nullptr || strlen(hex) != 64) return false;
+  for (int i = 0; i < 32; i++) {
+    char byte[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+    char* end;
+    digest[i] = strtoul(byte, &end, 16);
+    if (*end != '\0') return false;
+  }
+  return true;
+}
+
+static void closeHandle() {
+  if (!session.handleOpen) return;
+  esp_ota_abort(session.handle);
+  mbedtls_sha256_free(&session.sha);
+  session.handleOpen = false;
+}
+
+static void fail(const char* error) {
+  closeHandle();
+  portENTER_CRITICAL(&otaLock);
+  session.status.state = OtaState::Failed;
+  strlcpy(session.status.error, error, sizeof(session.status.error));
+  portEXIT_CRITICAL(&otaLock);
+  Serial.printf("OTA: %s\n", error);
+}
+
+// Callers hold the claim
+static bool openSession(uint32_t size, const uint8_t* expected, bool pull, const char*& error) {
+  closeHandle();
+  const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+  if (target == nullptr) {
+    error = "No OTA partition";
+    return false;
+  }
+  if (size == 0 || size > target->size) {
+    error = "Image does not fit the OTA partition";
+    return false;
+  }
+  // Sectors are erased as the writes reach them, so starting is instant
+  if (esp_ota_begin(target, OTA_WITH_SEQUENTIAL_WRITES, &session.handle) != ESP_OK) {
+    error = "Could not start the update";
+    return false;
+  }
+  session.target = target;
+  session.handleOpen = true;
+  mbedtls_sha256_init(&session.sha);
+  mbedtls_sha256_starts(&session.sha, 0);
+  if (expected != session.expected) memcpy(session.expected, expected, sizeof(session.expected));
+
+  portENTER_CRITICAL(&otaLock);
+  session.status.state = OtaState::Receiving;
+  session.status.pull = pull;
+  session.status.size = size;
+  session.status.written = 0;
+  session.status.transferMillis = 0;
+  session.status.heapBefore = ESP.getFreeHeap();
+  session.status.heapMin = session.status.heapBefore;
+  session.status.error[0] = '\0';
+  portEXIT_CRITICAL(&otaLock);
+  Serial.printf("OTA: writing %lu bytes to %s\n", (unsigned long)size, target->label);
+  return true;
+}
+
+static OtaResult finish() {
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&session.sha, digest);
+  mbedtls_sha256_free(&session.sha);
+  if (memcmp(digest, session.expected, sizeof(digest)) != 0) {
+    esp_ota_abort(session.handle);
+    session.handleOpen = false;
+    fail("SHA-256 mismatch");
+    return OtaResult::Failed;
+  }
+  // esp_ota_end() also checks the image header and its own checksum
+  session.handleOpen = false;
+  if (esp_ota_end(session.handle) != ESP_OK) {
+    fail("Not a valid firmware image");
+    return OtaResult::Failed;
+  }
+  if (esp_ota_set_boot_partition(session.target) != ESP_OK) {
+    fail("Could not select the new image");
+    return OtaResult::Failed;
+  }
+  session.doneAt = millis();
+  setState(OtaState::Done);
+  const OtaStatus& status = session.status;
+  Serial.printf("OTA: %lu bytes in %lu ms (%lu KB/s), heap %lu -> min %lu\n", (unsigned long)status.written,
+                (unsigned long)status.transferMillis,
+                (unsigned long)(status.transferMillis ? (uint64_t)status.written * 1000 / 1024 / status.transferMillis : 0),
+                (unsigned long)status.heapBefore, (unsigned long)status.heapMin);
+  return OtaResult::Complete;
+}
+
+// Copies from `read` into flash until the image is complete or the reader
+// stops. Callers hold the claim with the session Receiving.
+static OtaResult stream(const OtaReader& read) {
+  unsigned long start = millis();
+  uint32_t written = session.status.written;
+  uint32_t size = session.status.size;
+  uint32_t heapMin = session.status.heapMin;
+  bool failed = false;
+  while (written < size) {
+    int length = read(chunk, min((uint32_t)sizeof(chunk), size - written));
+    if (length <= 0) break;
+    mbedtls_sha256_update(&session.sha, chunk, length);
+    if (esp_ota_write(session.handle, chunk, length) != ESP_OK) {
+      failed = true;
+      break;
+    }
+    written += length;
+    heapMin = min(heapMin, (uint32_t)ESP.getFreeHeap());
+    portENTER_CRITICAL(&otaLock);
+    session.status.written = written;
+    session.status.heapMin = heapMin;
+    portEXIT_CRITICAL(&otaLock);
+  }
+  session.status.transferMillis += millis() - start;
+
+  if (failed) {
+    fail("Flash write failed");
+    return OtaResult::Failed;
+  }
+  if (written < size) {
+    session.pausedAt = millis();
+    setState(OtaState::Paused);
+    Serial.printf("OTA: paused at %lu of %lu bytes\n", (unsigned long)written, (unsigned long)size);
+    return OtaResult::Paused;
+  }
+  return finish();
+}
+
+OtaResult receiveOtaImage(uint32_t size, const char* sha256, uint32_t offset, OtaReader read, const char*& error) {
+  uint8_t expected[32];
+  if (!parseSha256(sha256, expected)) {
+    error = "Expected sha256=<64 hex digits>";
+    return OtaResult::Rejected;
+  }
+  if (!claim()) {
+    error = "Another update is in progress";
+    return OtaResult::Rejected;
+  }
+  if (offset == 0) {
+    if (!openSession(size, expected, false, error)) {
+      release();
+      return OtaResult::Rejected;
+    }
+  } else if (session.status.state != OtaState::Paused || session.status.pull) {
+    error = "No paused update to resume";
+    release();
+    return OtaResult::Rejected;
+  } else if (offset != session.status.written || size != session.status.size ||
+             memcmp(expected, session.expected, sizeof(expected)) != 0) {
+    error = "Resume must continue the same image from offset=written";
+    release();
+    return OtaResult::Rejected;
+  } else {
+    setState(OtaState::Receiving);
+  }
+  OtaResult result = stream(read);
+  if (result == OtaResult::Failed) error = session.status.error;
+  release();
+  return result;
+}
+
+// --- Pull ---
+
+static void pullTask(void* parameter) {
+  uint8_t attempts = 0;
+  bool started = false;
+  for (;;) {
+    HTTPClient http;
+    http.setTimeout(OTA_PULL_TIMEOUT);
+    if (!http.begin(pullUrl)) {
+      fail("Bad URL");
+      break;
+    }
+    if (started) {
+      char range[32];
+      snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)session.status.written);
+      http.addHeader("Range", range);
+    }
+    int code = http.GET();
+    bool restart = code == 200 && started; // server ignored the range
+    OtaResult result = OtaResult::Paused;
+    if (code == 200 || (code == 206 && started)) {
+      if (!started || restart) {
+        int size = http.getSize();
+        const char* error = "";
+        if (size <= 0) {
+          error = "Server did not send a Content-Length";
+        } else if (openSession(size, session.expected, true, error)) {
+          started = true;
+        }
+        if (!started) {
+          http.end();
+          fail(error);
+          break;
+        }
+      } else {
+        setState(OtaState::Receiving);
+      }
+      WiFiClient* body = http.getStreamPtr();
+      result = stream([body](uint8_t* buffer, size_t length) {
+        size_t received = body->readBytes(buffer, length);
+        return received > 0 ? (int)received : -1;
+      });
+    } else {
+      Serial.printf("OTA: download returned %d\n", code);
+    }
+    http.end();
+    if (result != OtaResult::Paused) break;
+    if (++attempts > OTA_PULL_RETRIES) {
+      fail("Download kept failing");
+      break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(OTA_PULL_RETRY_DELAY));
+  }
+  release();
+  vTaskDelete(nullptr);
+}
+
+bool startOtaPull(const char* url, const char* sha256, const char*& error) {
+  uint8_t expected[32];
+  if (strncmp(url, "http://", 7) != 0 || strlen(url) >= sizeof(pullUrl)) {
+    error = "Expected an http:// URL";
+    return false;
+  }
+  if (!parseSha256(sha256, expected)) {
+    error = "Expected sha256=<64 hex digits>";
+    return false;
+  }
+  if (!claim()) {
+    error = "Another update is in progress";
+    return false;
+  }
+  closeHandle();
+  strlcpy(pullUrl, url, sizeof(pullUrl));
+  memcpy(session.expected, expected, sizeof(expected));
+  portENTER_CRITICAL(&otaLock);
+  session.status.state = OtaState::Receiving;
+  session.status.pull = true;
+  session.status.size = 0;
+  session.status.written = 0;
+  session.status.error[0] = '\0';
+  portEXIT_CRITICAL(&otaLock);
+  // The claim passes to the task, which releases it when done
+  if (xTaskCreate(pullTask, "ota", OTA_PULL_STACK_SIZE, nullptr, 1, nullptr) != pdPASS) {
+    fail("No memory for the download task");
+    release();
+    error = session.status.error;
+    return false;
+  }
+  return true;
+}
+
+// --- Control loop ---
+
+void beginOta() {
+  esp_ota_img_states_t state;
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  pendingVerify = esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY;
+  if (pendingVerify) Serial.printf("OTA: new image on %s, waiting for it to prove healthy\n", running->label);
+}
+
+bool serviceOta(bool isHealthy) {
+  unsigned long now = millis();
+  if (pendingVerify) {
+    if (!isHealthy) {
+      healthy = false;
+    } else if (!healthy) {
+      healthy = true;
+      healthySince = now;
+    }
+    if (healthy && now - healthySince >= OTA_HEALTHY_UPTIME) {
+      esp_ota_mark_app_valid_cancel_rollback();
+      pendingVerify = false;
+      Serial.println("OTA: new image confirmed");
+    } else if (now >= OTA_CONFIRM_TIMEOUT) {
+      Serial.println("OTA: new image never became healthy, rolling back");
+      esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+  }
+
+  if (session.status.state == OtaState::Paused && now - session.pausedAt >= OTA_RESUME_TIMEOUT && claim()) {
+    if (session.status.state == OtaState::Paused) fail("Paused update expired");
+    release();
+  }
+  return session.status.state == OtaState::Done && now - session.doneAt >= OTA_RESTART_DELAY;
+}
+
+bool otaEnabled() {
+  return OTA_TOKEN[0] != '\0';
+}
+
+bool otaAuthorized(const char* authorization) {
+  static const char PREFIX[] = "Bearer ";
+  if (!otaEnabled() || authorization == nullptr) return false;
+  if (strncmp(authorization, PREFIX, sizeof(PREFIX) - 1) != 0) return false;
+  const char* token = authorization + sizeof(PREFIX) - 1;
+  size_t length = strlen(token);
+  size_t expectedLength = strlen(OTA_TOKEN);
+  // Every byte of the expected token is compared whatever the input, so
+  // the response time does not tell how much of a guess was right
+  uint8_t diff = length != expectedLength;
+  for (size_t i = 0; i < expectedLength; i++) diff |= (uint8_t)OTA_TOKEN[i] ^ (uint8_t)(i < length ? token[i] : 0);
+  return diff == 0;
+}
+
+OtaStatus otaStatus() {
+  portENTER_CRITICAL(&otaLock);
+  OtaStatus copy = session.status;
+  portEXIT_CRITICAL(&otaLock);
+  copy.pendingVerify = pendingVerify;
+  return copy;
+}
+
+const char* otaRunningPartition() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  return running ? running->label : "";
+}
+
+const char* otaStateName(OtaState state) {
+  return STATE_NAMES[(uint8_t)state];
+}
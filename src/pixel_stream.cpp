@@ -0,0 +1,436 @@
+#include "pixel_stream.h"
+#include <WiFi.h>
+#include <FastLED.h>
+#include <lwip/sockets.h>
+#include "led_output.h"
+#include "led_effects.h"
+#include "loop_events.h"
+
+static const char* const PROTOCOL_NAMES[] = {"none", "ddp", "e131"};
+
+// DDP header: flags, sequence, data type, destination, offset (4), length (2),
+// then a 4-byte timecode when its flag is set
+static const size_t DDP_HEADER = 10;
+static const size_t DDP_TIMECODE_HEADER = 14;
+static const uint8_t DDP_VERSION_MASK = 0xC0;
+static const uint8_t DDP_VERSION_1 = 0x40;
+static const uint8_t DDP_FLAG_TIMECODE = 0x10;
+static const uint8_t DDP_FLAG_QUERY = 0x02;
+static const uint8_t DDP_FLAG_PUSH = 0x01;
+static const uint8_t DDP_ID_DISPLAY = 1;
+static const uint8_t DDP_ID_ALL = 255;
+static const uint8_t DDP_SEQUENCE_MASK = 0x0F; // 1-15, 0 when the sender does not number packets
+
+// E1.31 data packet layout (ANSI E1.31-2018 table 4-1): DMX data starts
+// after the start code at offset 125
+static const size_t E131_HEADER = 126;
+static const size_t E131_SYNC_LENGTH = 49;
+static const uint8_t E131_ACN_ID[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+static const uint32_t E131_ROOT_DATA = 0x00000004;
+static const uint32_t E131_ROOT_EXTENDED = 0x00000008;
+static const uint32_t E131_FRAMING_DATA = 0x00000002;
+static const uint32_t E131_FRAMING_SYNC = 0x00000001;
+static const uint8_t E131_DMP_SET_PROPERTY = 0x02;
+static const uint8_t E131_OPTION_PREVIEW = 0x80;
+static const uint8_t E131_OPTION_TERMINATED = 0x40;
+static const size_t UNIVERSE_BYTES = PIXEL_STREAM_UNIVERSE_PIXELS * 3;
+static const uint8_t MAX_UNIVERSES = (MAX_LEDS + PIXEL_STREAM_UNIVERSE_PIXELS - 1) / PIXEL_STREAM_UNIVERSE_PIXELS;
+// Sync packets must keep coming for frames to wait for them; without one for
+// this long the last universe ends the frame again
+static const unsigned long E131_SYNC_TIMEOUT = 1000; // ms
+// Above the loop and HTTP tasks so a burst of packets is drained promptly
+static const UBaseType_t RECEIVE_PRIORITY = 5;
+
+static int ddpSocket = -1;
+static int e131Socket = -1;
+static uint32_t joinedIp = 0; // station address the E1.31 groups were joined on
+static uint8_t joinedUniverses = 0;
+static uint16_t joinedSync = 0;
+static bool blankNext = false;
+
+// Written by the receiver task and the control loop
+static portMUX_TYPE streamLock = portMUX_INITIALIZER_UNLOCKED;
+static bool owned = false;             // loop: the stream has the strip
+static bool takeoverRequested = false; // receiver: packets are arriving
+static bool framePending = false;      // receiver: a finished frame waits for the strip
+static bool writing = false;           // receiver: copying into the back buffer
+static bool terminated = false;        // receiver: the E1.31 source said goodbye
+static unsigned long lastPacketAt = 0;
+static uint16_t e131SyncUniverse = 0;  // receiver: announced in the last data packet
+static PixelStreamStats stats;
+
+// Only touched by the receiver task
+static bool frameHasData = false;
+static bool frameDamaged = false;
+static uint8_t ddpSequence = 0;
+static uint8_t e131Sequence[MAX_UNIVERSES];
+static bool e131Numbered[MAX_UNIVERSES];
+static unsigned long e131SyncAt = 0;
+static bool e131Synced = false; // a sync packet arrived within E131_SYNC_TIMEOUT
+
+static uint16_t readBe16(const uint8_t* p) {
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static uint32_t readBe32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// --- Receiver side (callers hold nothing) ---
+
+// Reads the rest of a datagram that is not wanted; UDP drops what does not fit
+static void discard(int socket) {
+  uint8_t byte;
+  recv(socket, &byte, sizeof(byte), 0);
+}
+
+static void countDropped() {
+  portENTER_CRITICAL(&streamLock);
+  stats.packetsDropped++;
+  portEXIT_CRITICAL(&streamLock);
+}
+
+static void countLost(uint32_t lost) {
+  portENTER_CRITICAL(&streamLock);
+  stats.packetsLost += lost;
+  portEXIT_CRITICAL(&streamLock);
+}
+
+// The frame to write into and the strip length, or nullptr while the loop
+// still has to take the strip over or a finished frame waits for it.
+static CRGB* beginWrite(PixelProtocol protocol, uint16_t& pixels) {
+  CRGB* frame = nullptr;
+  bool wake = false;
+  portENTER_CRITICAL(&streamLock);
+  lastPacketAt = millis();
+  stats.protocol = protocol;
+  if (!owned) {
+    wake = !takeoverRequested;
+    takeoverRequested = true;
+  } else if (!framePending) {
+    writing = true;
+    frame = ledBackBuffer();
+    pixels = ledCount();
+  }
+  if (frame == nullptr) stats.packetsDropped++;
+  portEXIT_CRITICAL(&streamLock);
+  if (wake) notifyLoop(LOOP_EVENT_STREAM);
+  // Whatever frame this packet belonged to is now incomplete
+  if (frame == nullptr) frameDamaged = true;
+  return frame;
+}
+
+static void endWrite(bool received) {
+  portENTER_CRITICAL(&streamLock);
+  writing = false;
+  if (received) stats.packets++;
+  else stats.packetsDropped++;
+  portEXIT_CRITICAL(&streamLock);
+  if (received) frameHasData = true;
+}
+
+// Push: hands the frame to the loop, or skips it if packets were dropped
+static void finishFrame() {
+  bool wake = false;
+  portENTER_CRITICAL(&streamLock);
+  if (frameDamaged) {
+    stats.framesDropped++;
+  } else if (frameHasData && owned && !framePending) {
+    framePending = true;
+    wake = true;
+  }
+  portEXIT_CRITICAL(&streamLock);
+  frameDamaged = false;
+  frameHasData = false;
+  if (wake) notifyLoop(LOOP_EVENT_STREAM);
+}
+
+// Header into `header`, payload straight into the pixels; returns the
+// datagram bytes received
+static int receiveInto(int socket, uint8_t* header, size_t headerLength, uint8_t* pixels, size_t length) {
+  struct iovec parts[2];
+  parts[0].iov_base = header;
+  parts[0].iov_len = headerLength;
+  parts[1].iov_base = pixels;
+  parts[1].iov_len = length;
+  struct msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = parts;
+  message.msg_iovlen = length > 0 ? 2 : 1;
+  return recvmsg(socket, &message, 0);
+}
+
+static void receiveDdp() {
+  uint8_t header[DDP_TIMECODE_HEADER];
+  int peeked = recv(ddpSocket, header, sizeof(header), MSG_PEEK);
+  size_t headerLength = peeked > 0 && (header[0] & DDP_FLAG_TIMECODE) ? DDP_TIMECODE_HEADER : DDP_HEADER;
+  // Data types other than undefined or RGB (HSL, RGBW, grayscale) have a
+  // different layout per pixel
+  if (peeked < (int)headerLength || (header[0] & DDP_VERSION_MASK) != DDP_VERSION_1 ||
+      (header[0] & DDP_FLAG_QUERY) || ((header[2] >> 3) & 0x07) > 1 ||
+      (header[3] != DDP_ID_DISPLAY && header[3] != DDP_ID_ALL)) {
+    discard(ddpSocket);
+    countDropped();
+    return;
+  }
+  bool push = header[0] & DDP_FLAG_PUSH;
+  uint8_t sequence = header[1] & DDP_SEQUENCE_MASK;
+  uint32_t offset = readBe32(header + 4);
+  uint16_t length = readBe16(header + 8);
+
+  if (sequence != 0 && ddpSequence != 0) {
+    uint8_t gap = (sequence + 15 - ddpSequence) % 15;
+    if (gap > 1) countLost(gap - 1);
+  }
+  ddpSequence = sequence;
+
+  if (length > 0) {
+    uint16_t pixels = 0;
+    CRGB* frame = beginWrite(PixelProtocol::Ddp, pixels);
+    if (frame == nullptr) {
+      discard(ddpSocket);
+    } else {
+      uint32_t bytes = (uint32_t)pixels * 3;
+      size_t room = offset < bytes ? min((uint32_t)length, bytes - offset) : 0;
+      int received = receiveInto(ddpSocket, header, headerLength, (uint8_t*)frame + (offset < bytes ? offset : 0), room);
+      endWrite(received >= (int)headerLength);
+    }
+  } else {
+    discard(ddpSocket);
+  }
+  if (push) finishFrame();
+}
+
+static bool validE131Root(const uint8_t* header, uint32_t vector) {
+  return readBe16(header) == 0x0010 && memcmp(header + 4, E131_ACN_ID, sizeof(E131_ACN_ID)) == 0 &&
+         readBe32(header + 18) == vector;
+}
+
+static void receiveE131() {
+  uint8_t header[E131_HEADER];
+  int peeked = recv(e131Socket, header, sizeof(header), MSG_PEEK);
+  if (peeked >= (int)E131_SYNC_LENGTH && validE131Root(header, E131_ROOT_EXTENDED) &&
+      readBe32(header + 40) == E131_FRAMING_SYNC) {
+    discard(e131Socket);
+    if (e131SyncUniverse != 0 && readBe16(header + 45) == e131SyncUniverse) {
+      e131SyncAt = millis();
+      e131Synced = true;
+      finishFrame();
+    }
+    return;
+  }
+  if (peeked < (int)E131_HEADER || !validE131Root(header, E131_ROOT_DATA) ||
+      readBe32(header + 40) != E131_FRAMING_DATA || header[117] != E131_DMP_SET_PROPERTY) {
+    discard(e131Socket);
+    countDropped();
+    return;
+  }
+  uint8_t options = header[112];
+  uint16_t universe = readBe16(header + 113);
+  uint16_t channels = readBe16(header + 123) - 1; // the count includes the start code
+  // Preview data is for visualisers, and non-zero start codes (per-channel
+  // priority and the like) are not pixel data
+  if ((options & E131_OPTION_PREVIEW) || header[125] != 0) {
+    discard(e131Socket);
+    return;
+  }
+  if (options & E131_OPTION_TERMINATED) {
+    discard(e131Socket);
+    portENTER_CRITICAL(&streamLock);
+    terminated = true;
+    portEXIT_CRITICAL(&streamLock);
+    notifyLoop(LOOP_EVENT_STREAM);
+    return;
+  }
+  if (universe < PIXEL_STREAM_UNIVERSE || universe - PIXEL_STREAM_UNIVERSE >= MAX_UNIVERSES) {
+    discard(e131Socket);
+    countDropped();
+    return;
+  }
+  uint8_t index = universe - PIXEL_STREAM_UNIVERSE;
+
+  // Out of order packets are discarded (E1.31 6.7.2); gaps are counted
+  uint8_t sequence = header[111];
+  if (e131Numbered[index]) {
+    int8_t step = (int8_t)(sequence - e131Sequence[index]);
+    if (step <= 0 && step > -20) {
+      discard(e131Socket);
+      countDropped();
+      return;
+    }
+    if (step > 1) countLost(step - 1);
+  }
+  e131Sequence[index] = sequence;
+  e131Numbered[index] = true;
+  uint16_t syncUniverse = readBe16(header + 109);
+  if (syncUniverse != e131SyncUniverse) {
+    portENTER_CRITICAL(&streamLock);
+    e131SyncUniverse = syncUniverse;
+    portEXIT_CRITICAL(&streamLock);
+    e131Synced = false;
+  }
+  if (e131Synced && millis() - e131SyncAt >= E131_SYNC_TIMEOUT) e131Synced = false;
+
+  uint16_t pixels = 0;
+  CRGB* frame = beginWrite(PixelProtocol::E131, pixels);
+  if (frame == nullptr) {
+    discard(e131Socket);
+  } else {
+    uint32_t offset = (uint32_t)index * UNIVERSE_BYTES;
+    uint32_t bytes = (uint32_t)pixels * 3;
+    size_t room = offset < bytes ? min((uint32_t)min((size_t)channels, UNIVERSE_BYTES), bytes - offset) : 0;
+    int received = receiveInto(e131Socket, header, sizeof(header), (uint8_t*)frame + (offset < bytes ? offset : 0), room);
+    endWrite(received >= (int)sizeof(header));
+  }
+  // Without sync packets, the last universe of the strip ends the frame
+  if (!e131Synced && index == (ledCount() - 1) / PIXEL_STREAM_UNIVERSE_PIXELS) finishFrame();
+}
+
+static void pixelStreamTask(void* parameter) {
+  int highest = max(ddpSocket, e131Socket);
+  for (;;) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(ddpSocket, &readable);
+    FD_SET(e131Socket, &readable);
+    if (select(highest + 1, &readable, nullptr, nullptr, nullptr) <= 0) continue;
+    if (FD_ISSET(ddpSocket, &readable)) receiveDdp();
+    if (FD_ISSET(e131Socket, &readable)) receiveE131();
+  }
+}
+
+// --- Sockets ---
+
+static int openSocket(uint16_t port) {
+  int udp = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (udp < 0) return -1;
+  int reuse = 1;
+  setsockopt(udp, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(port);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(udp, (struct sockaddr*)&local, sizeof(local)) < 0) {
+    close(udp);
+    return -1;
+  }
+  return udp;
+}
+
+// sACN multicasts universe N to 239.255.N/256.N%256
+static void setMembership(int option, uint32_t ip, uint16_t universe) {
+  struct ip_mreq request;
+  request.imr_multiaddr.s_addr = htonl(0xEFFF0000 | universe);
+  request.imr_interface.s_addr = ip;
+  setsockopt(e131Socket, IPPROTO_IP, option, &request, sizeof(request));
+}
+
+// The strip's universes, plus the sync universe when it is not one of them
+static void setMemberships(int option, uint32_t ip, uint8_t universes, uint16_t sync) {
+  for (uint8_t i = 0; i < universes; i++) setMembership(option, ip, PIXEL_STREAM_UNIVERSE + i);
+  if (sync != 0 && (sync < PIXEL_STREAM_UNIVERSE || sync - PIXEL_STREAM_UNIVERSE >= universes)) {
+    setMembership(option, ip, sync);
+  }
+}
+
+// Follows the station address, the strip length and the sync universe the
+// sender announces
+static void serviceMemberships() {
+  uint32_t ip = WiFi.status() == WL_CONNECTED ? (uint32_t)WiFi.localIP() : 0;
+  uint8_t universes = (ledCount() + PIXEL_STREAM_UNIVERSE_PIXELS - 1) / PIXEL_STREAM_UNIVERSE_PIXELS;
+  portENTER_CRITICAL(&streamLock);
+  uint16_t sync = e131SyncUniverse;
+  portEXIT_CRITICAL(&streamLock);
+  if (ip == joinedIp && universes == joinedUniverses && sync == joinedSync) return;
+  // Fails harmlessly when the address is already gone with the link
+  if (joinedIp != 0) setMemberships(IP_DROP_MEMBERSHIP, joinedIp, joinedUniverses, joinedSync);
+  if (ip != 0) setMemberships(IP_ADD_MEMBERSHIP, ip, universes, sync);
+  joinedIp = ip;
+  joinedUniverses = universes;
+  joinedSync = sync;
+}
+
+// --- Control loop ---
+
+void beginPixelStream(BaseType_t core) {
+  ddpSocket = openSocket(PIXEL_STREAM_DDP_PORT);
+  e131Socket = openSocket(PIXEL_STREAM_E131_PORT);
+  if (ddpSocket < 0 || e131Socket < 0) {
+    Serial.println("Pixel stream: sockets unavailable");
+    return;
+  }
+  xTaskCreatePinnedToCore(pixelStreamTask, "pixels", PIXEL_STREAM_STACK_SIZE, nullptr, RECEIVE_PRIORITY, nullptr, core);
+}
+
+bool servicePixelStream(uint8_t brightness) {
+  if (e131Socket < 0) return false;
+  serviceMemberships();
+
+  portENTER_CRITICAL(&streamLock);
+  bool takeOver = !owned && takeoverRequested;
+  bool release = owned && !writing && (terminated || millis() - lastPacketAt >= PIXEL_STREAM_TIMEOUT);
+  if (release) {
+    owned = false;
+    framePending = false;
+  }
+  if (!owned) terminated = false;
+  bool present = owned && framePending;
+  portEXIT_CRITICAL(&streamLock);
+
+  if (takeOver) {
+    // Pixels past the end of the stream stay dark rather than showing the
+    // effect underneath; the other buffer is cleared after the first frame
+    fill_solid(ledBackBuffer(), ledCount(), CRGB::Black);
+    blankNext = true;
+    portENTER_CRITICAL(&streamLock);
+    owned = true;
+    takeoverRequested = false;
+    stats.sessions++;
+    portEXIT_CRITICAL(&streamLock);
+    Serial.println("Pixel stream: started");
+    return true;
+  }
+  if (release) {
+    // The effects engine repaints the saved state over whatever the stream left
+    redrawLedEffects();
+    Serial.println("Pixel stream: stopped");
+    return false;
+  }
+  if (present && ledOutputReady()) {
+    presentLedFrame(brightness);
+    if (blankNext) {
+      fill_solid(ledBackBuffer(), ledCount(), CRGB::Black);
+      blankNext = false;
+    }
+    portENTER_CRITICAL(&streamLock);
+    framePending = false;
+    stats.frames++;
+    portEXIT_CRITICAL(&streamLock);
+  }
+  return owned;
+}
+
+uint32_t pixelStreamWaitTime(uint32_t limit) {
+  portENTER_CRITICAL(&streamLock);
+  bool active = owned;
+  bool pending = framePending;
+  unsigned long since = millis() - lastPacketAt;
+  portEXIT_CRITICAL(&streamLock);
+  if (!active) return limit;
+  // A finished frame waits for the strip: check back shortly
+  if (pending) return ledOutputReady() ? 0 : 1;
+  return min(limit, (uint32_t)(since >= PIXEL_STREAM_TIMEOUT ? 0 : PIXEL_STREAM_TIMEOUT - since));
+}
+
+PixelStreamStats pixelStreamStats() {
+  portENTER_CRITICAL(&streamLock);
+  PixelStreamStats copy = stats;
+  copy.active = owned;
+  portEXIT_CRITICAL(&streamLock);
+  return copy;
+}
+
+const char* pixelProtocolName(PixelProtocol protocol) {
+  return PROTOCOL_NAMES[(uint8_t)protocol];
+}
@@ -0,0 +1,106 @@
+#include "response_writer.h"
+
+void ResponseWriter::begin(int code, const char* contentType) {
+  _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  _server.send(code, contentType, "");
+  _length = 0;
+  _open = true;
+}
+
+void ResponseWriter::end() {
+  if (!_open) return;
+  flush();
+  _server.sendContent("", 0); // zero-length chunk ends the response
+  _open = false;
+}
+
+void ResponseWriter::flush() {
+  if (_length == 0) return;
+  _server.sendContent(_buffer, _length);
+  _length = 0;
+}
+
+void ResponseWriter::write(const char* data, size_t length) {
+  if (_length + length > sizeof(_buffer)) {
+    flush();
+    // Large constant blocks (e.g. the page shell) go out directly
+    if (length >= sizeof(_buffer)) {
+      _server.sendContent(data, length);
+      return;
+    }
+  }
+  memcpy(_buffer + _length, data, length);
+  _length += length;
+}
+
+void ResponseWriter::print(unsigned long value) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+  char text[20];
+  for (size_t i = 0; i < n; i++) text[i] = digits[n - 1 - i];
+  write(text, n);
+}
+
+void ResponseWriter::print(long value) {
+  if (value < 0) {
+    print('-');
+    print(0UL - (unsigned long)value);
+  } else {
+    print((unsigned long)value);
+  }
+}
+
+void ResponseWriter::print(const IPAddress& ip) {
+  for (int i = 0; i < 4; i++) {
+    if (i > 0) print('.');
+    print((unsigned int)ip[i]);
+  }
+}
+
+void ResponseWriter::printEscaped(const char* text) {
+  const char* run = text;
+  for (const char* p = text; *p; p++) {
+    const char* entity;
+    switch (*p) {
+      case '&': entity = "&amp;"; break;
+      case '<': entity = "&lt;"; break;
+      case '>': entity = "&gt;"; break;
+      case '"': entity = "&quot;"; break;
+      case '\'': entity = "&#39;"; break;
+      default: continue;
+    }
+    write(run, p - run);
+    print(entity);
+    run = p + 1;
+  }
+  write(run, strlen(run));
+}
+
+void ResponseWriter::printJsonString(const char* text) {
+  static const char hex[] = "0123456789abcdef";
+  print('"');
+  const char* run = text;
+  for (const char* p = text; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    write(run, p - run);
+    switch (c) {
+      case '"': print("\\\""); break;
+      case '\\': print("\\\\"); break;
+      case '\n': print("\\n"); break;
+      case '\r': print("\\r"); break;
+      case '\t': print("\\t"); break;
+      default: {
+        char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+        write(escape, sizeof(escape));
+      }
+    }
+    run = p + 1;
+  }
+  write(run, strlen(run));
+  print('"');
+}
@@ -0,0 +1,165 @@
+#include "state_api.h"
+#include "json_parser.h"
+#include "color_names.h"
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseColorText(const char* text, size_t length, uint32_t& rgb) {
+  const char* digits = text;
+  size_t count = length;
+  if (count > 0 && digits[0] == '#') {
+    digits++;
+    count--;
+  }
+  if (count == 6 || count == 3) {
+    uint32_t value = 0;
+    bool valid = true;
+    for (size_t i = 0; i < count && valid; i++) {
+      int d = hexDigit(digits[i]);
+      valid = d >= 0;
+      // #rgb doubles every digit
+      value = (count == 3) ? (value << 8) | (d * 0x11) : (value << 4) | d;
+    }
+    if (valid) {
+      rgb = value;
+      return true;
+    }
+  }
+  return lookupColorName(text, length, rgb);
+}
+
+static bool readChannel(const char* json, const JsonToken* tokens, int count, int index, long max, long& value) {
+  return index >= 0 && index < count && jsonToLong(json, tokens[index], value) && value >= 0 && value <= max;
+}
+
+// Accepts a string, an [r,g,b] array, {"r","g","b"} or {"h","s","v"} with
+// h in degrees and s/v in percent.
+static bool parseColor(const char* json, const JsonToken* tokens, int count, int index, uint32_t& rgb) {
+  const JsonToken& token = tokens[index];
+  long r, g, b;
+  switch (token.type) {
+    case JsonType::String:
+      return parseColorText(json + token.start, token.end - token.start, rgb);
+    case JsonType::Array:
+      if (token.size != 3) return false;
+      if (!readChannel(json, tokens, count, index + 1, 255, r) ||
+          !readChannel(json, tokens, count, index + 2, 255, g) ||
+          !readChannel(json, tokens, count, index + 3, 255, b)) {
+        return false;
+      }
+      break;
+    case JsonType::Object:
+      if (jsonObjectGet(json, tokens, count, index, "h") >= 0) {
+        long h, s, v;
+        if (!readChannel(json, tokens, count, jsonObjectGet(json, tokens, count, index, "h"), 360, h) ||
+            !readChannel(json, tokens, count, jsonObjectGet(json, tokens, count, index, "s"), 100, s) ||
+            !readChannel(json, tokens, count, jsonObjectGet(json, tokens, count, index, "v"), 100, v)) {
+          return false;
+        }
+        CRGB color;
+        hsv2rgb_spectrum(CHSV(h % 360 * 256 / 360, s * 255 / 100, v * 255 / 100), color);
+        r = color.r;
+        g = color.g;
+        b = color.b;
+      } else if (!readChannel(json, tokens, count, jsonObjectGet(json, tokens, count, index, "r"), 255, r) ||
+                 !readChannel(json, tokens, count, jsonObjectGet(json, tokens, count, index, "g"), 255, g) ||
+                 !readChannel(json, tokens, count, jsonObjectGet(json, tokens, count, index, "b"), 255, b)) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+  rgb = ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+  return true;
+}
+
+static bool parseUpdate(const char* json, const JsonToken* tokens, int count, int object, StateUpdate& update,
+                        const char*& error) {
+  if (tokens[object].type != JsonType::Object) {
+    error = "Each update must be an object";
+    return false;
+  }
+  memset(&update, 0, sizeof(update));
+  LedUpdate& led = update.led;
+  int index;
+  long number;
+
+  if ((index = jsonObjectGet(json, tokens, count, object, "on")) >= 0) {
+    if (!jsonToBool(json, tokens[index], led.on)) {
+      error = "\"on\" must be true or false";
+      return false;
+    }
+    led.fields |= STATE_ON;
+  }
+  if ((index = jsonObjectGet(json, tokens, count, object, "color")) >= 0) {
+    if (!parseColor(json, tokens, count, index, led.color)) {
+      error = "Unrecognised \"color\"";
+      return false;
+    }
+    led.fields |= STATE_COLOR;
+  }
+  if ((index = jsonObjectGet(json, tokens, count, object, "brightness")) >= 0) {
+    if (!readChannel(json, tokens, count, index, 255, number)) {
+      error = "\"brightness\" must be 0-255";
+      return false;
+    }
+    led.brightness = number;
+    led.fields |= STATE_BRIGHTNESS;
+  }
+  if ((index = jsonObjectGet(json, tokens, count, object, "effect")) >= 0) {
+    char name[12];
+    if (!jsonToString(json, tokens[index], name, sizeof(name)) || !parseLedEffect(name, led.effect)) {
+      error = "Unknown \"effect\"";
+      return false;
+    }
+    led.fields |= STATE_EFFECT;
+  }
+  if ((index = jsonObjectGet(json, tokens, count, object, "period")) >= 0) {
+    if (!jsonToLong(json, tokens[index], number) || number < 100 || number > 60000) {
+      error = "\"period\" must be 100-60000 ms";
+      return false;
+    }
+    led.period = number;
+    led.fields |= STATE_PERIOD;
+  }
+  if ((index = jsonObjectGet(json, tokens, count, object, "wifi")) >= 0) {
+    int ssid = jsonObjectGet(json, tokens, count, index, "ssid");
+    int password = jsonObjectGet(json, tokens, count, index, "password");
+    if (ssid < 0 || !jsonToString(json, tokens[ssid], update.ssid, sizeof(update.ssid)) || update.ssid[0] == '\0' ||
+        (password >= 0 && !jsonToString(json, tokens[password], update.password, sizeof(update.password)))) {
+      error = "\"wifi\" needs an \"ssid\" (max 32) and optional \"password\" (max 64)";
+      return false;
+    }
+    update.connect = true;
+  }
+  return true;
+}
+
+int parseStateUpdates(const char* json, size_t length, StateUpdate* updates, int maxUpdates, const char*& error) {
+  JsonToken tokens[MAX_STATE_TOKENS];
+  int count = jsonParse(json, length, tokens, MAX_STATE_TOKENS);
+  if (count <= 0) {
+    error = (count == JSON_ERROR_NO_TOKENS) ? "Request too large" : "Malformed JSON";
+    return -1;
+  }
+
+  if (tokens[0].type != JsonType::Array) {
+    return parseUpdate(json, tokens, count, 0, updates[0], error) ? 1 : -1;
+  }
+  if (tokens[0].size > maxUpdates) {
+    error = "Too many updates in one request";
+    return -1;
+  }
+  int index = 1;
+  for (uint16_t i = 0; i < tokens[0].size; i++) {
+    if (!parseUpdate(json, tokens, count, index, updates[i], error)) return -1;
+    index = jsonSkip(tokens, count, index);
+  }
+  return tokens[0].size;
+}
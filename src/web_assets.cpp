@@ -0,0 +1,164 @@
+// Generated by tools/embed_assets.py from web/ - do not edit.
+#include "web_assets.h"
+
+const char PAGE_HEAD[] PROGMEM = "<!DOCTYPE html><html><head><meta name='viewport' content='width=device-width,initial-scale=1'><link rel='stylesheet' href='/app.css?v=2342302c9c06'><title>";
+const char PAGE_NAV[] PROGMEM = "</title></head><body><div class='toggle-container'><input type='checkbox' id='dark-mode' class='toggle-input'/><label for='dark-mode' class='toggle-label'><svg class='sun' viewBox='0 0 24 24' fill='none' xmlns='http://www.w3.org/2000/svg'><path d='M12 3V4M12 20V21M4 12H3M6.31412 6.31412L5.5 5.5M17.6859 6.31412L18.5 5.5M6.31412 17.69L5.5 18.5001M17.6859 17.69L18.5 18.5001M21 12H20M16 12C16 14.2091 14.2091 16 12 16C9.79086 16 8 14.2091 8 12C8 9.79086 9.79086 8 12 8C14.2091 8 16 9.79086 16 12Z' stroke='currentColor' stroke-width='2' stroke-linecap='round' stroke-linejoin='round'/></svg><svg class='moon' viewBox='0 0 24 24' fill='none' xmlns='http://www.w3.org/2000/svg'><path d='M3.32031 11.6835C3.32031 16.6541 7.34975 20.6835 12.3203 20.6835C16.1075 20.6835 19.3483 18.3443 20.6768 15.032C19.6402 15.4486 18.5059 15.6834 17.3203 15.6834C12.3497 15.6834 8.32031 11.654 8.32031 6.68342C8.32031 5.50338 8.55165 4.36259 8.96453 3.32996C5.65605 4.66028 3.32031 7.89912 3.32031 11.6835Z' stroke='currentColor' stroke-width='2' stroke-linecap='round' stroke-linejoin='round'/></svg></label></div><div class='container'><div class='nav'><a href='/'>GLOW by zamil</a><a href='/wifi-setup'>WiFi Setup</a><a href='/led'>LED Control</a><a href='/timer'>Timer</a><a href='/info'>Info</a></div>";
+const char PAGE_FOOT[] PROGMEM = "</div><script src='/app.js?v=090b573db44b'></script></body></html>";
+
+const uint8_t APP_CSS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x56, 0xdd, 0x8e, 0xa3, 0x3a,
+  0x0c, 0xbe, 0xef, 0x53, 0x44, 0xea, 0xc5, 0xee, 0xec, 0x29, 0x5d, 0xfa, 0x03, 0xed, 0xc2, 0xd5,
+  0x4a, 0xe7, 0x45, 0x42, 0x62, 0x20, 0x2a, 0x4d, 0x50, 0x08, 0x6d, 0x67, 0x51, 0xdf, 0xfd, 0xe4,
+  0x8f, 0x16, 0x68, 0x67, 0x3a, 0x67, 0x6b, 0x8d, 0x94, 0x21, 0xce, 0x67, 0x7f, 0xb6, 0xe3, 0x38,
+  0x13, 0xf4, 0xbd, 0xcb, 0x05, 0x57, 0x41, 0x8e, 0x8f, 0xac, 0x7a, 0x4f, 0x7e, 0x4b, 0x86, 0xab,
+  0xf4, 0x88, 0x65, 0xc1, 0x78, 0x12, 0xa6, 0x35, 0xa6, 0x94, 0xf1, 0x22, 0x59, 0x87, 0xf5, 0x25,
+  0xcd, 0x30, 0x39, 0x14, 0x52, 0xb4, 0x9c, 0x26, 0xf3, 0x3c, 0x34, 0x92, 0x1e, 0x19, 0x0f, 0x4a,
+  0x60, 0x45, 0xa9, 0x92, 0x55, 0x18, 0x9e, 0xca, 0x54, 0x49, 0xcc, 0x1b, 0xa6, 0x98, 0xe0, 0xc9,
+  0x5d, 0x1d, 0x85, 0xcb, 0x4d, 0x93, 0x5e, 0x67, 0x4b, 0xa2, 0x2d, 0x61, 0xc6, 0x41, 0x76, 0x47,
+  0x7c, 0x09, 0xce, 0x8c, 0xaa, 0x32, 0x89, 0x43, 0x83, 0xdd, 0x5b, 0x44, 0xb8, 0x55, 0x62, 0x68,
+  0xe9, 0x5c, 0x32, 0x05, 0x13, 0x3f, 0x84, 0xa4, 0x20, 0x03, 0x89, 0x29, 0x6b, 0x1b, 0x6d, 0x57,
+  0x7f, 0xfa, 0xd8, 0xec, 0x82, 0x88, 0x4a, 0xc8, 0x9b, 0x07, 0x1c, 0x9f, 0x3a, 0x67, 0x2b, 0xc8,
+  0x84, 0x52, 0xe2, 0xe8, 0x20, 0xaf, 0xc8, 0xec, 0x20, 0xdc, 0xef, 0x49, 0x47, 0x29, 0x32, 0xd0,
+  0x70, 0x51, 0x01, 0x05, 0x22, 0x24, 0xb6, 0xf8, 0x5c, 0x70, 0x48, 0x2d, 0x68, 0x32, 0x0f, 0xc3,
+  0x5d, 0x96, 0xe7, 0x43, 0xeb, 0x63, 0x6b, 0x8d, 0xc2, 0xaa, 0x6d, 0x82, 0xa6, 0x25, 0x04, 0x9a,
+  0xa6, 0x1b, 0x06, 0x90, 0x6e, 0x81, 0x52, 0xdc, 0x03, 0xad, 0xa2, 0x68, 0xb7, 0xde, 0xde, 0x68,
+  0xae, 0x1e, 0x69, 0x46, 0xf7, 0x20, 0x99, 0x5d, 0x14, 0x0e, 0xf0, 0x29, 0xe6, 0x85, 0x8e, 0xe9,
+  0x28, 0x3f, 0x7b, 0xba, 0xbb, 0xc3, 0xef, 0xd6, 0x2b, 0xf2, 0xf7, 0xf0, 0x67, 0x2c, 0xb9, 0x3e,
+  0x36, 0xc6, 0xcf, 0xf3, 0x0d, 0xa1, 0x3d, 0xfe, 0x3e, 0x8a, 0xb7, 0xe1, 0xff, 0xc7, 0xe7, 0xa0,
+  0xce, 0x42, 0x1e, 0x46, 0xc0, 0xf0, 0x0b, 0x08, 0xe4, 0xbd, 0x6e, 0x64, 0x55, 0x5f, 0xe0, 0x92,
+  0x56, 0x36, 0xda, 0x8b, 0x5a, 0x30, 0xae, 0x40, 0xbe, 0x28, 0x41, 0x6f, 0x33, 0x29, 0xc5, 0x69,
+  0x12, 0x32, 0x0a, 0xb0, 0x86, 0xd8, 0xf2, 0x86, 0x0a, 0x88, 0x02, 0x3a, 0xda, 0x5e, 0xef, 0xf1,
+  0x6e, 0x1b, 0x79, 0xc6, 0xae, 0x2a, 0xaf, 0x33, 0xc6, 0xeb, 0x56, 0x2d, 0xb2, 0x56, 0x57, 0x12,
+  0xef, 0x7a, 0x37, 0xf7, 0x77, 0xae, 0xce, 0x7f, 0xe7, 0x72, 0xb2, 0xd2, 0xff, 0x34, 0xa2, 0x62,
+  0x14, 0xcd, 0x09, 0x21, 0x13, 0x22, 0x5b, 0x53, 0x85, 0x33, 0x8f, 0x34, 0xb4, 0xeb, 0x6b, 0x6c,
+  0x68, 0x77, 0x42, 0xf8, 0x3a, 0xc3, 0xdd, 0xa4, 0x20, 0x9f, 0xd5, 0xac, 0x56, 0xf3, 0xac, 0xa7,
+  0xdb, 0xda, 0x0e, 0xc8, 0x8a, 0x59, 0x9d, 0x9f, 0x3f, 0xd0, 0xbf, 0x58, 0x1e, 0xd0, 0x51, 0x50,
+  0x40, 0x4a, 0x14, 0x45, 0x05, 0xe8, 0xc7, 0xcf, 0xd9, 0xd2, 0x2d, 0x83, 0xfb, 0x0d, 0xae, 0x85,
+  0x0f, 0x72, 0xce, 0x2e, 0x40, 0x53, 0x25, 0x6a, 0x77, 0x95, 0xdc, 0xd5, 0xb1, 0xcb, 0x3f, 0x01,
+  0xd3, 0xc8, 0x17, 0xd3, 0x1a, 0x6c, 0xbe, 0x3d, 0x86, 0x0d, 0x5a, 0xe7, 0x6e, 0x7f, 0x98, 0xfa,
+  0xf6, 0x11, 0xa6, 0x27, 0xd6, 0xb0, 0x8c, 0x55, 0x4c, 0xbd, 0x27, 0x25, 0xa3, 0x14, 0xf8, 0xe0,
+  0x48, 0x85, 0x33, 0xa8, 0xba, 0xbe, 0x61, 0x68, 0x68, 0x7f, 0x6a, 0x63, 0xd6, 0x37, 0x4f, 0x24,
+  0x54, 0x9a, 0xd0, 0x09, 0x52, 0xca, 0x9a, 0xba, 0xc2, 0xef, 0x49, 0x56, 0x09, 0x72, 0x18, 0xf5,
+  0x2d, 0xc8, 0x8c, 0x4c, 0x62, 0xbf, 0x71, 0x75, 0x75, 0x09, 0x9a, 0x12, 0x53, 0x71, 0x4e, 0x18,
+  0x6f, 0x40, 0x21, 0x53, 0xa6, 0x6b, 0xfd, 0xa7, 0xd3, 0x89, 0x64, 0x91, 0xe1, 0xef, 0xe1, 0xc2,
+  0xca, 0x72, 0xfb, 0xf6, 0x49, 0xc9, 0xf5, 0x75, 0x36, 0x74, 0x3c, 0xc1, 0xb9, 0xd6, 0xea, 0x4c,
+  0xec, 0x80, 0xab, 0xe4, 0xdb, 0xb7, 0xd4, 0x31, 0x59, 0xc7, 0x77, 0x26, 0x76, 0x7d, 0x63, 0x82,
+  0x33, 0x5d, 0x28, 0xad, 0x4e, 0xb5, 0x0d, 0xab, 0xde, 0xa9, 0x20, 0x57, 0x76, 0x31, 0x20, 0x63,
+  0x32, 0x86, 0x65, 0x50, 0x18, 0x16, 0x1a, 0xf7, 0xfb, 0x6a, 0x1f, 0x52, 0x28, 0x16, 0xfa, 0x6e,
+  0x12, 0xb2, 0xff, 0xb5, 0x98, 0xd3, 0xfd, 0x3e, 0x0e, 0xb3, 0xb7, 0x09, 0x59, 0x6b, 0x68, 0x40,
+  0xb6, 0xa7, 0x19, 0x4d, 0x69, 0xae, 0xdf, 0x3e, 0xe1, 0x65, 0x73, 0x98, 0x90, 0x12, 0xc8, 0x01,
+  0x28, 0xfa, 0x07, 0x8d, 0x13, 0x35, 0xba, 0x37, 0x5b, 0x23, 0x5f, 0x3d, 0xea, 0x43, 0x65, 0xe9,
+  0x6e, 0xbe, 0xc8, 0x77, 0x67, 0x7f, 0x8b, 0xf9, 0x06, 0x1b, 0x79, 0x7b, 0x8c, 0x3e, 0x31, 0x45,
+  0xe1, 0x91, 0x5d, 0xe4, 0x2d, 0xf4, 0x44, 0x0f, 0x35, 0xa7, 0xa2, 0x7b, 0xcc, 0x80, 0x3b, 0xb0,
+  0x32, 0x51, 0x33, 0xc9, 0xd8, 0x8d, 0xeb, 0xfa, 0x55, 0xea, 0x0d, 0xe8, 0xb2, 0x69, 0xb9, 0x63,
+  0x64, 0x40, 0x72, 0x56, 0x55, 0xb6, 0x7f, 0xea, 0xdf, 0x53, 0xed, 0xa3, 0xd0, 0x1d, 0xc0, 0xdd,
+  0xa2, 0xbb, 0xfe, 0x0e, 0x8c, 0x7c, 0x35, 0x8a, 0x37, 0xab, 0x7f, 0x7d, 0xd8, 0x3a, 0x31, 0x71,
+  0x75, 0xd4, 0x1a, 0x02, 0x94, 0xe9, 0xd9, 0x01, 0x91, 0x0a, 0x37, 0x0d, 0xc2, 0x75, 0x2d, 0x05,
+  0x26, 0xa5, 0xe9, 0x14, 0xe6, 0xf3, 0x92, 0x6a, 0xbd, 0xc0, 0xe8, 0x8d, 0x4a, 0x61, 0x85, 0x8d,
+  0x98, 0x36, 0x37, 0xd2, 0x41, 0x83, 0xb9, 0x60, 0x54, 0x39, 0xd4, 0x48, 0xff, 0xc6, 0xdc, 0xdc,
+  0x98, 0x1e, 0x76, 0x0f, 0xb7, 0xd7, 0x8a, 0xe3, 0x6c, 0xf3, 0x5c, 0xeb, 0xc9, 0x5b, 0xa3, 0xdf,
+  0x2c, 0x2d, 0xaf, 0x0d, 0x7c, 0xf8, 0x64, 0x44, 0xa1, 0x91, 0xc7, 0x23, 0xae, 0xc3, 0xbd, 0x34,
+  0xe5, 0x2f, 0xe6, 0xcd, 0xf5, 0xf8, 0x89, 0xf1, 0x4f, 0x46, 0x08, 0x3f, 0x34, 0xf8, 0xe3, 0x7e,
+  0xa0, 0xf8, 0x10, 0xe1, 0xc9, 0x90, 0xe0, 0xc7, 0x82, 0xde, 0x29, 0x37, 0x32, 0x7c, 0x08, 0xf0,
+  0x6c, 0x0c, 0xf0, 0x0f, 0xff, 0x9d, 0x96, 0x19, 0x0a, 0x1e, 0x10, 0x9e, 0xbd, 0x6a, 0x34, 0x86,
+  0x9c, 0x4e, 0x22, 0xe0, 0x3f, 0x5e, 0x67, 0xff, 0x01, 0xc4, 0xef, 0x5a, 0xeb, 0x97, 0x0a, 0x00,
+  0x00,
+};
+const size_t APP_CSS_GZ_LEN = sizeof(APP_CSS_GZ);
+
+const uint8_t APP_JS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x57, 0xc1, 0x72, 0xdb, 0x36,
+  0x10, 0xbd, 0xeb, 0x2b, 0xb6, 0x3e, 0x84, 0xe4, 0x44, 0x82, 0x6c, 0xf7, 0x92, 0xb1, 0xab, 0x74,
+  0x12, 0x3b, 0x9e, 0x49, 0xc7, 0x95, 0x33, 0x91, 0x3b, 0x3d, 0x64, 0x72, 0x80, 0xc8, 0xa5, 0xc8,
+  0x98, 0x02, 0x54, 0x00, 0x94, 0xe2, 0x49, 0x74, 0xec, 0xad, 0x9f, 0xd0, 0xfe, 0x5c, 0xbf, 0xa4,
+  0xbb, 0x00, 0x29, 0x51, 0xb2, 0xec, 0xa6, 0x9d, 0x49, 0x46, 0x24, 0xb8, 0xfb, 0x76, 0xf1, 0xb0,
+  0xfb, 0xb0, 0x1e, 0x0e, 0xe1, 0x52, 0x9a, 0x3b, 0x98, 0xeb, 0x0c, 0xc1, 0xe9, 0xd9, 0xac, 0xc2,
+  0x5e, 0xaa, 0x95, 0x75, 0xcd, 0x0b, 0x8c, 0x20, 0xd3, 0x69, 0x3d, 0x47, 0xe5, 0xc4, 0x0c, 0xdd,
+  0x9b, 0x0a, 0xf9, 0xf1, 0xf5, 0xfd, 0xdb, 0x2c, 0x8e, 0x32, 0x72, 0x1c, 0xb0, 0x63, 0x94, 0x9c,
+  0x37, 0x4e, 0x53, 0x9d, 0xdd, 0x77, 0x5d, 0xf8, 0xfd, 0xbc, 0x17, 0xa0, 0x84, 0xcc, 0xb2, 0x37,
+  0x4b, 0x5a, 0xbd, 0x2e, 0xad, 0x43, 0x85, 0x26, 0x8e, 0xd2, 0x42, 0xaa, 0x19, 0x46, 0x7d, 0xc8,
+  0x6b, 0x95, 0xba, 0x52, 0xab, 0x38, 0x81, 0x2f, 0x3d, 0x80, 0x32, 0x87, 0xd8, 0x15, 0xa5, 0x15,
+  0x69, 0x81, 0xe9, 0x1d, 0x66, 0x61, 0x15, 0x3c, 0xbc, 0x48, 0x2b, 0x69, 0x2d, 0x63, 0x30, 0xe0,
+  0x5e, 0x16, 0x6c, 0x54, 0xe9, 0x54, 0x56, 0x13, 0xa7, 0x8d, 0x9c, 0xa1, 0xb0, 0xe8, 0xde, 0x3a,
+  0x9c, 0x07, 0xb3, 0x9f, 0xd9, 0xaa, 0x0f, 0x11, 0x2a, 0x39, 0xad, 0x30, 0x0b, 0x0e, 0x6b, 0xc0,
+  0xca, 0xe2, 0xe1, 0x00, 0x06, 0xe7, 0x7a, 0x89, 0xff, 0x2b, 0x46, 0x56, 0xda, 0x6e, 0x90, 0xde,
+  0x9a, 0x7e, 0x79, 0x5b, 0x3b, 0x9e, 0xb3, 0x07, 0x9e, 0x09, 0x8c, 0x46, 0xa3, 0x4e, 0x86, 0x3e,
+  0xaf, 0x6f, 0xd8, 0x76, 0x43, 0x71, 0xc3, 0x17, 0x1d, 0x81, 0x33, 0x35, 0x9e, 0xf7, 0xd6, 0xbd,
+  0xde, 0x70, 0x08, 0xbf, 0x96, 0x57, 0x25, 0x50, 0x96, 0xf5, 0xe2, 0x0c, 0x5c, 0x81, 0xa0, 0xd0,
+  0xad, 0x34, 0x1d, 0x7a, 0x45, 0x68, 0x50, 0x5a, 0x30, 0xa8, 0x32, 0x34, 0xe4, 0x96, 0x1b, 0x3d,
+  0x87, 0xa1, 0x5c, 0x94, 0x43, 0x9b, 0x4a, 0x25, 0x3e, 0x59, 0xad, 0x04, 0xbc, 0x82, 0xd3, 0xe3,
+  0x53, 0x98, 0xa3, 0x54, 0x96, 0xc1, 0x18, 0x20, 0xc3, 0x65, 0x99, 0x22, 0xbb, 0x5a, 0x57, 0x56,
+  0x15, 0xb0, 0xb5, 0x2a, 0xd5, 0xac, 0x0f, 0x56, 0x83, 0x2d, 0xf4, 0x0a, 0x56, 0x85, 0x24, 0x68,
+  0x07, 0x85, 0xb4, 0x20, 0x55, 0x06, 0xd2, 0xde, 0x81, 0x9c, 0xc9, 0x52, 0xf1, 0x67, 0xe3, 0xaa,
+  0x7b, 0xc1, 0x58, 0xef, 0xf5, 0xca, 0x86, 0xa0, 0x8c, 0xaa, 0x2b, 0xca, 0x02, 0x7c, 0x68, 0x5a,
+  0x94, 0x33, 0xae, 0x20, 0x48, 0xa5, 0x31, 0xf7, 0xfc, 0xb9, 0x34, 0x30, 0x99, 0xbc, 0xbd, 0x04,
+  0x82, 0xc8, 0xa4, 0x93, 0x03, 0x6b, 0xcb, 0x4c, 0xf4, 0xda, 0xc2, 0xa1, 0xed, 0x55, 0x98, 0xba,
+  0x71, 0xd8, 0x59, 0x8c, 0x15, 0xa5, 0x42, 0x06, 0x44, 0x04, 0x56, 0x82, 0xed, 0x69, 0xfb, 0x82,
+  0x57, 0x02, 0xa3, 0x8f, 0xd6, 0x74, 0x80, 0xc1, 0xcc, 0xc3, 0x47, 0x89, 0x70, 0xf8, 0xd9, 0x5d,
+  0x68, 0xe5, 0x38, 0x95, 0x91, 0x87, 0x3c, 0x7f, 0xd2, 0x3d, 0x78, 0x2d, 0x65, 0x55, 0xe3, 0xb7,
+  0xd8, 0x53, 0xd7, 0x28, 0xf4, 0x1b, 0x18, 0xe4, 0xda, 0xcc, 0xc9, 0xd5, 0xba, 0x7b, 0x3a, 0x47,
+  0xaa, 0x9e, 0x45, 0x25, 0xb9, 0x95, 0xa2, 0x29, 0x55, 0xcc, 0x5d, 0xb4, 0x83, 0xf2, 0x5b, 0x8d,
+  0xe6, 0x7e, 0xe2, 0x33, 0xd5, 0xe6, 0x55, 0x55, 0xc5, 0x91, 0x68, 0x8e, 0x94, 0x00, 0x08, 0xe7,
+  0x8d, 0x4c, 0x8b, 0x58, 0xc1, 0xe8, 0x25, 0xa8, 0x03, 0xc5, 0xdc, 0x6e, 0x31, 0x4a, 0x7c, 0xe5,
+  0x10, 0x3f, 0x7b, 0xa5, 0xb5, 0x35, 0xe0, 0x02, 0xda, 0x30, 0x1c, 0xaa, 0xa4, 0x61, 0xd8, 0xc6,
+  0x5c, 0x3c, 0xfd, 0xb6, 0x94, 0x6c, 0xa0, 0x95, 0xd7, 0xf6, 0x28, 0x8b, 0x7c, 0xea, 0xad, 0xd9,
+  0x6e, 0x76, 0xa1, 0xe7, 0x82, 0x72, 0x18, 0x2a, 0x9a, 0x8e, 0x70, 0xa4, 0x06, 0xa5, 0xc3, 0x86,
+  0x2b, 0xaa, 0xf6, 0x72, 0xd9, 0xb6, 0x1e, 0x19, 0x86, 0x84, 0xc7, 0x72, 0xce, 0x1c, 0x47, 0xed,
+  0xd6, 0xcf, 0x3b, 0x68, 0x2a, 0x7c, 0x7b, 0x0c, 0xce, 0x3a, 0xa3, 0xd5, 0xac, 0x45, 0x64, 0xe3,
+  0xbd, 0xac, 0x95, 0x68, 0x8f, 0x2e, 0x04, 0x94, 0x8b, 0x05, 0xed, 0xfe, 0xa2, 0x28, 0xab, 0x2c,
+  0x66, 0xf3, 0xe4, 0xf0, 0xa7, 0xbd, 0x78, 0xb7, 0x84, 0x39, 0xa6, 0x16, 0x8d, 0x23, 0xa0, 0x7f,
+  0xcf, 0x09, 0xd5, 0x10, 0x2c, 0x3d, 0x44, 0x90, 0xbd, 0x9e, 0x27, 0x30, 0x00, 0x5e, 0x8d, 0x95,
+  0xd0, 0x04, 0x01, 0x3f, 0x42, 0x74, 0x43, 0xbf, 0x11, 0x9c, 0x41, 0x34, 0xc1, 0xb4, 0x36, 0xfe,
+  0x88, 0x3a, 0x91, 0xb4, 0x4a, 0xab, 0x32, 0xbd, 0xa3, 0xf4, 0x48, 0x26, 0x89, 0xbe, 0xdd, 0x92,
+  0x27, 0x8b, 0x7e, 0x93, 0x77, 0x2b, 0x52, 0xfe, 0x44, 0x3b, 0xe9, 0x91, 0x49, 0x50, 0xa3, 0xdd,
+  0x83, 0xad, 0xb4, 0xcc, 0x36, 0xc7, 0x1a, 0x0e, 0x32, 0xb0, 0xe8, 0xf5, 0xe1, 0x89, 0x0b, 0x80,
+  0x3b, 0x75, 0x60, 0xd0, 0xd6, 0x95, 0xb3, 0x81, 0x4c, 0x56, 0xb8, 0xef, 0x7c, 0xdc, 0x94, 0x23,
+  0x52, 0xc9, 0x88, 0x0a, 0xd5, 0xcc, 0x15, 0xc9, 0xc1, 0xda, 0x98, 0x34, 0xba, 0x21, 0x84, 0xf0,
+  0xc7, 0x97, 0xa3, 0xa3, 0xda, 0x88, 0x76, 0x15, 0x88, 0xbb, 0xb0, 0x40, 0x15, 0x1b, 0xde, 0xb3,
+  0xf1, 0x4b, 0x71, 0xb3, 0x94, 0x6d, 0xab, 0x88, 0x23, 0x67, 0x62, 0x53, 0x67, 0x21, 0x2a, 0x7c,
+  0xfd, 0x4a, 0x1e, 0xd6, 0x49, 0x57, 0x5b, 0x2f, 0xac, 0xa7, 0xc7, 0xc7, 0xc9, 0xe1, 0x42, 0xde,
+  0xfa, 0x36, 0xec, 0x31, 0xe0, 0x9e, 0xef, 0x69, 0xc2, 0x2a, 0x7a, 0x5b, 0xce, 0x51, 0xd7, 0x2e,
+  0xee, 0xd2, 0xd6, 0x87, 0x93, 0x63, 0x82, 0x0e, 0x9e, 0xfe, 0x3e, 0xf1, 0x4c, 0x3c, 0x48, 0xe8,
+  0x30, 0x0d, 0x63, 0xbd, 0x69, 0x10, 0xc8, 0x75, 0xad, 0xb2, 0xc0, 0xc6, 0x3a, 0x49, 0x44, 0x2a,
+  0x99, 0x91, 0x70, 0xde, 0x8f, 0x31, 0x08, 0xb9, 0x2c, 0xe9, 0xb2, 0x10, 0xa1, 0x5f, 0x59, 0x57,
+  0xaf, 0xcb, 0x25, 0x42, 0xbd, 0x20, 0xdd, 0x43, 0x7b, 0xd6, 0x55, 0xec, 0x45, 0x6d, 0x0b, 0x64,
+  0xd5, 0xa6, 0x2f, 0x40, 0x6a, 0x40, 0x9a, 0x8a, 0x86, 0x7e, 0x06, 0x13, 0xc6, 0xf3, 0xb7, 0xb3,
+  0x05, 0x2a, 0x89, 0x05, 0x69, 0x34, 0xbc, 0x38, 0xf1, 0x22, 0xdd, 0x1c, 0xb9, 0x85, 0x39, 0x5d,
+  0x39, 0x74, 0x49, 0x78, 0xf5, 0xad, 0x28, 0xc2, 0x28, 0xfa, 0x81, 0x7b, 0xe1, 0x65, 0x04, 0xd2,
+  0xb4, 0xe1, 0x32, 0xd6, 0x67, 0x92, 0xae, 0x14, 0x3b, 0xda, 0xcc, 0xc6, 0x13, 0x74, 0xbe, 0x73,
+  0xfa, 0xc0, 0x3b, 0xd8, 0x53, 0xe1, 0x07, 0x82, 0x76, 0xf4, 0xa1, 0x13, 0xe5, 0x88, 0x5b, 0x87,
+  0x1b, 0xfa, 0x39, 0x1c, 0x45, 0x1f, 0x8f, 0xb6, 0x12, 0x87, 0xcc, 0xca, 0x7e, 0xeb, 0x7a, 0x78,
+  0x26, 0xc2, 0x57, 0xc4, 0xc1, 0x08, 0x71, 0xb4, 0x85, 0xff, 0x48, 0x77, 0xec, 0xb3, 0x67, 0xb0,
+  0x2a, 0x55, 0x46, 0x2d, 0xe6, 0x19, 0x98, 0xe8, 0xda, 0xa4, 0xd8, 0x6d, 0x04, 0x0c, 0xc4, 0x90,
+  0x2e, 0xe0, 0x0a, 0x3a, 0x36, 0x54, 0xaa, 0x43, 0x6e, 0x61, 0xbe, 0xd4, 0x79, 0xa7, 0xa2, 0xd0,
+  0xd6, 0x35, 0xa9, 0x46, 0x67, 0x2f, 0x4e, 0x86, 0xc1, 0x31, 0xf4, 0x46, 0x78, 0x3e, 0x30, 0x05,
+  0xf1, 0x45, 0xdf, 0x07, 0xdc, 0x57, 0x44, 0xbe, 0xbc, 0x7e, 0x9a, 0xdc, 0x8c, 0xc5, 0x42, 0x1a,
+  0x8b, 0x31, 0xfa, 0x6b, 0x6c, 0xd3, 0xda, 0x81, 0x51, 0xf6, 0x1d, 0xf8, 0xd3, 0x8c, 0xb8, 0x84,
+  0x75, 0x50, 0x91, 0xb1, 0xd7, 0x90, 0x9b, 0xab, 0xab, 0xe8, 0x90, 0x79, 0x18, 0x15, 0x3a, 0xf6,
+  0xb7, 0xb5, 0x51, 0xc0, 0xd6, 0xec, 0x15, 0x5e, 0xc6, 0x07, 0x3d, 0xa7, 0xa6, 0x9c, 0x15, 0x4e,
+  0xa1, 0xb5, 0xde, 0x7b, 0xfb, 0x7a, 0xc8, 0x38, 0xd5, 0x95, 0x36, 0xde, 0xce, 0x30, 0x1b, 0x7d,
+  0xaf, 0x75, 0x99, 0x98, 0x75, 0x5f, 0xa6, 0x87, 0x1c, 0x31, 0xcf, 0xe9, 0x94, 0xbc, 0x67, 0x78,
+  0xdc, 0x68, 0xd6, 0x13, 0x1c, 0xae, 0xca, 0xbc, 0xfc, 0xaf, 0x24, 0x06, 0xc9, 0x08, 0xbd, 0xe0,
+  0xa7, 0xae, 0xe6, 0x36, 0xf6, 0x73, 0xd7, 0x26, 0x25, 0x46, 0x1e, 0x04, 0x19, 0xe0, 0xbc, 0xff,
+  0xfe, 0xf3, 0x77, 0xb8, 0x68, 0xed, 0x82, 0xac, 0x67, 0xa2, 0x5c, 0x74, 0x77, 0xb5, 0x23, 0xf2,
+  0xd1, 0xbe, 0x28, 0xec, 0x44, 0x0c, 0x9d, 0xfb, 0x54, 0xb8, 0xbf, 0xfe, 0x68, 0xc3, 0x71, 0x27,
+  0x75, 0x3a, 0xfd, 0x71, 0xd0, 0x76, 0xa8, 0xe0, 0x1b, 0xee, 0x51, 0xe0, 0x8b, 0x8d, 0x11, 0x8b,
+  0x6f, 0x87, 0x91, 0xc7, 0x28, 0x61, 0x2d, 0x3d, 0x9c, 0x3b, 0xb5, 0xcf, 0x23, 0x7d, 0xb6, 0xd3,
+  0xc6, 0xdd, 0x04, 0xa8, 0x8b, 0xdb, 0x99, 0x1e, 0xba, 0x9a, 0x1a, 0x84, 0xee, 0x4b, 0xdb, 0x8e,
+  0xdb, 0xbe, 0x32, 0x98, 0xb3, 0xdc, 0x0d, 0x03, 0x08, 0x8f, 0xb2, 0xd1, 0x39, 0xac, 0xfb, 0xf0,
+  0xfd, 0x56, 0x76, 0xd7, 0xff, 0x5e, 0x25, 0x05, 0xca, 0x45, 0x5b, 0x25, 0x1b, 0x62, 0x78, 0x71,
+  0x90, 0x1b, 0xe4, 0x96, 0x78, 0x58, 0x2a, 0x82, 0xbf, 0x24, 0x1b, 0x65, 0xbd, 0xa2, 0x29, 0x6d,
+  0x57, 0x09, 0xe5, 0x27, 0xf9, 0x99, 0xf4, 0x92, 0x27, 0x69, 0xe5, 0xa5, 0x76, 0x2a, 0xd3, 0xbb,
+  0x99, 0x61, 0x19, 0xa7, 0x15, 0x8a, 0x2c, 0x33, 0xd0, 0x39, 0x5d, 0x3a, 0x7c, 0x5f, 0x10, 0xdd,
+  0xbd, 0x27, 0xc6, 0x38, 0x9e, 0x01, 0x3f, 0x6c, 0x50, 0x3f, 0x76, 0xa6, 0x39, 0xfe, 0xd2, 0xd6,
+  0x36, 0x3f, 0x1f, 0xd8, 0x9c, 0xad, 0xa7, 0xf3, 0x92, 0xfb, 0x06, 0x97, 0xdb, 0x2e, 0xc0, 0xa5,
+  0x58, 0x18, 0xcf, 0xc7, 0x25, 0xe6, 0x92, 0x2e, 0xea, 0x38, 0xe9, 0xce, 0x49, 0xcd, 0xdf, 0x6b,
+  0x2c, 0x6b, 0xbf, 0xbc, 0xbf, 0x9e, 0xa0, 0x34, 0x69, 0xf1, 0x4e, 0x1a, 0x39, 0xb7, 0x31, 0xaf,
+  0xf1, 0x6e, 0x2f, 0x29, 0x1d, 0x1f, 0x3e, 0xe9, 0x14, 0x09, 0xc1, 0x86, 0x70, 0x8e, 0xae, 0x10,
+  0x3a, 0xff, 0xee, 0xbb, 0xf0, 0x03, 0x52, 0xf8, 0xa3, 0x25, 0x4c, 0x1f, 0xf1, 0x83, 0xcf, 0xfd,
+  0x5d, 0x0f, 0x3f, 0x2f, 0x37, 0xf0, 0x5d, 0xbf, 0x88, 0x69, 0xe0, 0x6a, 0x3d, 0x69, 0x2b, 0x34,
+  0x4c, 0x08, 0x81, 0x01, 0xdf, 0x12, 0x7d, 0xaa, 0x96, 0x39, 0xba, 0x42, 0x67, 0x24, 0x5e, 0xef,
+  0x6e, 0x26, 0xb7, 0x64, 0xce, 0x10, 0x67, 0x61, 0x6f, 0xeb, 0xed, 0xc0, 0x43, 0xff, 0xff, 0x01,
+  0x06, 0xd1, 0xfe, 0x82, 0xee, 0x0e, 0x00, 0x00,
+};
+const size_t APP_JS_GZ_LEN = sizeof(APP_JS_GZ);
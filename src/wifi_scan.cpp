@@ -0,0 +1,136 @@
+#include "wifi_scan.h"
+#include <WiFi.h>
+
+// Published results, read by the HTTP task under cacheLock
+static portMUX_TYPE cacheLock = portMUX_INITIALIZER_UNLOCKED;
+static ScanResult cache[SCAN_CACHE_SIZE];
+static size_t cacheCount = 0;
+static bool haveResults = false;
+static unsigned long resultsTime = 0;
+static uint32_t generation = 0;
+
+// Working set filled while collecting a scan
+static ScanResult results[SCAN_CACHE_SIZE];
+static size_t resultCount = 0;
+
+static bool scanning = false;
+static unsigned long scanStartTime = 0;
+
+bool requestWifiScan() {
+  if (scanning) return true;
+  if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+    Serial.println("WiFi scan could not be started.");
+    return false;
+  }
+  scanning = true;
+  scanStartTime = millis();
+  return true;
+}
+
+// Keep the strongest entry per SSID. When the cache is full a new network
+// only gets in by displacing a weaker one.
+static void addResult(const String& ssid, const uint8_t* bssid, int32_t rssi, int32_t channel, bool open) {
+  if (ssid.length() == 0) return; // hidden network
+
+  size_t slot = resultCount;
+  for (size_t i = 0; i < resultCount; i++) {
+    if (strcmp(results[i].ssid, ssid.c_str()) == 0) {
+      if (rssi <= results[i].rssi) return;
+      slot = i;
+      break;
+    }
+  }
+  if (slot == SCAN_CACHE_SIZE) {
+    size_t weakest = 0;
+    for (size_t i = 1; i < resultCount; i++) {
+      if (results[i].rssi < results[weakest].rssi) weakest = i;
+    }
+    if (rssi <= results[weakest].rssi) return;
+    slot = weakest;
+  }
+  if (slot == resultCount) resultCount++;
+
+  ScanResult& r = results[slot];
+  strlcpy(r.ssid, ssid.c_str(), sizeof(r.ssid));
+  memcpy(r.bssid, bssid, sizeof(r.bssid));
+  r.rssi = (int8_t)rssi;
+  r.channel = (uint8_t)channel;
+  r.open = open;
+}
+
+static void sortResults() {
+  for (size_t i = 1; i < resultCount; i++) {
+    ScanResult r = results[i];
+    size_t j = i;
+    while (j > 0 && results[j - 1].rssi < r.rssi) {
+      results[j] = results[j - 1];
+      j--;
+    }
+    results[j] = r;
+  }
+}
+
+void pollWifiScan() {
+  if (!scanning) return;
+
+  int16_t n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) {
+    if (millis() - scanStartTime > SCAN_MAX_DURATION) {
+      Serial.println("WiFi scan timed out.");
+      WiFi.scanDelete();
+      scanning = false;
+      generation++;
+    }
+    return;
+  }
+
+  scanning = false;
+  if (n < 0) {
+    Serial.println("WiFi scan failed.");
+    generation++;
+    return;
+  }
+
+  resultCount = 0;
+  for (int16_t i = 0; i < n; i++) {
+    addResult(WiFi.SSID(i), WiFi.BSSID(i), WiFi.RSSI(i), WiFi.channel(i), WiFi.encryptionType(i) == WIFI_AUTH_OPEN);
+  }
+  WiFi.scanDelete();
+  sortResults();
+
+  portENTER_CRITICAL(&cacheLock);
+  memcpy(cache, results, resultCount * sizeof(ScanResult));
+  cacheCount = resultCount;
+  haveResults = true;
+  resultsTime = millis();
+  generation++;
+  portEXIT_CRITICAL(&cacheLock);
+  Serial.printf("WiFi scan done: %d networks, %u cached.\n", n, (unsigned)resultCount);
+}
+
+bool isWifiScanning() {
+  return scanning;
+}
+
+bool isScanCacheFresh() {
+  return haveResults && scanCacheAge() <= SCAN_CACHE_TTL;
+}
+
+unsigned long scanCacheAge() {
+  return millis() - resultsTime;
+}
+
+uint32_t scanGeneration() {
+  return generation;
+}
+
+size_t scanResultCount() {
+  return cacheCount;
+}
+
+ScanResult scanResult(size_t index) {
+  portENTER_CRITICAL(&cacheLock);
+  ScanResult result = cache[index];
+  portEXIT_CRITICAL(&cacheLock);
+  return result;
+}
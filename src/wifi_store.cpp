@@ -0,0 +1,329 @@
+#include "wifi_store.h"
+#include "wifi_scan.h"
+#include <Preferences.h>
+
+static const char* WIFI_NAMESPACE = "wifi";
+static const char* NETWORKS_BLOB_KEY = "networks";
+static const char* LINK_BLOB_KEY = "link";
+static const char* LOG_BLOB_KEY = "connlog";
+static const uint8_t NETWORKS_BLOB_VERSION = 1;
+static const uint8_t LINK_BLOB_VERSION = 1;
+static const uint8_t LOG_BLOB_VERSION = 1;
+
+struct NetworksBlob {
+  uint8_t version;
+  uint8_t count;
+  KnownNetwork networks[MAX_KNOWN_NETWORKS];
+};
+
+struct LinkBlob {
+  uint8_t version;
+  char ssid[33];
+  WifiLink link;
+};
+
+struct LogBlob {
+  uint8_t version;
+  uint8_t head;  // next slot to write
+  uint8_t count;
+  uint16_t boot; // the current boot number
+  ConnectRecord records[CONNECT_LOG_SIZE];
+};
+
+static Preferences store;
+static NetworksBlob known;
+static LogBlob connectLog;
+static uint16_t bootNumber = 0;
+static uint32_t writes = 0;
+// Connect history not yet in flash, and when it last changed
+static bool historyDirty = false;
+static unsigned long historyChangedAt = 0;
+// Both are written by the control loop and read by the web server task
+static portMUX_TYPE storeLock = portMUX_INITIALIZER_UNLOCKED;
+
+static void saveNetworks() {
+  portENTER_CRITICAL(&storeLock);
+  NetworksBlob blob = known;
+  portEXIT_CRITICAL(&storeLock);
+
+  // The blob carries any pending history along with it
+  historyDirty = false;
+  store.begin(WIFI_NAMESPACE, false);
+  if (store.putBytes(NETWORKS_BLOB_KEY, &blob, sizeof(blob)) != sizeof(blob)) {
+    Serial.println("Failed to save known networks.");
+  } else {
+    writes++;
+  }
+  store.end();
+}
+
+// Older firmware kept one network under the "ssid" and "password" keys
+static bool migrateLegacyNetwork() {
+  KnownNetwork network;
+  memset(&network, 0, sizeof(network));
+  store.begin(WIFI_NAMESPACE, false);
+  bool found = store.isKey("ssid");
+  if (found) {
+    store.getString("ssid", network.ssid, sizeof(network.ssid));
+    store.getString("password", network.password, sizeof(network.password));
+    store.remove("ssid");
+    store.remove("password");
+  }
+  store.end();
+  if (!found || network.ssid[0] == '\0') return false;
+  known.networks[0] = network;
+  known.count = 1;
+  return true;
+}
+
+static void loadNetworks() {
+  store.begin(WIFI_NAMESPACE, true);
+  bool found = store.getBytesLength(NETWORKS_BLOB_KEY) == sizeof(known) &&
+               store.getBytes(NETWORKS_BLOB_KEY, &known, sizeof(known)) == sizeof(known) &&
+               known.version == NETWORKS_BLOB_VERSION && known.count <= MAX_KNOWN_NETWORKS;
+  store.end();
+  if (found) return;
+  memset(&known, 0, sizeof(known));
+  known.version = NETWORKS_BLOB_VERSION;
+  if (migrateLegacyNetwork()) saveNetworks();
+}
+
+uint8_t knownNetworkCount() {
+  return known.count;
+}
+
+KnownNetwork knownNetwork(uint8_t index) {
+  portENTER_CRITICAL(&storeLock);
+  KnownNetwork network = known.networks[index];
+  portEXIT_CRITICAL(&storeLock);
+  return network;
+}
+
+int findKnownNetwork(const char* ssid) {
+  for (uint8_t i = 0; i < known.count; i++) {
+    if (strncmp(known.networks[i].ssid, ssid, sizeof(known.networks[i].ssid)) == 0) return i;
+  }
+  return -1;
+}
+
+int preferredKnownNetwork() {
+  if (known.count == 0) return -1;
+  int best = 0;
+  for (uint8_t i = 1; i < known.count; i++) {
+    if (known.networks[i].lastBoot > known.networks[best].lastBoot) best = i;
+  }
+  return best;
+}
+
+void rememberNetwork(const char* ssid, const char* password) {
+  int index = findKnownNetwork(ssid);
+  portENTER_CRITICAL(&storeLock);
+  if (index < 0) {
+    if (known.count < MAX_KNOWN_NETWORKS) {
+      index = known.count++;
+    } else {
+      // Replace the one that has gone longest without connecting
+      index = 0;
+      for (uint8_t i = 1; i < known.count; i++) {
+        const KnownNetwork& a = known.networks[i];
+        const KnownNetwork& b = known.networks[index];
+        if (a.lastBoot < b.lastBoot || (a.lastBoot == b.lastBoot && a.failures > b.failures)) index = i;
+      }
+    }
+    memset(&known.networks[index], 0, sizeof(KnownNetwork));
+    strlcpy(known.networks[index].ssid, ssid, sizeof(known.networks[index].ssid));
+  }
+  strlcpy(known.networks[index].password, password, sizeof(known.networks[index].password));
+  portEXIT_CRITICAL(&storeLock);
+  saveNetworks();
+}
+
+bool forgetNetwork(const char* ssid) {
+  int index = findKnownNetwork(ssid);
+  if (index < 0) return false;
+  portENTER_CRITICAL(&storeLock);
+  known.count--;
+  memmove(&known.networks[index], &known.networks[index + 1], (known.count - index) * sizeof(KnownNetwork));
+  portEXIT_CRITICAL(&storeLock);
+  saveNetworks();
+  // Its access point and lease are no use to the next connect
+  WifiLink link;
+  if (loadWifiLink(ssid, link)) clearWifiLink();
+  return true;
+}
+
+void forgetAllNetworks() {
+  portENTER_CRITICAL(&storeLock);
+  known.count = 0;
+  portEXIT_CRITICAL(&storeLock);
+  historyDirty = false;
+  store.begin(WIFI_NAMESPACE, false);
+  store.remove(NETWORKS_BLOB_KEY);
+  store.remove(LINK_BLOB_KEY);
+  store.end();
+}
+
+void noteConnectResult(const char* ssid, bool ok, unsigned long elapsed) {
+  int index = findKnownNetwork(ssid);
+  if (index < 0) return;
+  portENTER_CRITICAL(&storeLock);
+  KnownNetwork& network = known.networks[index];
+  if (ok) {
+    if (elapsed > 0xFFFF) elapsed = 0xFFFF;
+    // Moving average over roughly the last four connects
+    network.avgConnectMillis = network.successes == 0 ? elapsed : (network.avgConnectMillis * 3 + elapsed) / 4;
+    if (network.successes < 0xFFFF) network.successes++;
+    network.lastBoot = bootNumber;
+  } else if (network.failures < 0xFFFF) {
+    network.failures++;
+  }
+  portEXIT_CRITICAL(&storeLock);
+  historyDirty = true;
+  historyChangedAt = millis();
+}
+
+void pollWifiStore() {
+  if (historyDirty && millis() - historyChangedAt >= WIFI_SAVE_QUIET_PERIOD) saveNetworks();
+}
+
+void flushWifiStore() {
+  if (historyDirty) saveNetworks();
+}
+
+// Up to about 10 dB in favour of a network that has connected reliably,
+// plus a little for the one used last.
+static int historyScore(const KnownNetwork& network, uint16_t lastBoot) {
+  int score = network.successes * 10 / (network.successes + network.failures + 1);
+  if (network.lastBoot != 0 && network.lastBoot == lastBoot) score += 3;
+  return score;
+}
+
+uint8_t rankKnownNetworks(WifiCandidate* candidates, uint8_t maxCandidates) {
+  if (maxCandidates > MAX_KNOWN_NETWORKS) maxCandidates = MAX_KNOWN_NETWORKS;
+  int preferred = preferredKnownNetwork();
+  uint16_t lastBoot = preferred >= 0 ? known.networks[preferred].lastBoot : 0;
+  int scores[MAX_KNOWN_NETWORKS];
+  uint8_t count = 0;
+
+  for (size_t i = 0; i < scanResultCount(); i++) {
+    ScanResult result = scanResult(i);
+    int index = findKnownNetwork(result.ssid);
+    if (index < 0) continue;
+    int score = result.rssi + historyScore(known.networks[index], lastBoot);
+
+    // Insertion sort, best first
+    uint8_t slot = count;
+    while (slot > 0 && scores[slot - 1] < score) slot--;
+    if (slot >= maxCandidates) continue;
+    uint8_t last = count < maxCandidates ? count : maxCandidates - 1;
+    for (uint8_t j = last; j > slot; j--) {
+      candidates[j] = candidates[j - 1];
+      scores[j] = scores[j - 1];
+    }
+    WifiCandidate& candidate = candidates[slot];
+    candidate.network = index;
+    candidate.rssi = result.rssi;
+    candidate.channel = result.channel;
+    memcpy(candidate.bssid, result.bssid, sizeof(candidate.bssid));
+    scores[slot] = score;
+    if (count < maxCandidates) count++;
+  }
+  return count;
+}
+
+bool loadWifiLink(const char* ssid, WifiLink& link) {
+  LinkBlob blob;
+  store.begin(WIFI_NAMESPACE, true);
+  bool found = store.getBytesLength(LINK_BLOB_KEY) == sizeof(blob) &&
+               store.getBytes(LINK_BLOB_KEY, &blob, sizeof(blob)) == sizeof(blob) &&
+               blob.version == LINK_BLOB_VERSION &&
+               strncmp(blob.ssid, ssid, sizeof(blob.ssid)) == 0;
+  store.end();
+  if (found) link = blob.link;
+  return found;
+}
+
+void saveWifiLink(const char* ssid, const WifiLink& link) {
+  LinkBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = LINK_BLOB_VERSION;
+  strlcpy(blob.ssid, ssid, sizeof(blob.ssid));
+  blob.link = link;
+
+  LinkBlob stored;
+  store.begin(WIFI_NAMESPACE, false);
+  bool same = store.getBytes(LINK_BLOB_KEY, &stored, sizeof(stored)) == sizeof(stored) &&
+              memcmp(&stored, &blob, sizeof(blob)) == 0;
+  if (!same) {
+    if (store.putBytes(LINK_BLOB_KEY, &blob, sizeof(blob)) != sizeof(blob)) {
+      Serial.println("Failed to save WiFi link.");
+    } else {
+      writes++;
+    }
+  }
+  store.end();
+}
+
+void clearWifiLink() {
+  store.begin(WIFI_NAMESPACE, false);
+  store.remove(LINK_BLOB_KEY);
+  store.end();
+}
+
+static void saveConnectLog(const LogBlob& blob) {
+  store.begin(WIFI_NAMESPACE, false);
+  if (store.putBytes(LOG_BLOB_KEY, &blob, sizeof(blob)) != sizeof(blob)) {
+    Serial.println("Failed to save connect log.");
+  } else {
+    writes++;
+  }
+  store.end();
+}
+
+void beginWifiStore() {
+  loadNetworks();
+  store.begin(WIFI_NAMESPACE, true);
+  bool found = store.getBytesLength(LOG_BLOB_KEY) == sizeof(connectLog) &&
+               store.getBytes(LOG_BLOB_KEY, &connectLog, sizeof(connectLog)) == sizeof(connectLog) &&
+               connectLog.version == LOG_BLOB_VERSION;
+  store.end();
+  if (!found) {
+    memset(&connectLog, 0, sizeof(connectLog));
+    connectLog.version = LOG_BLOB_VERSION;
+  }
+  // Saved straight away, so boots that never connect still get a number of
+  // their own. 0 means "never" in lastBoot and is skipped on wrap-around.
+  bootNumber = connectLog.boot + 1;
+  if (bootNumber == 0) bootNumber = 1;
+  connectLog.boot = bootNumber;
+  saveConnectLog(connectLog);
+}
+
+void recordConnect(unsigned long elapsed, bool fast, bool ok) {
+  portENTER_CRITICAL(&storeLock);
+  ConnectRecord& record = connectLog.records[connectLog.head];
+  record.boot = bootNumber;
+  record.millis = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+  record.fast = fast ? 1 : 0;
+  record.ok = ok ? 1 : 0;
+  connectLog.head = (connectLog.head + 1) % CONNECT_LOG_SIZE;
+  if (connectLog.count < CONNECT_LOG_SIZE) connectLog.count++;
+  LogBlob blob = connectLog;
+  portEXIT_CRITICAL(&storeLock);
+  saveConnectLog(blob);
+}
+
+uint8_t connectLogCount() {
+  return connectLog.count;
+}
+
+ConnectRecord connectLogEntry(uint8_t index) {
+  portENTER_CRITICAL(&storeLock);
+  ConnectRecord record = connectLog.records[(connectLog.head + CONNECT_LOG_SIZE - 1 - index) % CONNECT_LOG_SIZE];
+  portEXIT_CRITICAL(&storeLock);
+  return record;
+}
+
+uint32_t wifiStoreWrites() {
+  return writes;
+}
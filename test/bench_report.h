@@ -0,0 +1,84 @@
+#pragma once
+// Result file for the benchmark suites (test_bench_*). Each suite writes
+// bench_<suite>.json into $BENCH_OUTPUT_DIR, or the working directory:
+//
+//   {"suite": "routes", "results": [{"route": "GET /", "render_us": 41.2, ...}, ...]}
+//
+// Timings are host wall time, so compare runs on the same machine only;
+// byte, allocation and write counts are exact.
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+inline uint64_t wallNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+class BenchRow {
+public:
+  BenchRow& add(const char* name, const char* value) {
+    key(name);
+    _json += '"';
+    for (const char* p = value; *p; p++) {
+      if (*p == '"' || *p == '\\') _json += '\\';
+      _json += *p;
+    }
+    _json += '"';
+    return *this;
+  }
+  BenchRow& add(const char* name, uint64_t value) {
+    key(name);
+    _json += std::to_string(value);
+    return *this;
+  }
+  BenchRow& add(const char* name, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f", value);
+    key(name);
+    _json += text;
+    return *this;
+  }
+  BenchRow& add(const char* name, uint32_t value) { return add(name, (uint64_t)value); }
+  BenchRow& add(const char* name, int value) { return add(name, (uint64_t)value); }
+  std::string json() const { return "{" + _json + "}"; }
+
+private:
+  void key(const char* name) {
+    if (!_json.empty()) _json += ", ";
+    _json += '"';
+    _json += name;
+    _json += "\": ";
+  }
+
+  std::string _json;
+};
+
+class BenchReport {
+public:
+  explicit BenchReport(const char* suite) : _suite(suite) {}
+
+  void add(const BenchRow& row) { _rows.push_back(row.json()); }
+
+  // Returns false if the file could not be written
+  bool write() const {
+    const char* dir = getenv("BENCH_OUTPUT_DIR");
+    std::string path = std::string(dir ? dir : ".") + "/bench_" + _suite + ".json";
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) return false;
+    fprintf(file, "{\"suite\": \"%s\", \"results\": [\n", _suite);
+    for (size_t i = 0; i < _rows.size(); i++) {
+      fprintf(file, "  %s%s\n", _rows[i].c_str(), i + 1 < _rows.size() ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    bool ok = fclose(file) == 0;
+    printf("%s: %u results\n", path.c_str(), (unsigned)_rows.size());
+    return ok;
+  }
+
+private:
+  const char* _suite;
+  std::vector<std::string> _rows;
+};
@@ -0,0 +1,133 @@
+#pragma once
+// Host stand-in for the parts of the ESP32 Arduino core the firmware uses,
+// for the native test environment. Time comes from a mock clock that tests
+// move forward (native_stubs.h); FreeRTOS tasks are threads.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <freertos/FreeRTOS.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define F(text) (text)
+#define IRAM_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 1
+#define INPUT_PULLUP 5
+#define OUTPUT 3
+#define CHANGE 3
+#define digitalPinToInterrupt(pin) (pin)
+
+#define BIT0 0x01
+#define BIT1 0x02
+#define BIT2 0x04
+#define BIT3 0x08
+#define BIT4 0x10
+#define BIT5 0x20
+#define BIT6 0x40
+#define BIT7 0x80
+
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+template <class T, class L, class H>
+T constrain(T value, L low, H high) {
+  return value < (T)low ? (T)low : value > (T)high ? (T)high : value;
+}
+
+class String {
+public:
+  String() {}
+  String(const char* text) : _text(text ? text : "") {}
+  String(const std::string& text) : _text(text) {}
+  explicit String(char c) : _text(1, c) {}
+  explicit String(int value) : _text(std::to_string(value)) {}
+  explicit String(unsigned int value) : _text(std::to_string(value)) {}
+  explicit String(long value) : _text(std::to_string(value)) {}
+  explicit String(unsigned long value) : _text(std::to_string(value)) {}
+
+  const char* c_str() const { return _text.c_str(); }
+  unsigned int length() const { return _text.size(); }
+  bool isEmpty() const { return _text.empty(); }
+  bool reserve(unsigned int size) { _text.reserve(size); return true; }
+  long toInt() const { return strtol(_text.c_str(), nullptr, 10); }
+  char operator[](unsigned int index) const { return index < _text.size() ? _text[index] : '\0'; }
+  bool startsWith(const char* prefix) const { return _text.compare(0, strlen(prefix), prefix) == 0; }
+  bool concat(const char* text, unsigned int length) { _text.append(text, length); return true; }
+
+  String& operator+=(const String& other) { _text += other._text; return *this; }
+  String& operator+=(const char* text) { _text += text; return *this; }
+  String& operator+=(char c) { _text += c; return *this; }
+  friend String operator+(String a, const String& b) { return a += b; }
+  friend String operator+(String a, const char* b) { return a += b; }
+  friend String operator+(const char* a, const String& b) { return String(a) += b; }
+  bool operator==(const String& other) const { return _text == other._text; }
+  bool operator==(const char* text) const { return _text == text; }
+  bool operator!=(const String& other) const { return _text != other._text; }
+  bool operator!=(const char* text) const { return _text != text; }
+
+private:
+  std::string _text;
+};
+
+// Output is discarded unless NATIVE_SERIAL_OUTPUT is set in the environment
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) {}
+  size_t print(const char* text);
+  size_t print(const String& text) { return print(text.c_str()); }
+  size_t print(long value);
+  size_t println(const char* text = "");
+  size_t println(const String& text) { return println(text.c_str()); }
+  size_t println(long value);
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  void restart();
+};
+extern EspClass ESP;
+
+// The sketch, from src/main.cpp
+void setup();
+void loop();
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+uint32_t esp_random();
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char* dest, const char* src, size_t size) {
+  size_t length = strlen(src);
+  if (size > 0) {
+    size_t copy = length < size - 1 ? length : size - 1;
+    memcpy(dest, src, copy);
+    dest[copy] = '\0';
+  }
+  return length;
+}
+#endif
+
+void configTime(long gmtOffset, int daylightOffset, const char* server1, const char* server2 = nullptr,
+                const char* server3 = nullptr);
@@ -0,0 +1,123 @@
+#pragma once
+#include <Arduino.h>
+
+// The parts of FastLED the firmware uses, with the same 8-bit math, and an
+// output that only records what it was asked to show. native_stubs.h sets
+// how long a show() takes.
+
+#define WS2812B 0
+#define GRB 0
+
+inline uint8_t scale8(uint8_t i, uint8_t scale) {
+  return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+inline uint8_t scale8_video(uint8_t i, uint8_t scale) {
+  return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+  unsigned int t = i + j;
+  return t > 255 ? 255 : t;
+}
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, uint8_t frac) {
+  return b > a ? a + scale8(b - a, frac) : a - scale8(a - b, frac);
+}
+inline uint8_t triwave8(uint8_t in) {
+  if (in & 0x80) in = 255 - in;
+  return in << 1;
+}
+inline uint8_t ease8InOutCubic(uint8_t i) {
+  uint8_t ii = scale8(i, i);
+  uint8_t iii = scale8(ii, i);
+  uint16_t r1 = (3 * (uint16_t)ii) - (2 * (uint16_t)iii);
+  return r1 & 0x100 ? 255 : r1;
+}
+inline uint8_t cubicwave8(uint8_t in) {
+  return ease8InOutCubic(triwave8(in));
+}
+
+struct CHSV {
+  uint8_t h, s, v;
+  CHSV() : h(0), s(0), v(0) {}
+  CHSV(uint8_t hue, uint8_t sat, uint8_t val) : h(hue), s(sat), v(val) {}
+};
+
+struct CRGB {
+  union {
+    struct {
+      uint8_t r, g, b;
+    };
+    uint8_t raw[3];
+  };
+
+  enum HTMLColorCode : uint32_t {
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    Cyan = 0x00FFFF,
+    Green = 0x008000,
+    Orange = 0xFFA500,
+    Purple = 0x800080,
+    Red = 0xFF0000,
+    White = 0xFFFFFF,
+    Yellow = 0xFFFF00,
+  };
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+  CRGB(uint32_t code) : r(code >> 16), g(code >> 8), b(code) {}
+  CRGB(HTMLColorCode code) : CRGB((uint32_t)code) {}
+  CRGB(const CHSV& hsv);
+
+  uint8_t& operator[](uint8_t index) { return raw[index]; }
+  bool operator==(const CRGB& other) const { return r == other.r && g == other.g && b == other.b; }
+  bool operator!=(const CRGB& other) const { return !(*this == other); }
+  CRGB& nscale8_video(uint8_t scale) {
+    r = scale8_video(r, scale);
+    g = scale8_video(g, scale);
+    b = scale8_video(b, scale);
+    return *this;
+  }
+};
+
+void hsv2rgb_spectrum(const CHSV& hsv, CRGB& rgb);
+inline CRGB::CRGB(const CHSV& hsv) {
+  hsv2rgb_spectrum(hsv, *this);
+}
+
+inline CRGB blend(const CRGB& a, const CRGB& b, uint8_t amount) {
+  return CRGB(lerp8by8(a.r, b.r, amount), lerp8by8(a.g, b.g, amount), lerp8by8(a.b, b.b, amount));
+}
+inline void fill_solid(CRGB* leds, int count, const CRGB& color) {
+  for (int i = 0; i < count; i++) leds[i] = color;
+}
+void fill_rainbow(CRGB* leds, int count, uint8_t initialHue, uint8_t deltaHue = 5);
+
+class CLEDController {
+public:
+  CLEDController& setLeds(CRGB* leds, int count) {
+    _leds = leds;
+    _count = count;
+    return *this;
+  }
+  CRGB* leds() { return _leds; }
+  int size() { return _count; }
+
+private:
+  CRGB* _leds = nullptr;
+  int _count = 0;
+};
+
+class CFastLED {
+public:
+  template <int TYPE, int PIN, int ORDER>
+  CLEDController& addLeds(CRGB* leds, int count) {
+    return _controller.setLeds(leds, count);
+  }
+  void show(uint8_t brightness);
+  void show() { show(_brightness); }
+  void setBrightness(uint8_t brightness) { _brightness = brightness; }
+
+private:
+  CLEDController _controller;
+  uint8_t _brightness = 255;
+};
+extern CFastLED FastLED;
@@ -0,0 +1,26 @@
+#pragma once
+#include <Arduino.h>
+
+// Stored in network order, like the core's IPAddress, so the uint32_t
+// conversion can go straight into a sockaddr_in.
+class IPAddress {
+public:
+  IPAddress() : _address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    uint8_t bytes[4] = {a, b, c, d};
+    memcpy(&_address, bytes, 4);
+  }
+  IPAddress(uint32_t address) : _address(address) {}
+
+  operator uint32_t() const { return _address; }
+  bool operator==(const IPAddress& other) const { return _address == other._address; }
+  uint8_t operator[](int index) const { return ((const uint8_t*)&_address)[index]; }
+  String toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(text);
+  }
+
+private:
+  uint32_t _address;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+
+// NVS in memory. All instances share one store, which lives until the
+// process exits or nvsReset() (native_stubs.h) clears it; every put and
+// remove counts as a flash write.
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putBytes(const char* key, const void* value, size_t length);
+  size_t putString(const char* key, const char* value) { return putBytes(key, value, strlen(value) + 1); }
+  size_t putBool(const char* key, bool value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putULong(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buffer, size_t length);
+  size_t getString(const char* key, char* value, size_t length);
+  bool getBool(const char* key, bool defaultValue = false) { return get(key, defaultValue); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return get(key, defaultValue); }
+  uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+
+private:
+  template <class T>
+  T get(const char* key, T defaultValue) {
+    T value;
+    return getBytesLength(key) == sizeof(T) && getBytes(key, &value, sizeof(T)) == sizeof(T) ? value : defaultValue;
+  }
+
+  char _name[16] = "";
+  bool _open = false;
+  bool _readOnly = false;
+};
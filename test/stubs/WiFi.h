@@ -0,0 +1,81 @@
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+#include <vector>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+typedef enum { WIFI_AUTH_OPEN = 0, WIFI_AUTH_WPA2_PSK = 3 } wifi_auth_mode_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_SCAN_DONE,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_AP_START,
+  ARDUINO_EVENT_WIFI_AP_STOP,
+} arduino_event_id_t;
+typedef arduino_event_id_t WiFiEvent_t;
+typedef struct {
+  uint8_t reason;
+} WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+
+// A radio that is never connected and finds no networks. Tests change
+// `stationStatus` and `stationIp` to put it on a network, and fill
+// `scanSsids` for scans to find (open, -50 dBm, channel 1).
+class WiFiClass {
+public:
+  wl_status_t stationStatus = WL_DISCONNECTED;
+  IPAddress stationIp;
+  std::vector<const char*> scanSsids;
+
+  wl_status_t status() { return stationStatus; }
+  bool mode(wifi_mode_t mode) { return true; }
+  int onEvent(WiFiEventFuncCb callback) { return 0; }
+  wl_status_t begin(const char* ssid, const char* password = nullptr, int32_t channel = 0,
+                    const uint8_t* bssid = nullptr, bool connect = true) { return stationStatus; }
+  bool config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+              IPAddress dns2 = IPAddress()) { return true; }
+  bool disconnect(bool wifiOff = false, bool eraseAp = false) { return true; }
+  bool softAP(const char* ssid, const char* password) { return true; }
+  bool softAPConfig(IPAddress ip, IPAddress gateway, IPAddress subnet) { _apIp = ip; return true; }
+  IPAddress softAPIP() { return _apIp; }
+
+  IPAddress localIP() { return stationIp; }
+  IPAddress gatewayIP() { return IPAddress(); }
+  IPAddress subnetMask() { return IPAddress(); }
+  IPAddress dnsIP(uint8_t index = 0) { return IPAddress(); }
+  String SSID() { return String(); }
+  int32_t RSSI() { return 0; }
+  uint8_t* BSSID() { return _bssid; }
+  int32_t channel() { return 0; }
+
+  int16_t scanNetworks(bool async = false) { return 0; }
+  int16_t scanComplete() { return scanSsids.size(); }
+  void scanDelete() {}
+  String SSID(uint8_t index) { return String(scanSsids[index]); }
+  int32_t RSSI(uint8_t index) { return -50; }
+  uint8_t* BSSID(uint8_t index) { return _bssid; }
+  int32_t channel(uint8_t index) { return 1; }
+  wifi_auth_mode_t encryptionType(uint8_t index) { return WIFI_AUTH_OPEN; }
+
+private:
+  IPAddress _apIp;
+  uint8_t _bssid[6] = {0, 0, 0, 0, 0, 0};
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,17 @@
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Never connected; the event stream has no subscribers on the host.
+class WiFiClient {
+public:
+  operator bool() const { return false; }
+  uint8_t connected() { return 0; }
+  int available() { return 0; }
+  int read() { return -1; }
+  int read(uint8_t* buffer, size_t length) { return -1; }
+  size_t readBytes(uint8_t* buffer, size_t length) { return 0; }
+  size_t write(const uint8_t* data, size_t length) { return 0; }
+  void stop() {}
+  int fd() const { return -1; }
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include <WiFiClient.h>
+
+class WiFiServer {
+public:
+  explicit WiFiServer(uint16_t port) {}
+  void begin() {}
+  void setNoDelay(bool noDelay) {}
+  WiFiClient available() { return WiFiClient(); }
+};
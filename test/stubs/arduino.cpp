@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <new>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#include <random>
+#include <stdarg.h>
+#include "native_stubs.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+static std::atomic<uint64_t> clockMicros{0};
+
+void setMicros(uint64_t us) {
+  clockMicros = us;
+}
+
+void advanceMicros(uint64_t us) {
+  clockMicros += us;
+}
+
+unsigned long millis() {
+  return (unsigned long)(clockMicros / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)clockMicros;
+}
+
+void delay(uint32_t ms) {
+  vTaskDelay(ms);
+}
+
+void yield() {}
+void pinMode(uint8_t pin, uint8_t mode) {}
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {}
+void configTime(long gmtOffset, int daylightOffset, const char* server1, const char* server2, const char* server3) {}
+
+// Pins read as pulled up, so the boot button is never pressed
+int digitalRead(uint8_t pin) {
+  return HIGH;
+}
+
+uint32_t esp_random() {
+  static std::mt19937 generator(std::random_device{}());
+  return generator();
+}
+
+static bool serialOutput() {
+  static const bool enabled = getenv("NATIVE_SERIAL_OUTPUT") != nullptr;
+  return enabled;
+}
+
+size_t HardwareSerial::print(const char* text) {
+  if (serialOutput()) fputs(text, stdout);
+  return strlen(text);
+}
+
+size_t HardwareSerial::print(long value) {
+  return printf("%ld", value);
+}
+
+size_t HardwareSerial::println(const char* text) {
+  return print(text) + print("\n");
+}
+
+size_t HardwareSerial::println(long value) {
+  return print(value) + print("\n");
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int length = serialOutput() ? vprintf(format, args) : vsnprintf(nullptr, 0, format, args);
+  va_end(args);
+  return length < 0 ? 0 : length;
+}
+
+// The S3's internal heap, less what the host has handed out through new
+static const uint32_t HEAP_SIZE = 320 * 1024;
+static std::atomic<uint64_t> heapBytes{0};
+static std::atomic<uint32_t> heapAllocations{0};
+static std::atomic<uint64_t> heapLive{0};
+static std::atomic<uint64_t> heapPeak{0};
+
+HeapUsage heapUsage() {
+  return HeapUsage{heapBytes, heapAllocations, heapLive, heapPeak};
+}
+
+void resetHeapPeak() {
+  heapPeak = heapLive.load();
+}
+
+// Live bytes are counted in malloc's block sizes, so delete can take off
+// what new added without a header in front of every block
+static size_t blockSize(void* block) {
+#ifdef __APPLE__
+  return malloc_size(block);
+#else
+  return malloc_usable_size(block);
+#endif
+}
+
+static void release(void* block) {
+  if (block != nullptr) heapLive -= blockSize(block);
+  free(block);
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return HEAP_SIZE;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  return HEAP_SIZE;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+  return HEAP_SIZE / 2;
+}
+
+void EspClass::restart() {
+  Serial.println("ESP.restart() ignored on the host");
+}
+
+void* operator new(size_t size) {
+  heapBytes += size;
+  heapAllocations++;
+  void* block = malloc(size ? size : 1);
+  if (block == nullptr) throw std::bad_alloc();
+  uint64_t live = heapLive += blockSize(block);
+  uint64_t peak = heapPeak;
+  while (live > peak && !heapPeak.compare_exchange_weak(peak, live)) {
+  }
+  return block;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+  release(block);
+}
+
+void operator delete[](void* block) noexcept {
+  release(block);
+}
+
+void operator delete(void* block, size_t size) noexcept {
+  release(block);
+}
+
+void operator delete[](void* block, size_t size) noexcept {
+  release(block);
+}
@@ -0,0 +1,200 @@
+#include <esp_http_server.h>
+#include <strings.h>
+#include <vector>
+#include "native_stubs.h"
+
+struct StubServer {
+  httpd_config_t config;
+  std::vector<httpd_uri_t> handlers;
+};
+
+// One request in flight at a time, as on esp_http_server's single task
+struct StubRequest {
+  std::string query;
+  std::vector<std::string> headers;
+  std::string body;
+  size_t bodyRead = 0;
+  uint16_t headerCount = 0;
+  HttpResponse response;
+  bool sent = false;
+};
+
+static StubServer* server = nullptr;
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config) {
+  server = new StubServer();
+  server->config = *config;
+  *handle = server;
+  return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri) {
+  StubServer* target = (StubServer*)handle;
+  if (target->handlers.size() >= target->config.max_uri_handlers) return ESP_FAIL;
+  target->handlers.push_back(*uri);
+  return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char* reference, const char* uri, size_t length) {
+  size_t referenceLength = strlen(reference);
+  if (referenceLength > 0 && reference[referenceLength - 1] == '*') {
+    return strncmp(reference, uri, min(referenceLength - 1, length)) == 0 && length >= referenceLength - 1;
+  }
+  return referenceLength == length && strncmp(reference, uri, length) == 0;
+}
+
+static StubRequest& state(httpd_req_t* req) {
+  return *(StubRequest*)req->aux;
+}
+
+int httpd_req_recv(httpd_req_t* req, char* buffer, size_t length) {
+  StubRequest& request = state(req);
+  size_t left = request.body.size() - request.bodyRead;
+  if (left == 0) return 0;
+  size_t count = min(length, left);
+  memcpy(buffer, request.body.data() + request.bodyRead, count);
+  request.bodyRead += count;
+  return count;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buffer, size_t length) {
+  StubRequest& request = state(req);
+  if (request.query.empty()) return ESP_ERR_NOT_FOUND;
+  strlcpy(buffer, request.query.c_str(), length);
+  return ESP_OK;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* req, const char* field, char* value, size_t length) {
+  size_t fieldLength = strlen(field);
+  for (const std::string& header : state(req).headers) {
+    if (header.size() > fieldLength && header[fieldLength] == ':' &&
+        strncasecmp(header.c_str(), field, fieldLength) == 0) {
+      const char* text = header.c_str() + fieldLength + 1;
+      while (*text == ' ') text++;
+      strlcpy(value, text, length);
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_to_sockfd(httpd_req_t* req) {
+  return -1;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status) {
+  state(req).response.status = status;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type) {
+  state(req).response.contentType = type;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value) {
+  StubRequest& request = state(req);
+  if (request.headerCount >= server->config.max_resp_headers) return ESP_FAIL;
+  request.headerCount++;
+  request.response.headers.append(field).append(": ").append(value).append("\r\n");
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buffer, ssize_t length) {
+  StubRequest& request = state(req);
+  if (request.sent) return ESP_FAIL;
+  request.sent = true;
+  if (buffer != nullptr) request.response.body.assign(buffer, length < 0 ? strlen(buffer) : length);
+  request.response.complete = true;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buffer, ssize_t length) {
+  StubRequest& request = state(req);
+  if (request.response.complete) return ESP_FAIL;
+  request.sent = true;
+  if (buffer == nullptr || length == 0) {
+    request.response.complete = true;
+    return ESP_OK;
+  }
+  request.response.body.append(buffer, length < 0 ? strlen(buffer) : length);
+  request.response.chunks++;
+  return ESP_OK;
+}
+
+int httpd_send(httpd_req_t* req, const char* buffer, size_t length) {
+  StubRequest& request = state(req);
+  if (request.sent) return -1;
+  std::string raw(buffer, length);
+  size_t end = raw.find("\r\n\r\n");
+  if (raw.compare(0, 9, "HTTP/1.1 ") != 0 || end == std::string::npos) return -1;
+  request.sent = true;
+  HttpResponse& response = request.response;
+  size_t line = raw.find("\r\n");
+  response.status = raw.substr(9, line - 9);
+  for (line += 2; line < end + 2; line = raw.find("\r\n", line) + 2) {
+    std::string header = raw.substr(line, raw.find("\r\n", line) - line);
+    if (header.compare(0, 14, "Content-Type: ") == 0) response.contentType = header.substr(14);
+    else response.headers.append(header).append("\r\n");
+  }
+  response.body = raw.substr(end + 4);
+  response.complete = true;
+  return length;
+}
+
+std::string HttpResponse::header(const char* name) const {
+  size_t nameLength = strlen(name);
+  for (size_t line = 0; line < headers.size(); line = headers.find("\r\n", line) + 2) {
+    if (headers.compare(line + nameLength, 2, ": ") == 0 && strncasecmp(headers.c_str() + line, name, nameLength) == 0) {
+      size_t value = line + nameLength + 2;
+      return headers.substr(value, headers.find("\r\n", value) - value);
+    }
+  }
+  return std::string();
+}
+
+HttpResponse httpRequest(httpd_method_t method, const char* uri, const std::string& body,
+                         const std::vector<std::string>& headers) {
+  StubRequest request;
+  request.headers = headers;
+  request.body = body;
+  HttpResponse& response = request.response;
+  response.result = ESP_ERR_NOT_FOUND;
+  response.status.reserve(64);
+  response.contentType.reserve(64);
+  response.headers.reserve(1024);
+  response.body.reserve(64 * 1024);
+  response.chunks = 0;
+  response.complete = false;
+  response.heap = HeapUsage{0, 0, 0, 0};
+  const char* query = strchr(uri, '?');
+  size_t pathLength = query ? query - uri : strlen(uri);
+  if (query != nullptr) request.query = query + 1;
+
+  // The uri member is const, so the request is built in raw storage
+  alignas(httpd_req_t) unsigned char storage[sizeof(httpd_req_t)] = {};
+  httpd_req_t& req = *reinterpret_cast<httpd_req_t*>(storage);
+  req.handle = server;
+  req.method = method;
+  strlcpy((char*)req.uri, uri, sizeof(req.uri));
+  req.content_len = body.size();
+  req.aux = &request;
+
+  for (const httpd_uri_t& handler : server->handlers) {
+    if (handler.method != method) continue;
+    httpd_uri_match_func_t match = server->config.uri_match_fn;
+    bool matched = match ? match(handler.uri, uri, pathLength)
+                         : strlen(handler.uri) == pathLength && strncmp(handler.uri, uri, pathLength) == 0;
+    if (!matched) continue;
+    req.user_ctx = handler.user_ctx;
+    resetHeapPeak();
+    HeapUsage before = heapUsage();
+    response.result = handler.handler(&req);
+    HeapUsage after = heapUsage();
+    response.heap.bytes = after.bytes - before.bytes;
+    response.heap.allocations = after.allocations - before.allocations;
+    response.heap.peak = after.peak > before.live ? after.peak - before.live : 0;
+    break;
+  }
+  return response;
+}
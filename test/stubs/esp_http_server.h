@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+#include <sys/types.h>
+
+// esp_http_server without sockets: handlers are registered as usual and
+// called by httpRequest() (native_stubs.h), which also collects what they
+// send.
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#define ESP_FAIL -1
+#endif
+#define ESP_ERR_NOT_FOUND 0x105
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+enum http_method {
+  HTTP_DELETE = 0,
+  HTTP_GET = 1,
+  HTTP_HEAD = 2,
+  HTTP_POST = 3,
+  HTTP_PUT = 4,
+  HTTP_OPTIONS = 6,
+  HTTP_PATCH = 28,
+};
+typedef enum http_method httpd_method_t;
+typedef void* httpd_handle_t;
+
+#define HTTPD_MAX_URI_LEN 512
+
+typedef struct httpd_req {
+  httpd_handle_t handle;
+  int method;
+  const char uri[HTTPD_MAX_URI_LEN + 1];
+  size_t content_len;
+  void* aux;
+  void* user_ctx;
+} httpd_req_t;
+
+typedef bool (*httpd_uri_match_func_t)(const char* reference, const char* uri, size_t length);
+
+typedef struct {
+  unsigned task_priority;
+  size_t stack_size;
+  BaseType_t core_id;
+  uint16_t server_port;
+  uint16_t ctrl_port;
+  uint16_t max_open_sockets;
+  uint16_t max_uri_handlers;
+  uint16_t max_resp_headers;
+  uint16_t backlog_conn;
+  bool lru_purge_enable;
+  uint16_t recv_wait_timeout;
+  uint16_t send_wait_timeout;
+  httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG()                                                                                  \
+  {                                                                                                             \
+    .task_priority = 5, .stack_size = 4096, .core_id = 0x7FFFFFFF, .server_port = 80, .ctrl_port = 32768,      \
+    .max_open_sockets = 7, .max_uri_handlers = 8, .max_resp_headers = 8, .backlog_conn = 5,                    \
+    .lru_purge_enable = false, .recv_wait_timeout = 5, .send_wait_timeout = 5, .uri_match_fn = nullptr,        \
+  }
+
+typedef struct httpd_uri {
+  const char* uri;
+  httpd_method_t method;
+  esp_err_t (*handler)(httpd_req_t* req);
+  void* user_ctx;
+} httpd_uri_t;
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri);
+bool httpd_uri_match_wildcard(const char* reference, const char* uri, size_t length);
+
+int httpd_req_recv(httpd_req_t* req, char* buffer, size_t length);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buffer, size_t length);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* req, const char* field, char* value, size_t length);
+int httpd_req_to_sockfd(httpd_req_t* req);
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status);
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value);
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buffer, ssize_t length);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buffer, ssize_t length);
+// Raw bytes to the socket. The stub expects one complete status line and
+// header block, which it files into the response like the calls above.
+int httpd_send(httpd_req_t* req, const char* buffer, size_t length);
@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+
+// One 1.5 MB update partition that accepts every write and image.
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#define ESP_FAIL -1
+#endif
+
+typedef uint32_t esp_ota_handle_t;
+typedef struct {
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+typedef enum {
+  ESP_OTA_IMG_NEW = 0,
+  ESP_OTA_IMG_PENDING_VERIFY = 1,
+  ESP_OTA_IMG_VALID = 2,
+  ESP_OTA_IMG_INVALID = 3,
+  ESP_OTA_IMG_ABORTED = 4,
+  ESP_OTA_IMG_UNDEFINED = -1,
+} esp_ota_img_states_t;
+
+#define OTA_WITH_SEQUENTIAL_WRITES 0xFFFFFFFE
+
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start);
+esp_err_t esp_ota_get_state_partition(const esp_partition_t* partition, esp_ota_img_states_t* state);
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t size, esp_ota_handle_t* handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback();
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot();
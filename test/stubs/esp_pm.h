@@ -0,0 +1,19 @@
+#pragma once
+#include <stdbool.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#define ESP_FAIL -1
+#endif
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+typedef struct {
+  int max_freq_mhz;
+  int min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_t;
+typedef esp_pm_config_t esp_pm_config_esp32s3_t;
+
+esp_err_t esp_pm_configure(const void* config);
+const char* esp_err_to_name(esp_err_t code);
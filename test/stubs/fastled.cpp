@@ -0,0 +1,54 @@
+#include <FastLED.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+CFastLED FastLED;
+
+static std::atomic<uint32_t> showMicros{0};
+static std::atomic<uint32_t> shows{0};
+static std::atomic<uint8_t> showBrightness{0};
+
+void setShowMicros(uint32_t us) {
+  showMicros = us;
+}
+
+uint32_t showCount() {
+  return shows;
+}
+
+uint8_t lastShowBrightness() {
+  return showBrightness;
+}
+
+void CFastLED::show(uint8_t brightness) {
+  uint32_t us = showMicros;
+  if (us > 0) std::this_thread::sleep_for(std::chrono::microseconds(us));
+  showBrightness = brightness;
+  shows++;
+}
+
+void hsv2rgb_spectrum(const CHSV& hsv, CRGB& rgb) {
+  // Straight-line hue sections like FastLED's spectrum conversion
+  uint8_t value = hsv.v;
+  uint8_t floor = scale8(value, 255 - hsv.s);
+  uint8_t range = value - floor;
+  uint16_t hue = hsv.h * 3;
+  uint8_t section = hue >> 8;
+  uint8_t offset = hue & 0xFF;
+  uint8_t rising = floor + scale8(offset, range);
+  uint8_t falling = floor + scale8(255 - offset, range);
+  switch (section) {
+    case 0: rgb = CRGB(falling, rising, floor); break;
+    case 1: rgb = CRGB(floor, falling, rising); break;
+    default: rgb = CRGB(rising, floor, falling); break;
+  }
+}
+
+void fill_rainbow(CRGB* leds, int count, uint8_t initialHue, uint8_t deltaHue) {
+  CHSV hsv(initialHue, 240, 255);
+  for (int i = 0; i < count; i++) {
+    hsv2rgb_spectrum(hsv, leds[i]);
+    hsv.h += deltaHue;
+  }
+}
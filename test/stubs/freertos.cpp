@@ -0,0 +1,114 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+struct StubTask {
+  std::mutex lock;
+  std::condition_variable notified;
+  uint32_t notifications = 0;
+};
+
+struct StubEventGroup {
+  std::mutex lock;
+  std::condition_variable changed;
+  EventBits_t bits = 0;
+};
+
+// Threads that are not FreeRTOS tasks (the test's own) get a handle on first use
+static thread_local StubTask* currentTask = nullptr;
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+  while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)) std::this_thread::yield();
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+  __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackSize, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  StubTask* created = new StubTask();
+  if (handle != nullptr) *handle = created;
+  std::thread([task, parameter, created]() {
+    currentTask = created;
+    task(parameter);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stackSize, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+  return xTaskCreatePinnedToCore(task, name, stackSize, parameter, priority, handle, 0);
+}
+
+// Only tasks deleting themselves, which is all the firmware does
+void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr || task == currentTask) pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (currentTask == nullptr) currentTask = new StubTask();
+  return currentTask;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notifications++;
+  task->notified.notify_all();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  StubTask* task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  auto ready = [task]() { return task->notifications > 0; };
+  if (ticks == portMAX_DELAY) task->notified.wait(guard, ready);
+  else task->notified.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+  uint32_t count = task->notifications;
+  if (count > 0) task->notifications = clearOnExit ? 0 : count - 1;
+  return count;
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+  return new StubEventGroup();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> guard(group->lock);
+  group->bits |= bits;
+  group->changed.notify_all();
+  return group->bits;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits, BaseType_t* woken) {
+  xEventGroupSetBits(group, bits);
+  if (woken != nullptr) *woken = pdFALSE;
+  return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> guard(group->lock);
+  EventBits_t before = group->bits;
+  group->bits &= ~bits;
+  return before;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks) {
+  std::unique_lock<std::mutex> guard(group->lock);
+  auto ready = [group, bits, waitForAll]() {
+    return waitForAll ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+  };
+  if (ticks == portMAX_DELAY) group->changed.wait(guard, ready);
+  else group->changed.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+  EventBits_t result = group->bits;
+  if (clearOnExit && ready()) group->bits &= ~bits;
+  return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+// What tests and the benchmark use to drive the host stand-ins.
+#include <Arduino.h>
+#include <esp_http_server.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Mock clock behind millis() and micros(). It only moves when told to.
+void setMicros(uint64_t us);
+void advanceMicros(uint64_t us);
+inline void setMillis(uint64_t ms) { setMicros(ms * 1000); }
+inline void advanceMillis(uint64_t ms) { advanceMicros(ms * 1000); }
+
+// Preferences: puts and removes since the last nvsReset(), which also
+// erases the store.
+uint32_t nvsWrites();
+void nvsReset();
+
+// operator new: totals since the process started. Take the difference
+// around the code being measured. `live` is what is allocated and not yet
+// deleted, `peak` its high-water mark since the last resetHeapPeak().
+struct HeapUsage {
+  uint64_t bytes;
+  uint32_t allocations;
+  uint64_t live;
+  uint64_t peak;
+};
+HeapUsage heapUsage();
+void resetHeapPeak();
+
+// FastLED.show(): how long it blocks (real time, so an output task really is
+// busy for that long) and what it has been asked to show.
+void setShowMicros(uint32_t us);
+uint32_t showCount();
+uint8_t lastShowBrightness();
+
+struct HttpResponse {
+  esp_err_t result;         // the handler's return value
+  std::string status;       // "200 OK"
+  std::string contentType;
+  std::string headers;      // set with httpd_resp_set_hdr(), "Name: value\r\n" each
+  std::string body;
+  uint32_t chunks;          // 0 unless the body was chunked
+  bool complete;            // sent in one piece, or the last chunk arrived
+  HeapUsage heap;           // allocated by the handler, peak is the most it
+                            // held at once; the fields above are reserved up
+                            // front so they do not count
+
+  // Value of a response header, empty if it was not set
+  std::string header(const char* name) const;
+};
+
+// Runs the handler registered for `method` and `uri` (with its query string)
+// the way esp_http_server would, with `headers` as "Name: value" strings.
+HttpResponse httpRequest(httpd_method_t method, const char* uri, const std::string& body = std::string(),
+                         const std::vector<std::string>& headers = {});
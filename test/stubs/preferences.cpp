@@ -0,0 +1,88 @@
+#include <Preferences.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+static std::mutex storeLock;
+static std::map<std::string, Namespace> namespaces;
+static uint32_t writes = 0;
+
+uint32_t nvsWrites() {
+  std::lock_guard<std::mutex> guard(storeLock);
+  return writes;
+}
+
+void nvsReset() {
+  std::lock_guard<std::mutex> guard(storeLock);
+  namespaces.clear();
+  writes = 0;
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  if (_open || strlen(name) >= sizeof(_name)) return false;
+  strlcpy(_name, name, sizeof(_name));
+  _open = true;
+  _readOnly = readOnly;
+  return true;
+}
+
+void Preferences::end() {
+  _open = false;
+}
+
+bool Preferences::clear() {
+  if (!_open || _readOnly) return false;
+  std::lock_guard<std::mutex> guard(storeLock);
+  namespaces[_name].clear();
+  writes++;
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!_open || _readOnly) return false;
+  std::lock_guard<std::mutex> guard(storeLock);
+  writes++;
+  return namespaces[_name].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  if (!_open) return false;
+  std::lock_guard<std::mutex> guard(storeLock);
+  return namespaces[_name].count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  if (!_open || _readOnly) return 0;
+  std::lock_guard<std::mutex> guard(storeLock);
+  const uint8_t* bytes = (const uint8_t*)value;
+  namespaces[_name][key].assign(bytes, bytes + length);
+  writes++;
+  return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!_open) return 0;
+  std::lock_guard<std::mutex> guard(storeLock);
+  Namespace& keys = namespaces[_name];
+  auto found = keys.find(key);
+  return found == keys.end() ? 0 : found->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t length) {
+  if (!_open) return 0;
+  std::lock_guard<std::mutex> guard(storeLock);
+  Namespace& keys = namespaces[_name];
+  auto found = keys.find(key);
+  if (found == keys.end() || found->second.size() > length) return 0;
+  memcpy(buffer, found->second.data(), found->second.size());
+  return found->second.size();
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t length) {
+  size_t stored = getBytes(key, value, length);
+  if (stored == 0 && length > 0) value[0] = '\0';
+  return stored;
+}
@@ -0,0 +1,111 @@
+// Static asset and page shell serving: bytes on the wire against the source
+// files in web/, time per request, and heap use. The page shell is streamed
+// from flash and must not allocate.
+//
+//   pio test -e native -f test_bench_assets
+#include <unity.h>
+#include "native_stubs.h"
+#include "web_assets.h"
+#include "../bench_report.h"
+
+static const int ITERATIONS = 1000;
+
+struct BenchAsset {
+  const char* name;
+  const char* uri;
+  const char* source;      // file in web/ the response is built from
+  const char* header;      // extra request header, or nullptr
+  const char* status;
+};
+
+static const BenchAsset ASSETS[] = {
+  {"css", "/app.css", "web/style.css", nullptr, "200 OK"},
+  {"css revalidated", "/app.css", "web/style.css", "If-None-Match: " APP_CSS_ETAG, "304 Not Modified"},
+  {"js", "/app.js", "web/app.js", nullptr, "200 OK"},
+  {"js revalidated", "/app.js", "web/app.js", "If-None-Match: " APP_JS_ETAG, "304 Not Modified"},
+  {"page shell", "/", "web/page.html", nullptr, "200 OK"},
+};
+
+static BenchReport report("assets");
+
+// Size of a file under the project directory, 0 if it is not there
+static uint64_t sourceBytes(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) return 0;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  return size < 0 ? 0 : size;
+}
+
+static HttpResponse get(const BenchAsset& asset) {
+  std::vector<std::string> headers;
+  if (asset.header) headers.push_back(asset.header);
+  return httpRequest(HTTP_GET, asset.uri, std::string(), headers);
+}
+
+static void bench(const BenchAsset& asset) {
+  HttpResponse response = get(asset);
+  TEST_ASSERT_EQUAL_STRING(asset.status, response.status.c_str());
+  TEST_ASSERT_TRUE(response.complete);
+
+  uint64_t start = wallNanos();
+  HeapUsage heap = {0, 0};
+  for (int i = 0; i < ITERATIONS; i++) {
+    HttpResponse timed = get(asset);
+    heap.bytes += timed.heap.bytes;
+    heap.allocations += timed.heap.allocations;
+  }
+  uint64_t elapsed = wallNanos() - start;
+
+  report.add(BenchRow()
+                 .add("asset", asset.name)
+                 .add("status", atoi(response.status.c_str()))
+                 .add("source_bytes", sourceBytes(asset.source))
+                 .add("response_bytes", (uint64_t)response.body.size())
+                 .add("serve_us", elapsed / 1000.0 / ITERATIONS)
+                 .add("alloc_bytes", (double)heap.bytes / ITERATIONS)
+                 .add("allocations", (double)heap.allocations / ITERATIONS));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_gzip_assets() {
+  for (int i = 0; i < 4; i++) bench(ASSETS[i]);
+
+  HttpResponse css = get(ASSETS[0]);
+  TEST_ASSERT_EQUAL_STRING("gzip", css.header("Content-Encoding").c_str());
+  TEST_ASSERT_EQUAL_STRING(APP_CSS_ETAG, css.header("ETag").c_str());
+  TEST_ASSERT_EQUAL(APP_CSS_GZ_LEN, css.body.size());
+  TEST_ASSERT_EQUAL_HEX8(0x1F, (uint8_t)css.body[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x8B, (uint8_t)css.body[1]);
+
+  HttpResponse revalidated = get(ASSETS[1]);
+  TEST_ASSERT_EQUAL(0, revalidated.body.size());
+  TEST_ASSERT_EQUAL_STRING(APP_CSS_ETAG, revalidated.header("ETag").c_str());
+}
+
+void test_page_shell() {
+  bench(ASSETS[4]);
+
+  HttpResponse page = get(ASSETS[4]);
+  TEST_ASSERT_EQUAL(0, page.heap.allocations);
+  TEST_ASSERT_EQUAL(0, page.body.compare(0, strlen(PAGE_HEAD), PAGE_HEAD));
+  TEST_ASSERT_TRUE(page.body.find(PAGE_NAV) != std::string::npos);
+  TEST_ASSERT_TRUE(page.body.size() >= strlen(PAGE_FOOT));
+  TEST_ASSERT_EQUAL(0, page.body.compare(page.body.size() - strlen(PAGE_FOOT), strlen(PAGE_FOOT), PAGE_FOOT));
+}
+
+void test_write_report() {
+  TEST_ASSERT_TRUE(report.write());
+}
+
+int main(int argc, char** argv) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_gzip_assets);
+  RUN_TEST(test_page_shell);
+  RUN_TEST(test_write_report);
+  return UNITY_END();
+}
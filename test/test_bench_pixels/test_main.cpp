@@ -0,0 +1,142 @@
+// The pixel pipeline: CPU time serviceLedEffects() spends per frame for
+// each effect and strip length, and the hand-off to the output task. With a
+// show() that takes real time the next frame must be rendered while the
+// strip is busy and presented as soon as it is free. A strip that has gone
+// dark is not sent again.
+//
+//   pio test -e native -f test_bench_pixels
+#include <unity.h>
+#include <thread>
+#include "native_stubs.h"
+#include "led_effects.h"
+#include "led_output.h"
+#include "../bench_report.h"
+
+static const int FRAMES = 500;
+static const uint16_t STRIP_LENGTHS[] = {60, 300, MAX_LEDS};
+static const LedEffect EFFECTS[] = {LedEffect::Solid, LedEffect::Breathe, LedEffect::Rainbow, LedEffect::Blink};
+
+static BenchReport report("pixels");
+
+static void waitForOutput() {
+  while (!ledOutputReady()) std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+// Renders FRAMES frame ticks with an instant show(), waiting for the output
+// task between frames so only the render itself is timed
+static void bench(uint16_t length, LedEffect effect) {
+  resizeLedOutput(length);
+  setLedEffect(effect, 2000);
+  setLedTarget(true, CRGB(255, 128, 0), 200);
+  // Past the on fade so every frame is steady state
+  advanceMillis(LED_FADE_TIME + LED_FRAME_INTERVAL);
+  serviceLedEffects();
+  waitForOutput();
+
+  LedFrameStats before = ledFrameStats();
+  uint32_t showsBefore = showCount();
+  uint64_t total = 0, slowest = 0;
+  for (int i = 0; i < FRAMES; i++) {
+    advanceMillis(LED_FRAME_INTERVAL);
+    uint64_t start = wallNanos();
+    serviceLedEffects();
+    uint64_t elapsed = wallNanos() - start;
+    total += elapsed;
+    slowest = max(slowest, elapsed);
+    waitForOutput();
+  }
+  LedFrameStats after = ledFrameStats();
+
+  report.add(BenchRow()
+                 .add("effect", ledEffectName(effect))
+                 .add("pixels", (uint32_t)length)
+                 .add("frame_us", total / 1000.0 / FRAMES)
+                 .add("frame_us_max", slowest / 1000.0)
+                 .add("ns_per_pixel", (double)total / FRAMES / length)
+                 .add("frames", after.frames - before.frames)
+                 .add("shows", showCount() - showsBefore));
+
+  TEST_ASSERT_EQUAL(FRAMES, after.frames - before.frames);
+  // A solid strip is only sent when it changes
+  if (effect == LedEffect::Solid) TEST_ASSERT_EQUAL(0, showCount() - showsBefore);
+  else TEST_ASSERT_TRUE(showCount() - showsBefore > 0);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_render_cost() {
+  for (uint16_t length : STRIP_LENGTHS) {
+    for (LedEffect effect : EFFECTS) bench(length, effect);
+  }
+}
+
+void test_renders_while_the_strip_is_busy() {
+  resizeLedOutput(MAX_LEDS);
+  setLedEffect(LedEffect::Rainbow, 2000);
+  advanceMillis(LED_FRAME_INTERVAL);
+  serviceLedEffects();
+  waitForOutput();
+
+  // A show() far longer than a frame: the next frame is due while it runs
+  uint32_t shows = showCount();
+  setShowMicros(200000);
+  advanceMillis(LED_FRAME_INTERVAL);
+  serviceLedEffects();
+  TEST_ASSERT_FALSE(ledOutputReady());
+  LedFrameStats busy = ledFrameStats();
+
+  advanceMillis(LED_FRAME_INTERVAL);
+  serviceLedEffects();
+  LedFrameStats rendered = ledFrameStats();
+  TEST_ASSERT_EQUAL(busy.frames + 1, rendered.frames);
+  TEST_ASSERT_EQUAL(busy.shows, rendered.shows);
+  TEST_ASSERT_EQUAL(1, ledEffectsWaitTime(100));
+
+  // Presented once the strip is free, without waiting for the next tick
+  setShowMicros(0);
+  waitForOutput();
+  TEST_ASSERT_EQUAL(0, ledEffectsWaitTime(100));
+  serviceLedEffects();
+  waitForOutput();
+  TEST_ASSERT_EQUAL(rendered.frames, ledFrameStats().frames);
+  TEST_ASSERT_EQUAL(rendered.shows + 1, ledFrameStats().shows);
+  // The slow frame, then the one rendered while it was sent
+  TEST_ASSERT_EQUAL(shows + 2, showCount());
+}
+
+// Switched off, a rainbow fades out and is then left alone
+void test_dark_rainbow_is_not_shown() {
+  resizeLedOutput(300);
+  setLedEffect(LedEffect::Rainbow, 2000);
+  setLedTarget(false, CRGB(255, 128, 0), 200);
+  for (unsigned long t = 0; t <= LED_FADE_TIME + 2 * LED_FRAME_INTERVAL; t += LED_FRAME_INTERVAL) {
+    advanceMillis(LED_FRAME_INTERVAL);
+    serviceLedEffects();
+    waitForOutput();
+  }
+
+  uint32_t shows = showCount();
+  for (int i = 0; i < 100; i++) {
+    advanceMillis(LED_FRAME_INTERVAL);
+    serviceLedEffects();
+    waitForOutput();
+  }
+  TEST_ASSERT_EQUAL(shows, showCount());
+}
+
+void test_write_report() {
+  TEST_ASSERT_TRUE(report.write());
+}
+
+int main(int argc, char** argv) {
+  setMillis(1000);
+  beginLedOutput(MAX_LEDS);
+  beginLedEffects();
+  UNITY_BEGIN();
+  RUN_TEST(test_render_cost);
+  RUN_TEST(test_renders_while_the_strip_is_busy);
+  RUN_TEST(test_dark_rainbow_is_not_shown);
+  RUN_TEST(test_write_report);
+  return UNITY_END();
+}
@@ -0,0 +1,245 @@
+// Per-route cost of the web UI and API: render time, heap allocated while
+// handling the request and the most of it held at once, response size, and the NVS writes the request leads
+// to once the control loop has applied it and the stores have flushed.
+//
+//   pio test -e native -f test_bench_routes
+#include <unity.h>
+#include <WiFi.h>
+#include "native_stubs.h"
+#include "http_server.h"
+#include "led_store.h"
+#include "loop_events.h"
+#include "ota_update.h"
+#include "web_assets.h"
+#include "../bench_report.h"
+
+extern HttpServer server;
+
+static const int ITERATIONS = 20;
+
+struct BenchRoute {
+  httpd_method_t method;
+  const char* uri;
+  const char* body;        // form body unless it starts with '{'
+  const char* header;      // one extra request header, or nullptr
+};
+
+// Everything setup() registers except /clear-credentials (restarts) and the
+// update uploads (flash writes, covered by the OTA tests). POSTs that change
+// state run in an order that leaves the next one something to do.
+static const BenchRoute ROUTES[] = {
+  {HTTP_GET, "/", nullptr, nullptr},
+  {HTTP_GET, "/led", nullptr, nullptr},
+  {HTTP_GET, "/wifi-setup", nullptr, nullptr},
+  {HTTP_GET, "/scan", nullptr, nullptr},
+  {HTTP_GET, "/api/scan.json", nullptr, nullptr},
+  {HTTP_POST, "/connect", "ssid=bench&password=benchmark", nullptr},
+  {HTTP_GET, "/api/networks", nullptr, nullptr},
+  {HTTP_POST, "/forget-network", "ssid=bench", nullptr},
+  {HTTP_POST, "/toggle-led", "ajax=1", nullptr},
+  {HTTP_POST, "/set-color", "color=%2300ff80&ajax=1", nullptr},
+  {HTTP_POST, "/set-brightness", "brightness=80&ajax=1", nullptr},
+  {HTTP_GET, "/api/effect", nullptr, nullptr},
+  {HTTP_POST, "/api/effect", "effect=breathe&period=3000", nullptr},
+  {HTTP_GET, "/api/state", nullptr, nullptr},
+  {HTTP_PUT, "/api/state", "{\"on\":true,\"bri\":120,\"color\":\"#ff8000\"}", nullptr},
+  {HTTP_GET, "/api/segments", nullptr, nullptr},
+  {HTTP_POST, "/api/segments", "pixels=60&segments=0:30:ff0000:solid,30:30:0000ff:rainbow", nullptr},
+  {HTTP_GET, "/api/fleet", nullptr, nullptr},
+  {HTTP_POST, "/api/fleet", "role=off&group=0", nullptr},
+  {HTTP_GET, "/timer", nullptr, nullptr},
+  {HTTP_POST, "/timer/add", "time=07:30&action=on&color=%23ffffff", nullptr},
+  {HTTP_GET, "/api/timers", nullptr, nullptr},
+  {HTTP_POST, "/timer/delete", "id=1", nullptr},
+  {HTTP_GET, "/info", nullptr, nullptr},
+  {HTTP_GET, "/metrics", nullptr, nullptr},
+  {HTTP_GET, "/update", nullptr, nullptr},
+  {HTTP_GET, "/app.css", nullptr, nullptr},
+  {HTTP_GET, "/app.js", nullptr, nullptr},
+  {HTTP_GET, "/app.css", nullptr, "If-None-Match: " APP_CSS_ETAG},
+  {HTTP_GET, "/generate_204", nullptr, nullptr},
+  {HTTP_GET, "/missing", nullptr, nullptr},
+};
+
+static const char* methodName(httpd_method_t method) {
+  switch (method) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_PUT: return "PUT";
+    default: return "OTHER";
+  }
+}
+
+// One pass of the control loop, without waiting for its next deadline
+static void runLoop() {
+  notifyLoop(LOOP_EVENT_COMMAND);
+  loop();
+}
+
+// Applies queued commands and lets the debounced stores write
+static void flushStores() {
+  runLoop();
+  advanceMillis(LED_SAVE_QUIET_PERIOD + 1000);
+  runLoop();
+}
+
+static HttpResponse perform(const BenchRoute& route) {
+  std::vector<std::string> headers;
+  std::string body = route.body ? route.body : "";
+  if (!body.empty()) {
+    headers.push_back(body[0] == '{' ? "Content-Type: application/json"
+                                     : "Content-Type: application/x-www-form-urlencoded");
+  }
+  if (route.header) headers.push_back(route.header);
+  return httpRequest(route.method, route.uri, body, headers);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_routes() {
+  BenchReport report("routes");
+  for (const BenchRoute& route : ROUTES) {
+    // One request with the stores flushed before and after, for the writes
+    // it causes
+    flushStores();
+    uint32_t writesBefore = nvsWrites();
+    HttpResponse response = perform(route);
+    flushStores();
+    uint32_t writes = nvsWrites() - writesBefore;
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s %s", methodName(route.method), route.uri);
+    TEST_ASSERT_TRUE_MESSAGE(response.complete, name);
+    TEST_ASSERT_TRUE_MESSAGE(response.status.compare(0, 3, "500") != 0, name);
+
+    uint64_t totalNanos = 0, maxNanos = 0, peakBytes = 0;
+    HeapUsage heap = {0, 0};
+    for (int i = 0; i < ITERATIONS; i++) {
+      uint64_t start = wallNanos();
+      HttpResponse timed = perform(route);
+      uint64_t elapsed = wallNanos() - start;
+      totalNanos += elapsed;
+      maxNanos = max(maxNanos, elapsed);
+      heap.bytes += timed.heap.bytes;
+      heap.allocations += timed.heap.allocations;
+      peakBytes = max(peakBytes, timed.heap.peak);
+      // Keep the command queue drained
+      runLoop();
+    }
+
+    report.add(BenchRow()
+                   .add("route", name)
+                   .add("status", atoi(response.status.c_str()))
+                   .add("response_bytes", (uint64_t)response.body.size())
+                   .add("chunks", response.chunks)
+                   .add("render_us", totalNanos / 1000.0 / ITERATIONS)
+                   .add("render_us_max", maxNanos / 1000.0)
+                   .add("alloc_bytes", (double)heap.bytes / ITERATIONS)
+                   .add("allocations", (double)heap.allocations / ITERATIONS)
+                   .add("peak_heap_bytes", peakBytes)
+                   .add("nvs_writes", writes));
+  }
+  TEST_ASSERT_TRUE(report.write());
+}
+
+// Value of one sample in the /metrics output, -1 if it is missing
+static double metric(const char* sample) {
+  HttpResponse response = httpRequest(HTTP_GET, "/metrics");
+  std::string prefix = std::string("\n") + sample + " ";
+  size_t at = response.body.find(prefix);
+  return at == std::string::npos ? -1 : atof(response.body.c_str() + at + prefix.size());
+}
+
+// Every body byte counts once, however the handler sent it
+void test_response_bytes_are_counted_once() {
+  static const char* const SAMPLES[][2] = {
+    {"/app.css", "http_response_bytes_total{path=\"/app.css\",method=\"GET\"}"},       // send_P()
+    {"/api/state", "http_response_bytes_total{path=\"/api/state\",method=\"GET\"}"},   // ResponseWriter
+    {"/generate_204", "http_response_bytes_total{path=\"/generate_204\",method=\"ANY\"}"},
+    {"/missing", "http_response_bytes_total{path=\"other\",method=\"ANY\"}"},          // send()
+  };
+  for (const auto& sample : SAMPLES) {
+    double before = metric(sample[1]);
+    TEST_ASSERT_TRUE_MESSAGE(before >= 0, sample[1]);
+    HttpResponse response = httpRequest(HTTP_GET, sample[0]);
+    TEST_ASSERT_EQUAL_MESSAGE(before + response.body.size(), metric(sample[1]), sample[0]);
+  }
+  TEST_ASSERT_TRUE(metric("loop_duration_seconds_sum") >= 0);
+}
+
+// SSIDs are chosen by whoever is in radio range: the /scan fragment keeps
+// them as escaped text and never writes them into a handler
+void test_scan_fragment_escapes_ssids() {
+  WiFi.scanSsids = {"\");alert(1);//", "<img src=x onerror=alert(1)>"};
+  httpRequest(HTTP_GET, "/scan"); // stale cache, queues a scan
+  runLoop();
+  runLoop();
+  HttpResponse response = httpRequest(HTTP_GET, "/scan");
+  WiFi.scanSsids.clear();
+  TEST_ASSERT_EQUAL_STRING("200 OK", response.status.c_str());
+  TEST_ASSERT_TRUE(response.body.find("data-ssid=\"&quot;);alert(1);//\"") != std::string::npos);
+  TEST_ASSERT_TRUE(response.body.find("&lt;img") != std::string::npos);
+  TEST_ASSERT_TRUE(response.body.find("<img") == std::string::npos);
+  TEST_ASSERT_TRUE(response.body.find("alert(1);//\")") == std::string::npos);
+  TEST_ASSERT_TRUE(response.body.find("onclick='selectNetwork(this)'") != std::string::npos);
+}
+
+// HEAD runs the GET route and ends the response after the headers, for
+// buffered, streamed and static bodies alike, with the GET body's length
+void test_head_sends_no_body() {
+  for (const char* uri : {"/api/state", "/led", "/app.css", "/missing"}) {
+    HttpResponse get = httpRequest(HTTP_GET, uri);
+    HttpResponse head = httpRequest(HTTP_HEAD, uri);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(get.status.c_str(), head.status.c_str(), uri);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(get.contentType.c_str(), head.contentType.c_str(), uri);
+    TEST_ASSERT_TRUE_MESSAGE(head.complete, uri);
+    TEST_ASSERT_EQUAL_MESSAGE(0, head.body.size(), uri);
+    TEST_ASSERT_EQUAL_MESSAGE(0, head.chunks, uri);
+    TEST_ASSERT_EQUAL_MESSAGE(get.body.size(), atoi(head.header("Content-Length").c_str()), uri);
+  }
+  HttpResponse asset = httpRequest(HTTP_HEAD, "/app.css");
+  TEST_ASSERT_EQUAL_STRING("gzip", asset.header("Content-Encoding").c_str());
+  TEST_ASSERT_EQUAL_STRING(APP_CSS_ETAG, asset.header("ETag").c_str());
+}
+
+// A GET route with side effects is not run for HEAD
+void test_head_skips_clear_credentials() {
+  HttpResponse head = httpRequest(HTTP_HEAD, "/clear-credentials");
+  TEST_ASSERT_EQUAL_STRING("405 Method Not Allowed", head.status.c_str());
+  TEST_ASSERT_EQUAL_STRING("GET", head.header("Allow").c_str());
+  TEST_ASSERT_EQUAL(0, head.body.size());
+}
+
+// Routes past HTTP_MAX_ROUTES would be dropped with only a log line
+void test_route_table_has_room() {
+  TEST_ASSERT_TRUE(server.routeCount() < HTTP_MAX_ROUTES);
+}
+
+// The native build has no OTA_TOKEN, so both update POSTs are refused
+// before anything is read or written
+void test_updates_need_a_token() {
+  HttpResponse push = httpRequest(HTTP_POST, "/update?sha256=00", "image",
+                                  {"Content-Type: application/octet-stream", "Authorization: Bearer guess"});
+  TEST_ASSERT_EQUAL_STRING("403 Forbidden", push.status.c_str());
+  HttpResponse pull = httpRequest(HTTP_POST, "/update/pull", "url=http%3A%2F%2F10.0.0.2%2Ffirmware.bin&sha256=00",
+                                  {"Content-Type: application/x-www-form-urlencoded"});
+  TEST_ASSERT_EQUAL_STRING("403 Forbidden", pull.status.c_str());
+  TEST_ASSERT_EQUAL(OtaState::Idle, otaStatus().state);
+
+  TEST_ASSERT_FALSE(otaAuthorized("Bearer "));
+  TEST_ASSERT_FALSE(otaAuthorized(nullptr));
+}
+
+int main(int argc, char** argv) {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_routes);
+  RUN_TEST(test_response_bytes_are_counted_once);
+  RUN_TEST(test_scan_fragment_escapes_ssids);
+  RUN_TEST(test_head_sends_no_body);
+  RUN_TEST(test_head_skips_clear_credentials);
+  RUN_TEST(test_route_table_has_room);
+  RUN_TEST(test_updates_need_a_token);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+// buildDnsAnswer() on queries the way phones and laptops send them: A and
+// ANY get the AP address, other types an empty NOERROR, anything that is not
+// a plain standard query is refused or dropped, and nothing is ever written
+// past the buffer.
+#include <unity.h>
+#include <vector>
+#include "captive_portal.h"
+
+static const IPAddress AP_IP(192, 168, 4, 1);
+static const uint16_t TYPE_A = 1;
+static const uint16_t TYPE_AAAA = 28;
+static const uint16_t TYPE_HTTPS = 65;
+static const uint16_t TYPE_ANY = 255;
+static const uint16_t TYPE_OPT = 41;
+
+static void put16(std::vector<uint8_t>& packet, uint16_t value) {
+  packet.push_back(value >> 8);
+  packet.push_back(value & 0xFF);
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (p[0] << 8) | p[1];
+}
+
+// A recursive query for `name` with one question and optionally an EDNS
+// OPT record in the additional section
+static std::vector<uint8_t> query(const char* name, uint16_t type, bool edns = false) {
+  std::vector<uint8_t> packet;
+  put16(packet, 0xBEEF);      // id
+  put16(packet, 0x0100);      // RD
+  put16(packet, 1);           // questions
+  put16(packet, 0);
+  put16(packet, 0);
+  put16(packet, edns ? 1 : 0);
+  const char* label = name;
+  while (*label) {
+    const char* dot = strchr(label, '.');
+    size_t length = dot ? dot - label : strlen(label);
+    packet.push_back(length);
+    packet.insert(packet.end(), label, label + length);
+    label += length + (dot ? 1 : 0);
+  }
+  packet.push_back(0);
+  put16(packet, type);
+  put16(packet, 1);           // IN
+  if (edns) {
+    packet.push_back(0);      // root name
+    put16(packet, TYPE_OPT);
+    put16(packet, 1232);      // UDP payload size
+    put16(packet, 0);
+    put16(packet, 0);
+    put16(packet, 0);         // no options
+  }
+  return packet;
+}
+
+// Runs the query through buildDnsAnswer() in a full-size buffer
+static size_t answer(std::vector<uint8_t>& packet, size_t capacity = CAPTIVE_DNS_MAX_PACKET) {
+  size_t length = packet.size();
+  packet.resize(max(capacity, length));
+  size_t result = buildDnsAnswer(packet.data(), length, capacity, (uint32_t)AP_IP);
+  packet.resize(result);
+  return result;
+}
+
+static size_t questionEnd(const char* name) {
+  return 12 + strlen(name) + 2 + 4;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_a_query_gets_the_ap_address() {
+  const char* name = "connectivitycheck.gstatic.com";
+  std::vector<uint8_t> packet = query(name, TYPE_A);
+  std::vector<uint8_t> question(packet.begin() + 12, packet.end());
+  TEST_ASSERT_EQUAL(questionEnd(name) + 16, answer(packet));
+
+  const uint8_t* p = packet.data();
+  TEST_ASSERT_EQUAL_HEX16(0xBEEF, get16(p));
+  TEST_ASSERT_EQUAL_HEX8(0x85, p[2]); // QR, AA, RD kept
+  TEST_ASSERT_EQUAL_HEX8(0x80, p[3]); // RA, NOERROR
+  TEST_ASSERT_EQUAL(1, get16(p + 4));
+  TEST_ASSERT_EQUAL(1, get16(p + 6));
+  TEST_ASSERT_EQUAL(0, get16(p + 8));
+  TEST_ASSERT_EQUAL(0, get16(p + 10));
+  // The question is echoed unchanged
+  TEST_ASSERT_EQUAL_MEMORY(question.data(), p + 12, question.size());
+
+  const uint8_t* record = p + questionEnd(name);
+  TEST_ASSERT_EQUAL_HEX16(0xC00C, get16(record));
+  TEST_ASSERT_EQUAL(TYPE_A, get16(record + 2));
+  TEST_ASSERT_EQUAL(1, get16(record + 4));
+  TEST_ASSERT_EQUAL(CAPTIVE_DNS_TTL, (get16(record + 6) << 16) | get16(record + 8));
+  TEST_ASSERT_EQUAL(4, get16(record + 10));
+  const uint8_t expected[] = {192, 168, 4, 1};
+  TEST_ASSERT_EQUAL_MEMORY(expected, record + 12, 4);
+}
+
+void test_any_query_gets_the_ap_address() {
+  std::vector<uint8_t> packet = query("example.com", TYPE_ANY);
+  TEST_ASSERT_EQUAL(questionEnd("example.com") + 16, answer(packet));
+  TEST_ASSERT_EQUAL(1, get16(packet.data() + 6));
+}
+
+void test_other_types_get_no_records() {
+  for (uint16_t type : {TYPE_AAAA, TYPE_HTTPS}) {
+    std::vector<uint8_t> packet = query("captive.apple.com", type);
+    TEST_ASSERT_EQUAL(questionEnd("captive.apple.com"), answer(packet));
+    TEST_ASSERT_EQUAL_HEX8(0x80, packet[3]);
+    TEST_ASSERT_EQUAL(1, get16(packet.data() + 4));
+    TEST_ASSERT_EQUAL(0, get16(packet.data() + 6));
+  }
+}
+
+void test_edns_record_is_dropped() {
+  std::vector<uint8_t> packet = query("www.msftconnecttest.com", TYPE_A, true);
+  TEST_ASSERT_EQUAL(questionEnd("www.msftconnecttest.com") + 16, answer(packet));
+  TEST_ASSERT_EQUAL(1, get16(packet.data() + 6));
+  TEST_ASSERT_EQUAL(0, get16(packet.data() + 10));
+}
+
+void test_non_standard_queries_are_refused() {
+  // Opcode 2 (STATUS)
+  std::vector<uint8_t> status = query("example.com", TYPE_A);
+  status[2] |= 2 << 3;
+  TEST_ASSERT_EQUAL(12, answer(status));
+  TEST_ASSERT_EQUAL_HEX8(0x84, status[3]); // RA, NOTIMP
+  TEST_ASSERT_EQUAL(0, get16(status.data() + 4));
+
+  std::vector<uint8_t> twoQuestions = query("example.com", TYPE_A);
+  twoQuestions[5] = 2;
+  TEST_ASSERT_EQUAL(12, answer(twoQuestions));
+  TEST_ASSERT_EQUAL_HEX8(0x84, twoQuestions[3]);
+}
+
+void test_malformed_packets_are_dropped() {
+  std::vector<uint8_t> response = query("example.com", TYPE_A);
+  response[2] |= 0x80;
+  TEST_ASSERT_EQUAL(0, answer(response));
+
+  std::vector<uint8_t> shortHeader(11, 0);
+  TEST_ASSERT_EQUAL(0, answer(shortHeader));
+
+  std::vector<uint8_t> pointer = query("example.com", TYPE_A);
+  pointer[12] = 0xC0;
+  TEST_ASSERT_EQUAL(0, answer(pointer));
+
+  // Cut inside the name, then inside the type and class
+  std::vector<uint8_t> truncated = query("example.com", TYPE_A);
+  truncated.resize(16);
+  TEST_ASSERT_EQUAL(0, answer(truncated));
+  truncated = query("example.com", TYPE_A);
+  truncated.resize(truncated.size() - 2);
+  TEST_ASSERT_EQUAL(0, answer(truncated));
+
+  // A label that claims to run past the end of the packet
+  std::vector<uint8_t> overlong = query("example.com", TYPE_A);
+  overlong[12] = 63;
+  TEST_ASSERT_EQUAL(0, answer(overlong));
+}
+
+void test_answer_must_fit() {
+  std::vector<uint8_t> packet = query("example.com", TYPE_A);
+  size_t needed = questionEnd("example.com") + 16;
+  TEST_ASSERT_EQUAL(0, answer(packet, needed - 1));
+  packet = query("example.com", TYPE_A);
+  TEST_ASSERT_EQUAL(needed, answer(packet, needed));
+}
+
+// Random packets in a buffer with a guard area behind `capacity`
+void test_random_packets_stay_in_bounds() {
+  uint32_t seed = 12345;
+  static const size_t CAPACITY = 64;
+  uint8_t buffer[CAPACITY + 32];
+  for (int i = 0; i < 100000; i++) {
+    memset(buffer, 0xA5, sizeof(buffer));
+    seed = seed * 1103515245 + 12345;
+    size_t length = (seed >> 16) % (CAPACITY + 1);
+    for (size_t k = 0; k < length; k++) {
+      seed = seed * 1103515245 + 12345;
+      buffer[k] = seed >> 16;
+    }
+    // Mostly well-formed headers, so the question walk gets exercised
+    if (length >= 12 && (seed & 0x300)) {
+      buffer[2] &= 0x7F;
+      buffer[4] = 0;
+      buffer[5] = 1;
+    }
+    size_t result = buildDnsAnswer(buffer, length, CAPACITY, (uint32_t)AP_IP);
+    TEST_ASSERT_TRUE(result <= CAPACITY);
+    for (size_t k = CAPACITY; k < sizeof(buffer); k++) TEST_ASSERT_EQUAL_HEX8(0xA5, buffer[k]);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_a_query_gets_the_ap_address);
+  RUN_TEST(test_any_query_gets_the_ap_address);
+  RUN_TEST(test_other_types_get_no_records);
+  RUN_TEST(test_edns_record_is_dropped);
+  RUN_TEST(test_non_standard_queries_are_refused);
+  RUN_TEST(test_malformed_packets_are_dropped);
+  RUN_TEST(test_answer_must_fit);
+  RUN_TEST(test_random_packets_stay_in_bounds);
+  return UNITY_END();
+}
@@ -0,0 +1,124 @@
+// The fleet follower on real host sockets: repeated copies of a state packet
+// are applied once, and a leader that reboots (new session, sequence numbers
+// and clock starting over) is followed again straight away.
+#include <unity.h>
+#include <thread>
+#include <lwip/sockets.h>
+#include "native_stubs.h"
+#include "fleet_sync.h"
+
+static const uint32_t LEADER = 0x4C454144;
+
+static int sender = -1;
+
+static void sendPacket(FleetPacketType type, uint32_t session, uint32_t seq, uint32_t sentAt, uint8_t brightness = 0) {
+  FleetPacket packet;
+  memset(&packet, 0, sizeof(packet));
+  packet.magic[0] = 'G';
+  packet.magic[1] = 'F';
+  packet.version = 2;
+  packet.type = type;
+  packet.sender = LEADER;
+  packet.session = session;
+  packet.seq = seq;
+  packet.sentAt = sentAt;
+  packet.applyAt = sentAt + FLEET_APPLY_DELAY;
+  packet.group = FLEET_ALL_GROUPS;
+  packet.fields = STATE_BRIGHTNESS;
+  packet.brightness = brightness;
+
+  struct sockaddr_in target;
+  memset(&target, 0, sizeof(target));
+  target.sin_family = AF_INET;
+  target.sin_port = htons(FLEET_PORT);
+  target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sendto(sender, &packet, sizeof(packet), 0, (struct sockaddr*)&target, sizeof(target));
+}
+
+// Waits for the receiver task to count `packets` in total
+static void waitForPackets(uint32_t packets) {
+  for (int i = 0; i < 200 && fleetStats().packetsReceived < packets; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  TEST_ASSERT_EQUAL(packets, fleetStats().packetsReceived);
+}
+
+// Applies everything that is due after `ms`; returns how many updates
+static int applyAfter(uint32_t ms, uint8_t* lastBrightness = nullptr) {
+  advanceMillis(ms);
+  int applied = 0;
+  LedUpdate update;
+  while (takeFleetUpdate(update)) {
+    applied++;
+    if (lastBrightness) *lastBrightness = update.brightness;
+  }
+  return applied;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_packet_layout() {
+  TEST_ASSERT_EQUAL(34, sizeof(FleetPacket));
+}
+
+void test_repeats_are_applied_once() {
+  // Leader clock 5 s ahead of ours
+  uint32_t sentAt = millis() + 5000;
+  for (int i = 0; i < FLEET_REPEATS; i++) sendPacket(FleetPacketType::State, 1111, 1, sentAt, 10);
+  waitForPackets(FLEET_REPEATS);
+  FleetStats stats = fleetStats();
+  TEST_ASSERT_EQUAL(LEADER, stats.leader);
+  TEST_ASSERT_EQUAL(FLEET_REPEATS - 1, stats.duplicates);
+  TEST_ASSERT_EQUAL(-5000, stats.offset);
+
+  TEST_ASSERT_EQUAL(0, applyAfter(FLEET_APPLY_DELAY - 1));
+  uint8_t brightness = 0;
+  TEST_ASSERT_EQUAL(1, applyAfter(1, &brightness));
+  TEST_ASSERT_EQUAL(10, brightness);
+
+  sendPacket(FleetPacketType::State, 1111, 2, millis() + 5000, 20);
+  waitForPackets(FLEET_REPEATS + 1);
+  TEST_ASSERT_EQUAL(1, applyAfter(FLEET_APPLY_DELAY, &brightness));
+  TEST_ASSERT_EQUAL(20, brightness);
+}
+
+void test_rebooted_leader_is_followed() {
+  uint32_t received = fleetStats().packetsReceived;
+  uint32_t duplicates = fleetStats().duplicates;
+  // Back up after a reboot: sequence numbers from 1, its clock near zero
+  sendPacket(FleetPacketType::Beacon, 2222, 0, 300);
+  sendPacket(FleetPacketType::State, 2222, 1, 310, 30);
+  waitForPackets(received + 2);
+
+  FleetStats stats = fleetStats();
+  TEST_ASSERT_EQUAL(duplicates, stats.duplicates);
+  // Only samples from the new session count
+  TEST_ASSERT_EQUAL((int32_t)(millis() - 310), stats.offset);
+  uint8_t brightness = 0;
+  TEST_ASSERT_EQUAL(1, applyAfter(FLEET_APPLY_DELAY, &brightness));
+  TEST_ASSERT_EQUAL(30, brightness);
+}
+
+void test_old_session_copies_still_dropped() {
+  uint32_t received = fleetStats().packetsReceived;
+  uint32_t duplicates = fleetStats().duplicates;
+  sendPacket(FleetPacketType::State, 2222, 1, 320, 40);
+  waitForPackets(received + 1);
+  TEST_ASSERT_EQUAL(duplicates + 1, fleetStats().duplicates);
+  TEST_ASSERT_EQUAL(0, applyAfter(FLEET_APPLY_DELAY));
+}
+
+int main(int argc, char** argv) {
+  setMillis(100000);
+  nvsReset();
+  beginFleetSync(0);
+  setFleetConfig(FleetRole::Follower, 1);
+  sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  UNITY_BEGIN();
+  RUN_TEST(test_packet_layout);
+  RUN_TEST(test_repeats_are_applied_once);
+  RUN_TEST(test_rebooted_leader_is_followed);
+  RUN_TEST(test_old_session_copies_still_dropped);
+  return UNITY_END();
+}
@@ -0,0 +1,246 @@
+// jsonParse() and parseStateUpdates() on mutated request bodies, then their
+// speed on the bodies the web UI and integrations send.
+//
+// The fuzz pass flips, inserts, deletes and splices bytes of the seed
+// documents with a fixed-seed generator and checks that every result is
+// either an error code or a token array that is consistent with the input.
+// Each input is copied into a buffer of exactly its length, so a read past
+// the end shows up under -fsanitize=address. JSON_FUZZ_ITERATIONS raises
+// the count for longer runs.
+//
+//   pio test -e native -f test_json_parser
+#include <unity.h>
+#include <vector>
+#include "native_stubs.h"
+#include "http_server.h"
+#include "json_parser.h"
+#include "state_api.h"
+#include "../bench_report.h"
+
+#ifndef JSON_FUZZ_ITERATIONS
+#define JSON_FUZZ_ITERATIONS 200000
+#endif
+
+static const int BENCH_ITERATIONS = 20000;
+
+static const char* const SEEDS[] = {
+  "{\"on\":true,\"color\":\"#ff8800\",\"brightness\":128,\"effect\":\"breathe\",\"period\":3000}",
+  "{\"color\":\"teal\"}",
+  "{\"color\":[255,0,64]}",
+  "{\"color\":{\"h\":200,\"s\":100,\"v\":80}}",
+  "{\"color\":{\"r\":1,\"g\":2,\"b\":3},\"on\":false}",
+  "{\"wifi\":{\"ssid\":\"My\\\"Net\\u0041\",\"password\":\"secret\\n\"}}",
+  "[{\"on\":true},{\"brightness\":10},{\"effect\":\"rainbow\",\"period\":500}]",
+  "[]",
+  "{}",
+  "[[[[1,2],[3]],{\"a\":[null,false,-12]}]]",
+};
+
+struct BenchBody {
+  const char* name;
+  const char* json;
+};
+
+static const BenchBody BODIES[] = {
+  {"toggle", "{\"on\":false}"},
+  {"full state", "{\"on\":true,\"color\":\"#ff8800\",\"brightness\":128,\"effect\":\"breathe\",\"period\":3000}"},
+  {"hsv colour", "{\"color\":{\"h\":200,\"s\":100,\"v\":80},\"brightness\":255}"},
+  {"colour name", "{\"color\":\"warmwhite\"}"},
+  {"wifi", "{\"wifi\":{\"ssid\":\"Living room 5G\",\"password\":\"correct horse battery staple\"}}"},
+  {"8 updates",
+   "[{\"on\":true},{\"color\":[255,0,0]},{\"brightness\":200},{\"effect\":\"blink\",\"period\":250},"
+   "{\"color\":\"#00ff00\"},{\"brightness\":100},{\"effect\":\"solid\"},{\"on\":false}]"},
+};
+
+// xorshift32, so every run mutates the same way
+static uint32_t rngState = 0x9E3779B9;
+static uint32_t nextRandom() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static const char INTERESTING[] = "{}[]\",:\\ -0123456789eEtrufalsn\x01\x7f\xff";
+
+static void mutate(std::vector<char>& data) {
+  int edits = 1 + nextRandom() % 4;
+  for (int e = 0; e < edits; e++) {
+    size_t pos = data.empty() ? 0 : nextRandom() % (data.size() + 1);
+    switch (nextRandom() % 5) {
+      case 0: // overwrite
+        if (pos < data.size()) data[pos] = INTERESTING[nextRandom() % (sizeof(INTERESTING) - 1)];
+        break;
+      case 1: // insert
+        data.insert(data.begin() + pos, INTERESTING[nextRandom() % (sizeof(INTERESTING) - 1)]);
+        break;
+      case 2: // delete a run
+        if (pos < data.size()) data.erase(data.begin() + pos, data.begin() + min(data.size(), pos + 1 + nextRandom() % 8));
+        break;
+      case 3: { // splice in part of another seed
+        const char* other = SEEDS[nextRandom() % (sizeof(SEEDS) / sizeof(SEEDS[0]))];
+        size_t length = strlen(other);
+        size_t from = nextRandom() % length;
+        size_t count = 1 + nextRandom() % (length - from);
+        data.insert(data.begin() + pos, other + from, other + from + count);
+        break;
+      }
+      default: // truncate
+        data.resize(pos);
+        break;
+    }
+  }
+}
+
+// Checks a jsonParse() result against its input; returns a reason or nullptr
+static const char* checkTokens(const char* json, size_t length, const JsonToken* tokens, int count, uint16_t maxTokens) {
+  if (count < JSON_ERROR_PARTIAL || count > maxTokens) return "result out of range";
+  if (count <= 0) return nullptr;
+  if (tokens[0].parent != -1) return "first token has a parent";
+  for (int i = 0; i < count; i++) {
+    const JsonToken& token = tokens[i];
+    if (token.start > token.end || token.end > length) return "token outside the input";
+    if (token.parent < -1 || token.parent >= i) return "parent does not precede its child";
+    uint16_t children = 0;
+    for (int k = i + 1; k < count; k++) children += tokens[k].parent == i;
+    if (children != token.size) return "size does not match the children";
+    switch (token.type) {
+      case JsonType::Object:
+      case JsonType::Array:
+        if (token.end - token.start < 2) return "container shorter than its brackets";
+        if (json[token.start] != (token.type == JsonType::Object ? '{' : '[')) return "container does not start with a bracket";
+        if (json[token.end - 1] != (token.type == JsonType::Object ? '}' : ']')) return "container does not end with a bracket";
+        break;
+      case JsonType::String:
+        if (token.start == 0 || json[token.start - 1] != '"' || token.end >= length || json[token.end] != '"') {
+          return "string not between quotes";
+        }
+        break;
+      case JsonType::Primitive:
+        if (token.start == token.end) return "empty primitive";
+        break;
+    }
+    int next = jsonSkip(tokens, count, i);
+    if (next <= i || next > count) return "jsonSkip out of range";
+  }
+  return nullptr;
+}
+
+// Runs everything that reads a parsed body over it, with canaries around
+// the string output
+static void exercise(const char* json, size_t length, const JsonToken* tokens, int count) {
+  for (int i = 0; i < count; i++) {
+    char out[12];
+    out[sizeof(out) - 1] = 0x5A;
+    jsonToString(json, tokens[i], out, sizeof(out) - 1);
+    TEST_ASSERT_EQUAL_HEX8(0x5A, out[sizeof(out) - 1]);
+    long number;
+    bool flag;
+    jsonToLong(json, tokens[i], number);
+    jsonToBool(json, tokens[i], flag);
+    jsonObjectGet(json, tokens, count, i, "color");
+  }
+
+  StateUpdate updates[MAX_STATE_UPDATES];
+  const char* error = nullptr;
+  int parsed = parseStateUpdates(json, length, updates, MAX_STATE_UPDATES, error);
+  TEST_ASSERT_TRUE(parsed >= -1 && parsed <= MAX_STATE_UPDATES);
+  if (parsed < 0) TEST_ASSERT_NOT_NULL(error);
+  for (int i = 0; i < parsed; i++) {
+    TEST_ASSERT_TRUE(memchr(updates[i].ssid, '\0', sizeof(updates[i].ssid)) != nullptr);
+    TEST_ASSERT_TRUE(memchr(updates[i].password, '\0', sizeof(updates[i].password)) != nullptr);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_seeds_parse() {
+  JsonToken tokens[MAX_STATE_TOKENS];
+  for (const char* seed : SEEDS) {
+    int count = jsonParse(seed, strlen(seed), tokens, MAX_STATE_TOKENS);
+    TEST_ASSERT_TRUE_MESSAGE(count > 0, seed);
+    TEST_ASSERT_NULL_MESSAGE(checkTokens(seed, strlen(seed), tokens, count, MAX_STATE_TOKENS), seed);
+  }
+}
+
+void test_rejects() {
+  static const char* const INVALID[] = {"{\"a\"}", "{\"a\":}", "[1,]", "{,}", "[1 2]", "{\"a\":1,}", "1 2", "{1:2}", "]", "x"};
+  static const char* const PARTIAL[] = {"{", "[1,2", "{\"a\":\"b", "\"\\", "{\"a\":[{}"};
+  JsonToken tokens[16];
+  for (const char* text : INVALID) TEST_ASSERT_EQUAL_MESSAGE(JSON_ERROR_INVALID, jsonParse(text, strlen(text), tokens, 16), text);
+  for (const char* text : PARTIAL) TEST_ASSERT_EQUAL_MESSAGE(JSON_ERROR_PARTIAL, jsonParse(text, strlen(text), tokens, 16), text);
+  TEST_ASSERT_EQUAL(JSON_ERROR_NO_TOKENS, jsonParse("[1,2,3]", 7, tokens, 3));
+}
+
+void test_fuzz() {
+  uint32_t valid = 0;
+  for (uint32_t i = 0; i < JSON_FUZZ_ITERATIONS; i++) {
+    const char* seed = SEEDS[nextRandom() % (sizeof(SEEDS) / sizeof(SEEDS[0]))];
+    std::vector<char> data(seed, seed + strlen(seed));
+    mutate(data);
+    // Exactly sized and not NUL-terminated, like a body cut off mid-buffer
+    size_t length = min(data.size(), (size_t)HTTP_MAX_BODY);
+    char* json = new char[length ? length : 1];
+    memcpy(json, data.data(), length);
+
+    // Token arrays smaller than the document as well as the real one
+    uint16_t maxTokens = nextRandom() % 2 ? MAX_STATE_TOKENS : 1 + nextRandom() % 8;
+    JsonToken tokens[MAX_STATE_TOKENS];
+    int count = jsonParse(json, length, tokens, maxTokens);
+    const char* problem = checkTokens(json, length, tokens, count, maxTokens);
+    if (problem) {
+      printf("input #%u: %.*s\n", i, (int)length, json);
+      TEST_FAIL_MESSAGE(problem);
+    }
+    if (count > 0) valid++;
+    exercise(json, length, tokens, count > 0 ? count : 0);
+    delete[] json;
+  }
+  printf("%u mutated inputs, %u of them valid JSON\n", JSON_FUZZ_ITERATIONS, valid);
+  TEST_ASSERT_TRUE(valid > 0);
+}
+
+void test_bench() {
+  BenchReport report("json");
+  for (const BenchBody& body : BODIES) {
+    size_t length = strlen(body.json);
+    JsonToken tokens[MAX_STATE_TOKENS];
+    int count = jsonParse(body.json, length, tokens, MAX_STATE_TOKENS);
+    TEST_ASSERT_TRUE_MESSAGE(count > 0, body.name);
+    StateUpdate updates[MAX_STATE_UPDATES];
+    const char* error = "";
+    int parsed = parseStateUpdates(body.json, length, updates, MAX_STATE_UPDATES, error);
+    TEST_ASSERT_TRUE_MESSAGE(parsed > 0, error);
+
+    uint64_t start = wallNanos();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) jsonParse(body.json, length, tokens, MAX_STATE_TOKENS);
+    uint64_t tokenizeNanos = wallNanos() - start;
+
+    HeapUsage heapBefore = heapUsage();
+    start = wallNanos();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) parseStateUpdates(body.json, length, updates, MAX_STATE_UPDATES, error);
+    uint64_t parseNanos = wallNanos() - start;
+    HeapUsage heapAfter = heapUsage();
+    TEST_ASSERT_EQUAL_MESSAGE(0, heapAfter.allocations - heapBefore.allocations, body.name);
+
+    report.add(BenchRow()
+                   .add("body", body.name)
+                   .add("bytes", (uint64_t)length)
+                   .add("tokens", count)
+                   .add("updates", parsed)
+                   .add("tokenize_us", tokenizeNanos / 1000.0 / BENCH_ITERATIONS)
+                   .add("parse_us", parseNanos / 1000.0 / BENCH_ITERATIONS)
+                   .add("mb_per_s", (double)length * BENCH_ITERATIONS * 1000.0 / parseNanos));
+  }
+  TEST_ASSERT_TRUE(report.write());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_seeds_parse);
+  RUN_TEST(test_rejects);
+  RUN_TEST(test_fuzz);
+  RUN_TEST(test_bench);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// led_store against the in-memory NVS: bursts of updates coalesce into one
+// write after the quiet period, unchanged values are never written, and
+// settings from older firmware are migrated. The store keeps its state in
+// statics, so the tests build on each other and run in this order.
+#include <unity.h>
+#include <Preferences.h>
+#include "native_stubs.h"
+#include "led_store.h"
+
+static LedSettings settings(bool on, uint8_t brightness, uint32_t color) {
+  LedSettings result;
+  result.on = on;
+  result.brightness = brightness;
+  result.r = color >> 16;
+  result.g = color >> 8;
+  result.b = color;
+  return result;
+}
+
+// Polls every 10 ms of mock time for `ms`, as the control loop would
+static void runFor(unsigned long ms) {
+  for (unsigned long t = 0; t < ms; t += 10) {
+    advanceMillis(10);
+    pollLedStore();
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_migrates_per_field_keys() {
+  Preferences old;
+  old.begin("led", false);
+  old.putBool("state", true);
+  old.putUChar("brightness", 42);
+  old.putULong("color", 0x123456);
+  old.end();
+
+  LedSettings loaded = settings(false, 0, 0);
+  TEST_ASSERT_TRUE(loadLedSettings(loaded));
+  TEST_ASSERT_TRUE(loaded.on);
+  TEST_ASSERT_EQUAL(42, loaded.brightness);
+  TEST_ASSERT_EQUAL_HEX8(0x12, loaded.r);
+  TEST_ASSERT_EQUAL_HEX8(0x34, loaded.g);
+  TEST_ASSERT_EQUAL_HEX8(0x56, loaded.b);
+
+  // The first write replaces the old keys with the blob
+  updateLedSettings(loaded);
+  flushLedStore();
+  Preferences check;
+  check.begin("led", true);
+  TEST_ASSERT_FALSE(check.isKey("state"));
+  TEST_ASSERT_FALSE(check.isKey("brightness"));
+  TEST_ASSERT_FALSE(check.isKey("color"));
+  TEST_ASSERT_TRUE(check.isKey("settings"));
+  check.end();
+}
+
+void test_burst_is_written_once_after_quiet_period() {
+  uint32_t writes = nvsWrites();
+  // A colour picker dragged for two seconds
+  for (int i = 0; i < 200; i++) {
+    updateLedSettings(settings(true, 100, 0x010000 * i));
+    runFor(10);
+  }
+  TEST_ASSERT_EQUAL(writes, nvsWrites());
+
+  runFor(LED_SAVE_QUIET_PERIOD - 20);
+  TEST_ASSERT_EQUAL(writes, nvsWrites());
+  runFor(20);
+  TEST_ASSERT_EQUAL(writes + 1, nvsWrites());
+
+  LedSettings loaded = settings(false, 0, 0);
+  TEST_ASSERT_TRUE(loadLedSettings(loaded));
+  TEST_ASSERT_EQUAL_HEX8(199, loaded.r);
+}
+
+void test_each_update_restarts_the_quiet_period() {
+  uint32_t writes = nvsWrites();
+  updateLedSettings(settings(true, 10, 0));
+  runFor(LED_SAVE_QUIET_PERIOD - 500);
+  updateLedSettings(settings(true, 20, 0));
+  runFor(LED_SAVE_QUIET_PERIOD - 500);
+  TEST_ASSERT_EQUAL(writes, nvsWrites());
+  runFor(500);
+  TEST_ASSERT_EQUAL(writes + 1, nvsWrites());
+}
+
+void test_unchanged_value_is_not_written() {
+  uint32_t writes = nvsWrites();
+  // Changed and changed back before the quiet period ran out
+  updateLedSettings(settings(false, 20, 0));
+  runFor(100);
+  updateLedSettings(settings(true, 20, 0));
+  runFor(LED_SAVE_QUIET_PERIOD * 2);
+  TEST_ASSERT_EQUAL(writes, nvsWrites());
+}
+
+void test_flush_writes_at_once_and_only_when_dirty() {
+  uint32_t writes = nvsWrites();
+  flushLedStore();
+  TEST_ASSERT_EQUAL(writes, nvsWrites());
+  updateLedSettings(settings(true, 30, 0xFFFFFF));
+  flushLedStore();
+  TEST_ASSERT_EQUAL(writes + 1, nvsWrites());
+  runFor(LED_SAVE_QUIET_PERIOD * 2);
+  TEST_ASSERT_EQUAL(writes + 1, nvsWrites());
+}
+
+void test_stats() {
+  LedStoreStats stats = ledStoreStats();
+  // 1 migration + 200 burst + 2 + 2 + 1 updates, 4 of them written
+  TEST_ASSERT_EQUAL(206, stats.updates);
+  TEST_ASSERT_EQUAL(4, stats.writesPerformed);
+  TEST_ASSERT_EQUAL(202, stats.writesAvoided);
+}
+
+void test_strip_config_round_trip() {
+  StripConfig config;
+  memset(&config, 0, sizeof(config));
+  TEST_ASSERT_FALSE(loadStripConfig(config));
+  config.pixelCount = 300;
+  config.segmentCount = 1;
+  config.segments[0].start = 0;
+  config.segments[0].length = 300;
+  saveStripConfig(config);
+
+  StripConfig loaded;
+  memset(&loaded, 0, sizeof(loaded));
+  TEST_ASSERT_TRUE(loadStripConfig(loaded));
+  TEST_ASSERT_EQUAL(300, loaded.pixelCount);
+  TEST_ASSERT_EQUAL(1, loaded.segmentCount);
+  TEST_ASSERT_EQUAL(300, loaded.segments[0].length);
+}
+
+int main(int argc, char** argv) {
+  nvsReset();
+  UNITY_BEGIN();
+  RUN_TEST(test_migrates_per_field_keys);
+  RUN_TEST(test_burst_is_written_once_after_quiet_period);
+  RUN_TEST(test_each_update_restarts_the_quiet_period);
+  RUN_TEST(test_unchanged_value_is_not_written);
+  RUN_TEST(test_flush_writes_at_once_and_only_when_dirty);
+  RUN_TEST(test_stats);
+  RUN_TEST(test_strip_config_round_trip);
+  return UNITY_END();
+}
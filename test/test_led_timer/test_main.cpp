@@ -0,0 +1,231 @@
+// The timer scheduler on a simulated clock: recurring and one-shot rules
+// fire when due and only once, a late loop() pass does not replay missed
+// occurrences, and setting the clock either way reschedules from the new
+// time. The wall clock and millis() advance together unless a test jumps
+// one of them. At the MAX_TIMER_RULES cap a pass costs what it does with
+// one rule; the timings go to bench_timer.json.
+#include <unity.h>
+#include <stdlib.h>
+#include "native_stubs.h"
+#include "led_timer.h"
+#include "../bench_report.h"
+
+static const time_t MONDAY = 1736121600; // 2025-01-06 00:00 UTC
+static const time_t HOUR = 3600;
+static const time_t DAY = 24 * HOUR;
+
+static time_t wallClock = MONDAY;
+static time_t simulatedClock() {
+  return wallClock;
+}
+
+static uint32_t fired = 0;
+static LedUpdate lastUpdate;
+static void recordUpdate(const LedUpdate& update) {
+  fired++;
+  lastUpdate = update;
+}
+
+// Moves both clocks, servicing the timer every `step` seconds like loop()
+static void runFor(time_t seconds, time_t step = 60) {
+  for (time_t t = 0; t < seconds; t += step) {
+    wallClock += step;
+    advanceMillis(step * 1000);
+    serviceLedTimer();
+  }
+}
+
+static TimerRule daily(uint16_t minute, TimerAction action, uint8_t days = TIMER_DAYS_ALL) {
+  TimerRule rule;
+  memset(&rule, 0, sizeof(rule));
+  rule.minute = minute;
+  rule.days = days;
+  rule.action = action;
+  return rule;
+}
+
+static TimerRule once(time_t at, TimerAction action) {
+  TimerRule rule;
+  memset(&rule, 0, sizeof(rule));
+  rule.at = at;
+  rule.action = action;
+  return rule;
+}
+
+void setUp() {
+  nvsReset();
+  wallClock = MONDAY;
+  setMillis(1000);
+  fired = 0;
+  beginLedTimer(recordUpdate);
+  serviceLedTimer();
+}
+
+void tearDown() {}
+
+void test_next_fire_time() {
+  TEST_ASSERT_EQUAL(MONDAY + 7 * HOUR + 30 * 60, nextFireTime(daily(7 * 60 + 30, TimerAction::On), MONDAY));
+  // Saturday noon: weekdays only comes round on Monday
+  TEST_ASSERT_EQUAL(MONDAY + 7 * DAY + 7 * HOUR,
+                    nextFireTime(daily(7 * 60, TimerAction::On, TIMER_DAYS_WEEKDAYS), MONDAY + 5 * DAY + 12 * HOUR));
+  TEST_ASSERT_EQUAL(0, nextFireTime(daily(7 * 60, TimerAction::On, 0), MONDAY));
+  TEST_ASSERT_EQUAL(MONDAY + 60, nextFireTime(once(MONDAY + 60, TimerAction::Off), MONDAY));
+  TEST_ASSERT_EQUAL(0, nextFireTime(once(MONDAY + 60, TimerAction::Off), MONDAY + 60));
+}
+
+void test_recurring_fires_once_a_day() {
+  TEST_ASSERT_NOT_EQUAL(0, addTimerRule(daily(7 * 60 + 30, TimerAction::Off)));
+  runFor(7 * HOUR + 29 * 60);
+  TEST_ASSERT_EQUAL(0, fired);
+  runFor(60);
+  TEST_ASSERT_EQUAL(1, fired);
+  TEST_ASSERT_EQUAL(STATE_ON, lastUpdate.fields);
+  TEST_ASSERT_FALSE(lastUpdate.on);
+  runFor(3 * DAY);
+  TEST_ASSERT_EQUAL(4, fired);
+  TEST_ASSERT_EQUAL(1, timerRuleCount());
+}
+
+void test_late_pass_does_not_replay_missed_occurrences() {
+  addTimerRule(daily(7 * 60, TimerAction::On));
+  serviceLedTimer();
+  // loop() held up for three days, both clocks agree
+  runFor(3 * DAY + 8 * HOUR, 3 * DAY + 8 * HOUR);
+  TEST_ASSERT_EQUAL(1, fired);
+  runFor(DAY);
+  TEST_ASSERT_EQUAL(2, fired);
+}
+
+void test_one_shot_fires_and_is_deleted() {
+  TimerRule rule = once(MONDAY + 10 * 60, TimerAction::Color);
+  rule.color = 0x00FF80;
+  addTimerRule(rule);
+  addTimerRule(daily(23 * 60, TimerAction::Off));
+  runFor(9 * 60);
+  TEST_ASSERT_EQUAL(0, fired);
+  runFor(60);
+  TEST_ASSERT_EQUAL(1, fired);
+  TEST_ASSERT_EQUAL(STATE_COLOR, lastUpdate.fields);
+  TEST_ASSERT_EQUAL_HEX32(0x00FF80, lastUpdate.color);
+  TEST_ASSERT_EQUAL(1, timerRuleCount());
+  TEST_ASSERT_EQUAL(0, timerRule(0).at);
+
+  // Gone from NVS too
+  beginLedTimer(recordUpdate);
+  TEST_ASSERT_EQUAL(1, timerRuleCount());
+}
+
+void test_one_shot_missed_while_off_is_deleted() {
+  addTimerRule(once(MONDAY + HOUR, TimerAction::On));
+  addTimerRule(daily(12 * 60, TimerAction::Off));
+  // Powered off over the one-shot's time, back with the clock already set
+  wallClock += 2 * HOUR;
+  setMillis(1000);
+  beginLedTimer(recordUpdate);
+  serviceLedTimer();
+  TEST_ASSERT_EQUAL(0, fired);
+  TEST_ASSERT_EQUAL(1, timerRuleCount());
+  TEST_ASSERT_EQUAL(0, timerRule(0).at);
+  beginLedTimer(recordUpdate);
+  TEST_ASSERT_EQUAL(1, timerRuleCount());
+}
+
+void test_clock_set_back_reschedules() {
+  addTimerRule(daily(7 * 60 + 30, TimerAction::On));
+  runFor(DAY + 7 * HOUR); // Tuesday 07:00, next firing 07:30
+  TEST_ASSERT_EQUAL(1, fired);
+  // The clock was a day ahead and NTP corrects it: Monday 07:00
+  wallClock -= DAY;
+  serviceLedTimer();
+  runFor(30 * 60);
+  TEST_ASSERT_EQUAL(2, fired);
+}
+
+void test_clock_set_forward_skips_the_gap() {
+  addTimerRule(daily(2 * 60, TimerAction::On));
+  addTimerRule(once(MONDAY + 3 * HOUR, TimerAction::Off));
+  runFor(HOUR);
+  // Jumps to 05:00, past both rules
+  wallClock += 4 * HOUR;
+  serviceLedTimer();
+  TEST_ASSERT_EQUAL(0, fired);
+  TEST_ASSERT_EQUAL(1, timerRuleCount());
+  runFor(DAY);
+  TEST_ASSERT_EQUAL(1, fired);
+}
+
+void test_small_drift_is_not_a_jump() {
+  addTimerRule(daily(60, TimerAction::On));
+  runFor(59 * 60);
+  // NTP nudging the clock by a couple of seconds
+  wallClock += 2;
+  serviceLedTimer();
+  runFor(60);
+  TEST_ASSERT_EQUAL(1, fired);
+}
+
+void test_table_full() {
+  for (uint8_t i = 0; i < MAX_TIMER_RULES; i++) {
+    TEST_ASSERT_EQUAL(i + 1, addTimerRule(daily(i * 10, TimerAction::On)));
+  }
+  TEST_ASSERT_EQUAL(0, addTimerRule(daily(0, TimerAction::Off)));
+  runFor(DAY);
+  TEST_ASSERT_EQUAL(MAX_TIMER_RULES, fired);
+}
+
+// Average ns per serviceLedTimer() pass with `count` rules, none of them due
+static double idlePassNanos(uint8_t count) {
+  setUp();
+  for (uint8_t i = 0; i < count; i++) addTimerRule(daily(12 * 60 + i, TimerAction::On));
+  serviceLedTimer();
+  static const int PASSES = 200000;
+  double best = 0;
+  // Best of three, to keep scheduler noise out of the comparison
+  for (int round = 0; round < 3; round++) {
+    uint64_t start = wallNanos();
+    for (int i = 0; i < PASSES; i++) serviceLedTimer();
+    double nanos = (double)(wallNanos() - start) / PASSES;
+    if (round == 0 || nanos < best) best = nanos;
+  }
+  TEST_ASSERT_EQUAL(0, fired);
+  return best;
+}
+
+void test_pass_cost_is_flat_at_the_cap() {
+  double one = idlePassNanos(1);
+  double full = idlePassNanos(MAX_TIMER_RULES);
+
+  // A day of passes a minute apart with every rule firing once
+  uint64_t start = wallNanos();
+  runFor(DAY);
+  double firingDay = (double)(wallNanos() - start);
+  TEST_ASSERT_EQUAL(MAX_TIMER_RULES, fired);
+
+  BenchReport report("timer");
+  report.add(BenchRow().add("rules", 1).add("idle_pass_ns", one));
+  report.add(BenchRow()
+                 .add("rules", MAX_TIMER_RULES)
+                 .add("idle_pass_ns", full)
+                 .add("day_of_passes_us", firingDay / 1000.0));
+  TEST_ASSERT_TRUE(report.write());
+  // O(1) when nothing is due: only the top of the heap is looked at
+  TEST_ASSERT_TRUE(full < one * 2 + 20);
+}
+
+int main(int argc, char** argv) {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  setTimerClock(simulatedClock);
+  UNITY_BEGIN();
+  RUN_TEST(test_next_fire_time);
+  RUN_TEST(test_recurring_fires_once_a_day);
+  RUN_TEST(test_late_pass_does_not_replay_missed_occurrences);
+  RUN_TEST(test_one_shot_fires_and_is_deleted);
+  RUN_TEST(test_one_shot_missed_while_off_is_deleted);
+  RUN_TEST(test_clock_set_back_reschedules);
+  RUN_TEST(test_clock_set_forward_skips_the_gap);
+  RUN_TEST(test_small_drift_is_not_a_jump);
+  RUN_TEST(test_table_full);
+  RUN_TEST(test_pass_cost_is_flat_at_the_cap);
+  return UNITY_END();
+}
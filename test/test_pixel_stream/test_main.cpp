@@ -0,0 +1,170 @@
+// The E1.31 receiver on real host sockets: frames end on the sender's sync
+// packet, or on the strip's last universe while no sync packets arrive,
+// and with the station up the sync universe's multicast group is joined
+// along with the data universes'.
+#include <unity.h>
+#include <thread>
+#include <lwip/sockets.h>
+#include <WiFi.h>
+#include "native_stubs.h"
+#include "led_output.h"
+#include "led_effects.h"
+#include "pixel_stream.h"
+
+static const uint16_t PIXELS = 2 * PIXEL_STREAM_UNIVERSE_PIXELS; // two universes
+static const uint16_t SYNC_UNIVERSE = 100;
+
+static int sender = -1;
+static uint8_t sequences[256];
+
+static void sendTo(const uint8_t* packet, size_t length, uint32_t address) {
+  struct sockaddr_in target;
+  memset(&target, 0, sizeof(target));
+  target.sin_family = AF_INET;
+  target.sin_port = htons(PIXEL_STREAM_E131_PORT);
+  target.sin_addr.s_addr = htonl(address);
+  sendto(sender, packet, length, 0, (struct sockaddr*)&target, sizeof(target));
+}
+
+static void put16(uint8_t* p, uint16_t value) {
+  p[0] = value >> 8;
+  p[1] = value & 0xFF;
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+  put16(p, value >> 16);
+  put16(p + 2, value & 0xFFFF);
+}
+
+static void root(uint8_t* packet, uint32_t vector) {
+  static const uint8_t ACN_ID[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+  put16(packet, 0x0010);
+  memcpy(packet + 4, ACN_ID, sizeof(ACN_ID));
+  put32(packet + 18, vector);
+}
+
+// A full universe of `value` bytes, announcing `sync`
+static void sendData(uint16_t universe, uint16_t sync, uint8_t value, uint32_t address = INADDR_LOOPBACK) {
+  uint8_t packet[126 + 510];
+  memset(packet, 0, sizeof(packet));
+  root(packet, 0x00000004);
+  put32(packet + 40, 0x00000002);
+  put16(packet + 109, sync);
+  packet[111] = ++sequences[universe & 0xFF];
+  put16(packet + 113, universe);
+  packet[117] = 0x02;
+  put16(packet + 123, 511);
+  memset(packet + 126, value, 510);
+  sendTo(packet, sizeof(packet), address);
+}
+
+static void sendSync(uint16_t universe, uint32_t address = INADDR_LOOPBACK) {
+  uint8_t packet[49];
+  memset(packet, 0, sizeof(packet));
+  root(packet, 0x00000008);
+  put32(packet + 40, 0x00000001);
+  put16(packet + 45, universe);
+  sendTo(packet, sizeof(packet), address);
+}
+
+static uint32_t multicastAddress(uint16_t universe) {
+  return 0xEFFF0000 | universe;
+}
+
+// Lets the receiver task take the packets, then runs the control loop's part
+static void settle() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  servicePixelStream(255);
+  while (!ledOutputReady()) std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_sync_ends_the_frame() {
+  // The first packet only asks for the strip. It is dropped, and being the
+  // last universe it also ends (and skips) its frame.
+  sendData(2, SYNC_UNIVERSE, 0x10);
+  settle();
+  TEST_ASSERT_TRUE(pixelStreamStats().active);
+
+  // Until a sync packet has arrived, the last universe ends the frame
+  sendData(1, SYNC_UNIVERSE, 0x20);
+  sendData(2, SYNC_UNIVERSE, 0x20);
+  settle();
+  TEST_ASSERT_EQUAL(1, pixelStreamStats().frames);
+  sendSync(SYNC_UNIVERSE);
+  settle();
+  TEST_ASSERT_EQUAL(1, pixelStreamStats().frames);
+
+  // From then on the frame waits for the sync packet
+  sendData(1, SYNC_UNIVERSE, 0x30);
+  sendData(2, SYNC_UNIVERSE, 0x30);
+  settle();
+  TEST_ASSERT_EQUAL(1, pixelStreamStats().frames);
+  sendSync(SYNC_UNIVERSE);
+  settle();
+  TEST_ASSERT_EQUAL(2, pixelStreamStats().frames);
+
+  // A sync packet for another universe does not count
+  sendData(1, SYNC_UNIVERSE, 0x40);
+  sendData(2, SYNC_UNIVERSE, 0x40);
+  sendSync(SYNC_UNIVERSE + 1);
+  settle();
+  TEST_ASSERT_EQUAL(2, pixelStreamStats().frames);
+  sendSync(SYNC_UNIVERSE);
+  settle();
+  TEST_ASSERT_EQUAL(3, pixelStreamStats().frames);
+}
+
+void test_falls_back_when_sync_stops() {
+  uint32_t frames = pixelStreamStats().frames;
+  advanceMillis(1100);
+  sendData(1, SYNC_UNIVERSE, 0x50);
+  sendData(2, SYNC_UNIVERSE, 0x50);
+  settle();
+  TEST_ASSERT_EQUAL(frames + 1, pixelStreamStats().frames);
+}
+
+// Needs multicast on the loopback interface; skipped where the host has none
+void test_multicast_sync_universe_is_joined() {
+  uint32_t frames = pixelStreamStats().frames;
+  WiFi.stationStatus = WL_CONNECTED;
+  WiFi.stationIp = IPAddress(127, 0, 0, 1);
+  // Joins the groups for the announced sync universe too
+  servicePixelStream(255);
+
+  struct in_addr loopback;
+  loopback.s_addr = htonl(INADDR_LOOPBACK);
+  unsigned char loop = 1;
+  if (setsockopt(sender, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback)) != 0 ||
+      setsockopt(sender, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0) {
+    TEST_IGNORE_MESSAGE("no multicast on loopback");
+  }
+  uint32_t packets = pixelStreamStats().packets;
+  sendData(1, SYNC_UNIVERSE, 0x60, multicastAddress(1));
+  sendData(2, SYNC_UNIVERSE, 0x60, multicastAddress(2));
+  settle();
+  if (pixelStreamStats().packets == packets) TEST_IGNORE_MESSAGE("multicast not delivered on loopback");
+  sendSync(SYNC_UNIVERSE, multicastAddress(SYNC_UNIVERSE));
+  settle();
+  TEST_ASSERT_EQUAL(frames + 1, pixelStreamStats().frames);
+  sendData(1, SYNC_UNIVERSE, 0x70, multicastAddress(1));
+  sendData(2, SYNC_UNIVERSE, 0x70, multicastAddress(2));
+  sendSync(SYNC_UNIVERSE, multicastAddress(SYNC_UNIVERSE));
+  settle();
+  TEST_ASSERT_EQUAL(frames + 2, pixelStreamStats().frames);
+}
+
+int main(int argc, char** argv) {
+  setMillis(1000);
+  beginLedOutput(PIXELS);
+  beginLedEffects();
+  beginPixelStream(0);
+  sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  UNITY_BEGIN();
+  RUN_TEST(test_sync_ends_the_frame);
+  RUN_TEST(test_falls_back_when_sync_stops);
+  RUN_TEST(test_multicast_sync_universe_is_joined);
+  return UNITY_END();
+}
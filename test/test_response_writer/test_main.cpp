@@ -0,0 +1,113 @@
+// ResponseWriter against a recording esp_http_server: what reaches the
+// socket, in how many chunks, and that building the page never allocates.
+#include <unity.h>
+#include <climits>
+#include "native_stubs.h"
+#include "response_writer.h"
+
+static HttpServer server(80);
+
+static void handleSmall() {
+  ResponseWriter out(server);
+  out.begin(200, "text/plain");
+  out.print("n=");
+  out.print(42);
+  out.print(' ');
+  out.print(-7L);
+  out.print(' ');
+  out.print(0UL);
+  out.print(' ');
+  out.print(LONG_MIN);
+  out.print(' ');
+  out.print(IPAddress(192, 168, 4, 1));
+  out.end();
+}
+
+// 100 lines of 20 bytes: several buffer flushes
+static void handleLarge() {
+  ResponseWriter out(server);
+  out.begin(200, "text/plain");
+  for (int i = 0; i < 100; i++) out.print("0123456789abcdefghi\n");
+  out.end();
+}
+
+// A block bigger than the buffer goes out as its own chunk
+static char block[RESPONSE_BUFFER_SIZE * 2 + 1];
+static void handleBlock() {
+  ResponseWriter out(server);
+  out.begin(200, "text/plain");
+  out.print("head ");
+  out.print(block);
+  out.print(" tail");
+}
+
+static void handleEscaped() {
+  ResponseWriter out(server);
+  out.begin(200, "text/html");
+  out.printEscaped("<a href=\"x\">Tom & Jerry's</a>");
+  out.print('|');
+  out.printJsonString("quote\" slash\\ line\n tab\t bell\x07");
+  out.end();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_small_response_is_one_chunk() {
+  HttpResponse response = httpRequest(HTTP_GET, "/small");
+  TEST_ASSERT_EQUAL_STRING("200 OK", response.status.c_str());
+  TEST_ASSERT_EQUAL_STRING("text/plain", response.contentType.c_str());
+  std::string expected = "n=42 -7 0 " + std::to_string(LONG_MIN) + " 192.168.4.1";
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), response.body.c_str());
+  TEST_ASSERT_EQUAL(1, response.chunks);
+  TEST_ASSERT_TRUE(response.complete);
+}
+
+void test_large_response_is_flushed_in_buffer_sized_chunks() {
+  HttpResponse response = httpRequest(HTTP_GET, "/large");
+  std::string expected;
+  for (int i = 0; i < 100; i++) expected += "0123456789abcdefghi\n";
+  TEST_ASSERT_TRUE(response.body == expected);
+  TEST_ASSERT_EQUAL((expected.size() + RESPONSE_BUFFER_SIZE - 1) / RESPONSE_BUFFER_SIZE, response.chunks);
+  TEST_ASSERT_TRUE(response.complete);
+}
+
+void test_large_block_bypasses_the_buffer() {
+  HttpResponse response = httpRequest(HTTP_GET, "/block");
+  TEST_ASSERT_TRUE(response.body == std::string("head ") + block + " tail");
+  // Staged prefix, the block itself, then the suffix from the destructor
+  TEST_ASSERT_EQUAL(3, response.chunks);
+  TEST_ASSERT_TRUE(response.complete);
+}
+
+void test_escaping() {
+  HttpResponse response = httpRequest(HTTP_GET, "/escaped");
+  TEST_ASSERT_EQUAL_STRING("&lt;a href=&quot;x&quot;&gt;Tom &amp; Jerry&#39;s&lt;/a&gt;|"
+                           "\"quote\\\" slash\\\\ line\\n tab\\t bell\\u0007\"",
+                           response.body.c_str());
+}
+
+void test_no_heap_allocations() {
+  const char* uris[] = {"/small", "/large", "/block", "/escaped"};
+  for (const char* uri : uris) {
+    HttpResponse response = httpRequest(HTTP_GET, uri);
+    TEST_ASSERT_EQUAL_MESSAGE(0, response.heap.allocations, uri);
+  }
+}
+
+int main(int argc, char** argv) {
+  memset(block, 'x', sizeof(block) - 1);
+  server.on("/small", HTTP_GET, handleSmall);
+  server.on("/large", HTTP_GET, handleLarge);
+  server.on("/block", HTTP_GET, handleBlock);
+  server.on("/escaped", HTTP_GET, handleEscaped);
+  server.begin(0, 4096);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_small_response_is_one_chunk);
+  RUN_TEST(test_large_response_is_flushed_in_buffer_sized_chunks);
+  RUN_TEST(test_large_block_bypasses_the_buffer);
+  RUN_TEST(test_escaping);
+  RUN_TEST(test_no_heap_allocations);
+  return UNITY_END();
+}
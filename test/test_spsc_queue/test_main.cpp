@@ -0,0 +1,109 @@
+// SpscQueue: capacity and ordering on one thread, then a producer and a
+// consumer thread passing full Commands as fast as they can. Every item
+// must arrive once, in order and intact; a torn copy shows up as a
+// wifi.ssid that does not match its sequence number. Throughput and the
+// push-to-pop latency of every item go to bench_spsc.json.
+#include <unity.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "commands.h"
+#include "../bench_report.h"
+
+static const uint32_t STRESS_ITEMS = 1000000;
+
+void setUp() {}
+void tearDown() {}
+
+void test_capacity_and_order() {
+  SpscQueue<uint32_t, 8> queue;
+  uint32_t item;
+  TEST_ASSERT_FALSE(queue.pop(item));
+  for (uint32_t i = 0; i < 8; i++) TEST_ASSERT_TRUE(queue.push(i));
+  TEST_ASSERT_FALSE(queue.push(8));
+  TEST_ASSERT_EQUAL(8, queue.size());
+  // Around the ring several times
+  for (uint32_t i = 0; i < 100; i++) {
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL(i, item);
+    TEST_ASSERT_TRUE(queue.push(i + 8));
+  }
+  TEST_ASSERT_EQUAL(8, queue.size());
+  for (uint32_t i = 100; i < 108; i++) {
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL(i, item);
+  }
+  TEST_ASSERT_FALSE(queue.pop(item));
+  TEST_ASSERT_EQUAL(0, queue.size());
+}
+
+static void fill(Command& command, uint32_t sequence) {
+  memset(&command, 0, sizeof(command));
+  command.type = CommandType::Connect;
+  snprintf(command.wifi.ssid, sizeof(command.wifi.ssid), "%u", sequence);
+  // The password spans the rest of the union, so its end is copied last
+  memset(command.wifi.password, 'a' + sequence % 26, sizeof(command.wifi.password) - 1);
+}
+
+// Like the HTTP task and the control loop: the producer wakes the consumer
+// after each push, and the consumer drains the queue and goes back to sleep
+void test_producer_consumer_stress() {
+  static SpscQueue<Command, COMMAND_QUEUE_SIZE> queue;
+  // Stamped before the first push attempt, so waiting on a full queue
+  // counts, and published to the consumer by the push itself
+  static std::vector<uint64_t> pushedAt(STRESS_ITEMS);
+  std::vector<uint32_t> latencies(STRESS_ITEMS);
+  TaskHandle_t consumer = xTaskGetCurrentTaskHandle();
+  uint32_t full = 0;
+  uint64_t start = wallNanos();
+  std::thread producer([consumer, &full]() {
+    Command command;
+    for (uint32_t i = 0; i < STRESS_ITEMS; i++) {
+      fill(command, i);
+      pushedAt[i] = wallNanos();
+      while (!queue.push(command)) {
+        full++;
+        std::this_thread::yield();
+      }
+      xTaskNotifyGive(consumer);
+    }
+  });
+
+  uint32_t received = 0, errors = 0, wakeups = 0;
+  Command command, expected;
+  while (received < STRESS_ITEMS) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    wakeups++;
+    while (queue.pop(command)) {
+      latencies[received] = wallNanos() - pushedAt[received];
+      fill(expected, received);
+      if (memcmp(&command, &expected, sizeof(command)) != 0) errors++;
+      received++;
+    }
+  }
+  uint64_t elapsed = wallNanos() - start;
+  producer.join();
+
+  printf("%u items in %u wakeups, the producer found the queue full %u times\n", received, wakeups, full);
+  std::sort(latencies.begin(), latencies.end());
+  BenchReport report("spsc");
+  report.add(BenchRow()
+                 .add("items", received)
+                 .add("ops_per_s", received * 1e9 / elapsed)
+                 .add("latency_p50_us", latencies[STRESS_ITEMS / 2] / 1000.0)
+                 .add("latency_p99_us", latencies[STRESS_ITEMS - STRESS_ITEMS / 100] / 1000.0)
+                 .add("latency_max_us", latencies[STRESS_ITEMS - 1] / 1000.0)
+                 .add("wakeups", wakeups)
+                 .add("queue_full", full));
+  TEST_ASSERT_TRUE(report.write());
+  TEST_ASSERT_EQUAL(STRESS_ITEMS, received);
+  TEST_ASSERT_EQUAL(0, errors);
+  TEST_ASSERT_EQUAL(0, queue.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_capacity_and_order);
+  RUN_TEST(test_producer_consumer_stress);
+  return UNITY_END();
+}
@@ -0,0 +1,110 @@
+// The known network store across simulated reboots (beginWifiStore() on
+// the same NVS contents): every boot gets a new number, whether or not it
+// connects, and lastBoot tells the network used last apart. Connect results
+// reach flash once per quiet period, and forgetting a network drops its
+// cached link.
+#include <unity.h>
+#include "native_stubs.h"
+#include "wifi_store.h"
+
+void setUp() {
+  nvsReset();
+  beginWifiStore();
+  forgetAllNetworks();
+}
+
+void tearDown() {}
+
+void test_boots_without_a_connect_are_numbered() {
+  rememberNetwork("home", "password1");
+  rememberNetwork("office", "password2");
+  noteConnectResult("home", true, 1200);
+  recordConnect(1200, false, true);
+  uint16_t first = knownNetwork(findKnownNetwork("home")).lastBoot;
+  TEST_ASSERT_NOT_EQUAL(0, first);
+
+  // Two boots that never get on the network
+  beginWifiStore();
+  recordConnect(10000, false, false);
+  beginWifiStore();
+
+  noteConnectResult("office", true, 900);
+  recordConnect(900, false, true);
+  TEST_ASSERT_EQUAL(first + 2, knownNetwork(findKnownNetwork("office")).lastBoot);
+  TEST_ASSERT_EQUAL(findKnownNetwork("office"), preferredKnownNetwork());
+  TEST_ASSERT_EQUAL(first + 2, connectLogEntry(0).boot);
+  TEST_ASSERT_EQUAL(first + 1, connectLogEntry(1).boot);
+}
+
+void test_boot_number_survives_reboot() {
+  beginWifiStore();
+  recordConnect(500, true, true);
+  uint16_t boot = connectLogEntry(0).boot;
+  beginWifiStore();
+  beginWifiStore();
+  recordConnect(500, true, true);
+  TEST_ASSERT_EQUAL(boot + 2, connectLogEntry(0).boot);
+}
+
+void test_connect_results_are_written_after_quiet_period() {
+  rememberNetwork("home", "password1");
+  uint32_t before = wifiStoreWrites();
+  // A round of failed candidates, then a success
+  for (int i = 0; i < 5; i++) {
+    noteConnectResult("home", false, 0);
+    advanceMillis(1000);
+    pollWifiStore();
+  }
+  noteConnectResult("home", true, 800);
+  TEST_ASSERT_EQUAL(before, wifiStoreWrites());
+  TEST_ASSERT_EQUAL(5, knownNetwork(0).failures);
+  TEST_ASSERT_EQUAL(1, knownNetwork(0).successes);
+
+  advanceMillis(WIFI_SAVE_QUIET_PERIOD - 1);
+  pollWifiStore();
+  TEST_ASSERT_EQUAL(before, wifiStoreWrites());
+  advanceMillis(1);
+  pollWifiStore();
+  TEST_ASSERT_EQUAL(before + 1, wifiStoreWrites());
+  pollWifiStore();
+  flushWifiStore();
+  TEST_ASSERT_EQUAL(before + 1, wifiStoreWrites());
+
+  beginWifiStore();
+  TEST_ASSERT_EQUAL(5, knownNetwork(0).failures);
+  TEST_ASSERT_EQUAL(1, knownNetwork(0).successes);
+}
+
+void test_flush_writes_pending_history() {
+  rememberNetwork("home", "password1");
+  noteConnectResult("home", false, 0);
+  uint32_t before = wifiStoreWrites();
+  flushWifiStore();
+  TEST_ASSERT_EQUAL(before + 1, wifiStoreWrites());
+  beginWifiStore();
+  TEST_ASSERT_EQUAL(1, knownNetwork(0).failures);
+}
+
+void test_forget_clears_its_link() {
+  WifiLink link;
+  memset(&link, 0, sizeof(link));
+  link.channel = 6;
+  rememberNetwork("home", "password1");
+  rememberNetwork("office", "password2");
+  saveWifiLink("home", link);
+
+  TEST_ASSERT_TRUE(forgetNetwork("office"));
+  TEST_ASSERT_TRUE(loadWifiLink("home", link));
+  TEST_ASSERT_TRUE(forgetNetwork("home"));
+  TEST_ASSERT_FALSE(loadWifiLink("home", link));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_boots_without_a_connect_are_numbered);
+  RUN_TEST(test_boot_number_survives_reboot);
+  RUN_TEST(test_connect_results_are_written_after_quiet_period);
+  RUN_TEST(test_flush_writes_pending_history);
+  RUN_TEST(test_forget_clears_its_link);
+  return UNITY_END();
+}
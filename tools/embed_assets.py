@@ -0,0 +1,119 @@
+"""
+Embed the static web UI (web/) into the firmware image.
+
+Runs as a PlatformIO pre-build script (see extra_scripts in platformio.ini) and
+can also be run by hand: `python tools/embed_assets.py`.
+
+- web/style.css and web/app.js are gzipped and emitted as byte arrays that are
+  served as-is with `Content-Encoding: gzip` and a strong ETag.
+- web/page.html is the page shell; it is split at the {{title}} and
+  {{content}} markers into three constant strings so handlers only have to
+  produce the dynamic parts.
+
+Output files are only rewritten when their contents change, so incremental
+builds are not invalidated on every run.
+"""
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+WEB_DIR = os.path.join(PROJECT_DIR, "web")
+HEADER_OUT = os.path.join(PROJECT_DIR, "include", "web_assets.h")
+SOURCE_OUT = os.path.join(PROJECT_DIR, "src", "web_assets.cpp")
+
+
+def read(name):
+    with open(os.path.join(WEB_DIR, name), "rb") as f:
+        return f.read()
+
+
+def gzip_asset(data):
+    # mtime=0 keeps the output (and therefore the ETag) reproducible.
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def etag_of(data):
+    return hashlib.sha1(data).hexdigest()[:12]
+
+
+def c_string(text):
+    out = text.replace("\\", "\\\\").replace('"', '\\"')
+    return '"' + out + '"'
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path, "r", encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print("embed_assets: wrote " + os.path.relpath(path, PROJECT_DIR))
+
+
+def main():
+    css_gz = gzip_asset(read("style.css"))
+    js_gz = gzip_asset(read("app.js"))
+    css_etag = etag_of(css_gz)
+    js_etag = etag_of(js_gz)
+
+    page = read("page.html").decode("utf-8").replace("\r", "").replace("\n", "")
+    page = page.replace("{{css_etag}}", css_etag).replace("{{js_etag}}", js_etag)
+    head, rest = page.split("{{title}}")
+    nav, foot = rest.split("{{content}}")
+
+    header = """// Generated by tools/embed_assets.py from web/ - do not edit.
+#pragma once
+#include <Arduino.h>
+
+// Page shell: PAGE_HEAD + title + PAGE_NAV + content + PAGE_FOOT
+extern const char PAGE_HEAD[] PROGMEM;
+extern const char PAGE_NAV[] PROGMEM;
+extern const char PAGE_FOOT[] PROGMEM;
+
+// Pre-gzipped static assets
+#define APP_CSS_ETAG "\\"%s\\""
+#define APP_JS_ETAG "\\"%s\\""
+extern const uint8_t APP_CSS_GZ[] PROGMEM;
+extern const size_t APP_CSS_GZ_LEN;
+extern const uint8_t APP_JS_GZ[] PROGMEM;
+extern const size_t APP_JS_GZ_LEN;
+""" % (css_etag, js_etag)
+
+    source = """// Generated by tools/embed_assets.py from web/ - do not edit.
+#include "web_assets.h"
+
+const char PAGE_HEAD[] PROGMEM = %s;
+const char PAGE_NAV[] PROGMEM = %s;
+const char PAGE_FOOT[] PROGMEM = %s;
+
+const uint8_t APP_CSS_GZ[] PROGMEM = {
+%s
+};
+const size_t APP_CSS_GZ_LEN = sizeof(APP_CSS_GZ);
+
+const uint8_t APP_JS_GZ[] PROGMEM = {
+%s
+};
+const size_t APP_JS_GZ_LEN = sizeof(APP_JS_GZ);
+""" % (c_string(head), c_string(nav), c_string(foot), c_bytes(css_gz), c_bytes(js_gz))
+
+    write_if_changed(HEADER_OUT, header)
+    write_if_changed(SOURCE_OUT, source)
+
+
+main()
@@ -0,0 +1,211 @@
+"""
+Host simulation of fleet sync (src/fleet_sync.cpp) over loopback multicast.
+
+Runs one leader and a number of virtual follower nodes as threads. Every
+node has its own millis() clock with a random offset from the host clock,
+estimates the leader's clock from its beacons the way the firmware does, and
+applies each state update when its own clock reaches the scheduled time.
+The host clock is the common reference for the report:
+
+- fan-out latency: leader send to follower receive
+- apply skew: spread of the actual apply moments of one update across all
+  nodes, leader included
+
+    python tools/fleet_sim.py --nodes 40 --updates 50
+
+Packets use the same 34-byte layout as the firmware, so the script also
+shows what a leader sends on the wire. Only the standard library is needed.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import threading
+import time
+
+PACKET = struct.Struct("<2sBBIIIIIBBBB3sBH")
+VERSION = 2
+BEACON, STATE = 0, 1
+ALL_GROUPS = 0
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+class Clock:
+    """millis() of a virtual node: host time plus a fixed random offset."""
+
+    def __init__(self, offset_ms):
+        self.offset_ms = offset_ms
+
+    def millis(self):
+        return (int(time.monotonic() * 1000) + self.offset_ms) & 0xFFFFFFFF
+
+
+def wrap(value):
+    """uint32 difference as a signed int, like (int32_t)(a - b)."""
+    value &= 0xFFFFFFFF
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def open_receiver(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    sock.bind(("", args.port))
+    membership = socket.inet_aton(args.address) + socket.inet_aton(args.interface)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    sock.settimeout(0.2)
+    return sock
+
+
+def open_sender(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(args.interface))
+    return sock
+
+
+class Node(threading.Thread):
+    def __init__(self, node_id, args, results, lock, stop):
+        super().__init__(daemon=True)
+        self.node_id = node_id
+        self.args = args
+        self.clock = Clock(random.randint(-10 ** 6, 10 ** 6))
+        self.results = results
+        self.lock = lock
+        self.stop = stop
+        self.samples = []
+        self.last_seq = None
+        self.leader = None  # (sender, session)
+        self.pending = []  # (local apply millis, seq)
+        self.sock = open_receiver(args)
+
+    def offset(self):
+        return min(self.samples)
+
+    def run(self):
+        while not self.stop.is_set():
+            self.apply_due()
+            # Block until the next packet or the next apply time, like the
+            # firmware's receiver task and loop deadline
+            now = self.clock.millis()
+            wait = min((wrap(p[0] - now) for p in self.pending), default=200)
+            self.sock.settimeout(max(wait, 0) / 1000.0 or 0.0005)
+            try:
+                data = self.sock.recv(64)
+            except socket.timeout:
+                continue
+            host_now = time.monotonic()
+            now = self.clock.millis()
+            if len(data) != PACKET.size:
+                continue
+            magic, version, kind, sender, session, seq, sent_at, apply_at, group = PACKET.unpack(data)[:9]
+            if magic != b"GF" or version != VERSION:
+                continue
+            if (sender, session) != self.leader:
+                # New leader or a rebooted one: its clock and numbering restart
+                self.leader = (sender, session)
+                self.samples = []
+                self.last_seq = None
+            self.samples = (self.samples + [wrap(now - sent_at)])[-self.args.window:]
+            if kind != STATE or group not in (ALL_GROUPS, self.args.group):
+                continue
+            if self.last_seq is not None and wrap(seq - self.last_seq) <= 0:
+                continue
+            self.last_seq = seq
+            with self.lock:
+                self.results["received"].setdefault(seq, []).append(host_now)
+            self.pending.append(((apply_at + self.offset()) & 0xFFFFFFFF, seq))
+
+    def apply_due(self):
+        now = self.clock.millis()
+        for item in [p for p in self.pending if wrap(now - p[0]) >= 0]:
+            self.pending.remove(item)
+            with self.lock:
+                self.results["applied"].setdefault(item[1], []).append(time.monotonic())
+
+
+def lead(args, results, lock):
+    sock = open_sender(args)
+    clock = Clock(random.randint(-10 ** 6, 10 ** 6))
+    sender = 0x4C454144
+    session = random.getrandbits(32)
+    address = (args.address, args.port)
+
+    def send(kind, seq, apply_at, copies):
+        sent_at = clock.millis()
+        color = bytes(random.randrange(256) for _ in range(3))
+        data = PACKET.pack(b"GF", VERSION, kind, sender, session, seq, sent_at, apply_at, args.group,
+                           0x06, 1, 255, color, 0, 0)
+        for _ in range(copies):
+            sock.sendto(data, address)
+        return sent_at
+
+    # Warm up the followers' offset estimates
+    for _ in range(args.window):
+        send(BEACON, 0, 0, 1)
+        time.sleep(args.beacon / 1000.0)
+
+    for seq in range(1, args.updates + 1):
+        apply_at = (clock.millis() + args.delay) & 0xFFFFFFFF
+        with lock:
+            results["sent"][seq] = time.monotonic()
+        send(STATE, seq, apply_at, args.repeats)
+        # The leader applies its own update at the same scheduled time
+        while wrap(clock.millis() - apply_at) < 0:
+            time.sleep(0.0002)
+        with lock:
+            results["applied"].setdefault(seq, []).append(time.monotonic())
+        time.sleep(args.interval / 1000.0)
+        send(BEACON, 0, 0, 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--nodes", type=int, default=30, help="followers")
+    parser.add_argument("--updates", type=int, default=30)
+    parser.add_argument("--interval", type=float, default=100, help="ms between updates")
+    parser.add_argument("--delay", type=int, default=60, help="FLEET_APPLY_DELAY, ms")
+    parser.add_argument("--beacon", type=int, default=50, help="warm-up beacon interval, ms")
+    parser.add_argument("--window", type=int, default=8, help="FLEET_OFFSET_WINDOW")
+    parser.add_argument("--repeats", type=int, default=3, help="FLEET_REPEATS")
+    parser.add_argument("--group", type=int, default=1)
+    parser.add_argument("--address", default="239.255.70.1")
+    parser.add_argument("--port", type=int, default=4210)
+    parser.add_argument("--interface", default="127.0.0.1")
+    args = parser.parse_args()
+
+    results = {"sent": {}, "received": {}, "applied": {}}
+    lock = threading.Lock()
+    stop = threading.Event()
+    nodes = [Node(i, args, results, lock, stop) for i in range(args.nodes)]
+    for node in nodes:
+        node.start()
+    lead(args, results, lock)
+    time.sleep((args.delay + 50) / 1000.0)
+    stop.set()
+    for node in nodes:
+        node.join()
+
+    latencies = sorted((t - results["sent"][seq]) * 1000
+                       for seq, times in results["received"].items() for t in times)
+    skews = sorted((max(times) - min(times)) * 1000 for times in results["applied"].values())
+    complete = sum(1 for times in results["applied"].values() if len(times) == args.nodes + 1)
+    print("nodes:       %d followers + 1 leader, %d updates (%d reached every node)"
+          % (args.nodes, args.updates, complete))
+    print("fan-out:     p50 %.2f ms, p99 %.2f ms, max %.2f ms"
+          % (percentile(latencies, 50), percentile(latencies, 99), latencies[-1] if latencies else 0))
+    print("apply skew:  p50 %.2f ms, p99 %.2f ms, max %.2f ms"
+          % (percentile(skews, 50), percentile(skews, 99), skews[-1] if skews else 0))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+"""
+Load test for the device's HTTP server.
+
+Opens a number of keep-alive connections, each issuing requests back to back
+for a fixed time, then reports requests per second and latency percentiles:
+
+    python tools/load_test.py 192.168.4.1 --connections 4 --duration 10 \
+        --path / --path /api/state --path /metrics
+
+Use --close to send `Connection: close` and compare against reconnecting on
+every request. Only the standard library is needed.
+"""
+
+import argparse
+import http.client
+import threading
+import time
+
+
+def worker(args, deadline, results, lock):
+    latencies = []
+    errors = 0
+    connects = 0
+    conn = None
+    i = 0
+    headers = {"Connection": "close"} if args.close else {}
+    while time.monotonic() < deadline:
+        path = args.path[i % len(args.path)]
+        i += 1
+        if conn is None:
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+            connects += 1
+        start = time.perf_counter()
+        try:
+            conn.request("GET", path, headers=headers)
+            response = conn.getresponse()
+            response.read()
+            if response.status >= 400:
+                errors += 1
+            latencies.append(time.perf_counter() - start)
+            if args.close or response.will_close:
+                conn.close()
+                conn = None
+        except (OSError, http.client.HTTPException):
+            errors += 1
+            if conn is not None:
+                conn.close()
+            conn = None
+    if conn is not None:
+        conn.close()
+    with lock:
+        results["latencies"].extend(latencies)
+        results["errors"] += errors
+        results["connects"] += connects
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--connections", type=int, default=4)
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds")
+    parser.add_argument("--timeout", type=float, default=5.0, help="per request, seconds")
+    parser.add_argument("--path", action="append", help="may be repeated (default /)")
+    parser.add_argument("--close", action="store_true", help="no keep-alive")
+    args = parser.parse_args()
+    args.path = args.path or ["/"]
+
+    results = {"latencies": [], "errors": 0, "connects": 0}
+    lock = threading.Lock()
+    deadline = time.monotonic() + args.duration
+    threads = [threading.Thread(target=worker, args=(args, deadline, results, lock))
+               for _ in range(args.connections)]
+    started = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - started
+
+    latencies = sorted(results["latencies"])
+    print("requests:    %d in %.1f s (%d errors, %d connections opened)"
+          % (len(latencies), elapsed, results["errors"], results["connects"]))
+    print("throughput:  %.1f req/s" % (len(latencies) / elapsed))
+    for p in (50, 90, 99):
+        print("p%-2d latency: %.1f ms" % (p, percentile(latencies, p) * 1000))
+    print("max latency: %.1f ms" % ((latencies[-1] if latencies else 0) * 1000))
+
+
+if __name__ == "__main__":
+    main()
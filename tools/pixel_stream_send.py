@@ -0,0 +1,177 @@
+"""
+Streams a moving rainbow to the firmware's pixel stream receiver
+(src/pixel_stream.cpp) over DDP or E1.31 and reports throughput and frame
+timing jitter.
+
+    python tools/pixel_stream_send.py 192.168.1.50 --pixels 300 --fps 60
+    python tools/pixel_stream_send.py 192.168.1.50 --protocol e131 --sync 64000
+
+Frames are sent on a fixed schedule (absolute deadlines, so a late frame
+does not shift the ones after it). Jitter is the difference between each
+frame's actual send time and its deadline. With --metrics the device's
+/metrics counters are read before and after the run, which shows how many
+of the frames it showed and how many packets it dropped or lost.
+
+Only the standard library is needed.
+"""
+
+import argparse
+import colorsys
+import re
+import socket
+import struct
+import time
+import urllib.request
+
+DDP_PORT = 4048
+DDP_MAX_PIXELS = 480  # 1440 bytes of data, fits one unfragmented datagram
+DDP_PUSH = 0x01
+DDP_VERSION_1 = 0x40
+DDP_TYPE_RGB8 = 0x0B
+DDP_ID_DISPLAY = 1
+
+E131_PORT = 5568
+UNIVERSE_PIXELS = 170
+E131_CID = bytes(range(16))
+ACN_ID = b"ASC-E1.17\x00\x00\x00"
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def rainbow(pixels, frame):
+    data = bytearray(pixels * 3)
+    for i in range(pixels):
+        r, g, b = colorsys.hsv_to_rgb(((i * 2 + frame * 3) % 256) / 256.0, 1.0, 1.0)
+        data[i * 3:i * 3 + 3] = bytes((int(r * 255), int(g * 255), int(b * 255)))
+    return bytes(data)
+
+
+def ddp_packets(data, sequence):
+    """One frame as DDP packets, PUSH on the last."""
+    packets = []
+    step = DDP_MAX_PIXELS * 3
+    for offset in range(0, len(data), step):
+        chunk = data[offset:offset + step]
+        flags = DDP_VERSION_1 | (DDP_PUSH if offset + step >= len(data) else 0)
+        header = struct.pack(">BBBBIH", flags, sequence, DDP_TYPE_RGB8, DDP_ID_DISPLAY, offset, len(chunk))
+        packets.append(header + chunk)
+    return packets
+
+
+def flags_length(length):
+    return 0x7000 | length
+
+
+def e131_data(universe, sequence, data, sync):
+    """E1.31 data packet (ANSI E1.31-2018 section 4.1)."""
+    dmp = struct.pack(">HBBHHH", flags_length(10 + 1 + len(data)), 0x02, 0xA1, 0, 1, 1 + len(data)) + b"\x00" + data
+    name = b"pixel_stream_send".ljust(64, b"\x00")
+    framing = struct.pack(">HI", flags_length(77 + len(dmp)), 0x00000002) + name + \
+        struct.pack(">BHBBH", 100, sync, sequence, 0, universe) + dmp
+    root = struct.pack(">HH12sHI", 0x0010, 0, ACN_ID, flags_length(22 + len(framing)), 0x00000004) + E131_CID
+    return root + framing
+
+
+def e131_sync(universe, sequence):
+    framing = struct.pack(">HIBH2s", flags_length(11), 0x00000001, sequence, universe, b"\x00\x00")
+    root = struct.pack(">HH12sHI", 0x0010, 0, ACN_ID, flags_length(22 + len(framing)), 0x00000008) + E131_CID
+    return root + framing
+
+
+def read_metrics(host):
+    """pixel_stream_* counters from the device, keyed by name and label."""
+    with urllib.request.urlopen("http://%s/metrics" % host, timeout=5) as response:
+        text = response.read().decode()
+    values = {}
+    for match in re.finditer(r'^(pixel_stream_\w+(?:\{[^}]*\})?) (\d+)$', text, re.MULTILINE):
+        values[match.group(1)] = int(match.group(2))
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("--protocol", choices=("ddp", "e131"), default="ddp")
+    parser.add_argument("--pixels", type=int, default=300)
+    parser.add_argument("--fps", type=float, default=50)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--universe", type=int, default=1, help="PIXEL_STREAM_UNIVERSE")
+    parser.add_argument("--sync", type=int, default=0, help="E1.31 sync universe, 0 for none")
+    parser.add_argument("--multicast", action="store_true", help="E1.31 to 239.255.x.y instead of the host")
+    parser.add_argument("--port", type=int, help="override the protocol's port")
+    parser.add_argument("--metrics", action="store_true", help="diff the device's /metrics counters")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    port = args.port or (DDP_PORT if args.protocol == "ddp" else E131_PORT)
+    universes = (args.pixels + UNIVERSE_PIXELS - 1) // UNIVERSE_PIXELS
+    sequences = [0] * universes
+    sync_sequence = 0
+
+    before = read_metrics(args.host) if args.metrics else {}
+    frames = int(args.seconds * args.fps)
+    interval = 1.0 / args.fps
+    lateness = []
+    packets = 0
+    payload = 0
+    start = time.perf_counter()
+    for frame in range(frames):
+        deadline = start + frame * interval
+        # Sleep most of the way, then spin for an accurate send time
+        while True:
+            left = deadline - time.perf_counter()
+            if left <= 0:
+                break
+            time.sleep(left - 0.002 if left > 0.003 else 0)
+        lateness.append((time.perf_counter() - deadline) * 1000)
+
+        data = rainbow(args.pixels, frame)
+        if args.protocol == "ddp":
+            for packet in ddp_packets(data, frame % 15 + 1):
+                sock.sendto(packet, (args.host, port))
+                packets += 1
+                payload += len(packet)
+            continue
+        for index in range(universes):
+            universe = args.universe + index
+            chunk = data[index * UNIVERSE_PIXELS * 3:(index + 1) * UNIVERSE_PIXELS * 3]
+            sequences[index] = (sequences[index] + 1) % 256
+            packet = e131_data(universe, sequences[index], chunk, args.sync)
+            address = "239.255.%d.%d" % (universe >> 8, universe & 0xFF) if args.multicast else args.host
+            sock.sendto(packet, (address, port))
+            packets += 1
+            payload += len(packet)
+        if args.sync:
+            sync_sequence = (sync_sequence + 1) % 256
+            address = "239.255.%d.%d" % (args.sync >> 8, args.sync & 0xFF) if args.multicast else args.host
+            sock.sendto(e131_sync(args.sync, sync_sequence), (address, port))
+            packets += 1
+    elapsed = time.perf_counter() - start
+
+    intervals = sorted(abs(b - a) for a, b in zip(lateness, lateness[1:]))
+    lateness.sort()
+    print("sent:        %d frames of %d pixels over %s in %.2f s (%.1f fps)"
+          % (frames, args.pixels, args.protocol, elapsed, frames / elapsed))
+    print("throughput:  %.0f packets/s, %.2f Mbit/s" % (packets / elapsed, payload * 8 / elapsed / 1e6))
+    print("lateness:    p50 %.2f ms, p99 %.2f ms, max %.2f ms"
+          % (percentile(lateness, 50), percentile(lateness, 99), lateness[-1] if lateness else 0))
+    print("jitter:      p50 %.2f ms, p99 %.2f ms between consecutive frames"
+          % (percentile(intervals, 50), percentile(intervals, 99)))
+
+    if args.metrics:
+        # Give the device a moment to show the last frame
+        time.sleep(0.2)
+        after = read_metrics(args.host)
+        for key in sorted(after):
+            if key.endswith("_total") or "_total{" in key:
+                print("%-50s +%d" % (key, after[key] - before.get(key, 0)))
+
+
+if __name__ == "__main__":
+    main()
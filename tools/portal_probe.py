@@ -0,0 +1,181 @@
+"""
+Time the captive portal the way a phone meets it after joining the AP.
+
+For each probe hostname the phone and desktop OSes use, this resolves the
+name against the device's DNS responder, requests the OS's probe URL from
+the address it got, and follows the redirect to the portal page:
+
+    python tools/portal_probe.py 192.168.4.1 --rounds 20
+
+Reports, per stage and in total, p50/p99/max of: the DNS answer, the probe's
+302, and the portal page. With --wait the script first polls the responder
+until it answers, so started right after joining `LED_CONFIG` it also shows
+how long after association the portal is reachable. Only the standard
+library is needed.
+"""
+
+import argparse
+import http.client
+import os
+import socket
+import struct
+import time
+import urllib.parse
+
+# (hostname, probe path) as the operating systems send them
+PROBES = [
+    ("connectivitycheck.gstatic.com", "/generate_204"),    # Android
+    ("captive.apple.com", "/hotspot-detect.html"),         # iOS, macOS
+    ("www.msftconnecttest.com", "/connecttest.txt"),       # Windows
+    ("detectportal.firefox.com", "/success.txt"),          # Firefox
+]
+
+TYPE_A = 1
+
+
+def dns_query(name, ident):
+    header = struct.pack(">HHHHHH", ident, 0x0100, 1, 0, 0, 0)
+    question = b"".join(bytes([len(label)]) + label.encode() for label in name.split(".")) + b"\0"
+    return header + question + struct.pack(">HH", TYPE_A, 1)
+
+
+def first_a_record(packet, ident):
+    """Address from the first A record, or None."""
+    if len(packet) < 12:
+        return None
+    rid, flags, qdcount, ancount = struct.unpack(">HHHH", packet[:8])
+    if rid != ident or not flags & 0x8000 or ancount == 0:
+        return None
+    offset = 12
+    for _ in range(qdcount):
+        while packet[offset] != 0:
+            if packet[offset] & 0xC0 == 0xC0:
+                offset += 1
+                break
+            offset += packet[offset] + 1
+        offset += 1 + 4
+    for _ in range(ancount):
+        if packet[offset] & 0xC0 == 0xC0:
+            offset += 2
+        else:
+            while packet[offset] != 0:
+                offset += packet[offset] + 1
+            offset += 1
+        rtype, _, _, length = struct.unpack(">HHIH", packet[offset:offset + 10])
+        offset += 10
+        if rtype == TYPE_A and length == 4:
+            return socket.inet_ntoa(packet[offset:offset + 4])
+        offset += length
+    return None
+
+
+def resolve(args, name):
+    """Returns (address, seconds) or (None, None) on timeout."""
+    ident = struct.unpack(">H", os.urandom(2))[0]
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(args.timeout)
+    try:
+        start = time.perf_counter()
+        sock.sendto(dns_query(name, ident), (args.host, args.dns_port))
+        while True:
+            packet, _ = sock.recvfrom(512)
+            address = first_a_record(packet, ident)
+            if address is not None:
+                return address, time.perf_counter() - start
+    except OSError:
+        return None, None
+    finally:
+        sock.close()
+
+
+def get(address, port, host, path, timeout):
+    """Returns (status, location, seconds) for one GET, redirects not followed."""
+    conn = http.client.HTTPConnection(address, port, timeout=timeout)
+    try:
+        start = time.perf_counter()
+        conn.request("GET", path, headers={"Host": host, "Connection": "close"})
+        response = conn.getresponse()
+        response.read()
+        return response.status, response.getheader("Location"), time.perf_counter() - start
+    finally:
+        conn.close()
+
+
+def wait_for_responder(args):
+    start = time.monotonic()
+    while time.monotonic() - start < args.wait:
+        address, _ = resolve(args, PROBES[0][0])
+        if address is not None:
+            return time.monotonic() - start
+        time.sleep(0.1)
+    return None
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("host", nargs="?", default="192.168.4.1")
+    parser.add_argument("--dns-port", type=int, default=53)
+    parser.add_argument("--http-port", type=int, default=80)
+    parser.add_argument("--rounds", type=int, default=10)
+    parser.add_argument("--timeout", type=float, default=3.0, help="per step, seconds")
+    parser.add_argument("--wait", type=float, default=0.0,
+                        help="poll up to this many seconds for the first DNS answer")
+    args = parser.parse_args()
+
+    if args.wait > 0:
+        waited = wait_for_responder(args)
+        if waited is None:
+            print("no DNS answer within %.1f s" % args.wait)
+            return 1
+        print("first DNS answer after %.2f s" % waited)
+
+    stages = {"dns": [], "probe": [], "portal": [], "total": []}
+    failures = 0
+    for _ in range(args.rounds):
+        for name, path in PROBES:
+            address, dns_time = resolve(args, name)
+            if address is None:
+                print("%s: no DNS answer" % name)
+                failures += 1
+                continue
+            try:
+                status, location, probe_time = get(address, args.http_port, name, path, args.timeout)
+                if status != 302 or not location:
+                    print("%s%s: expected a 302, got %d" % (name, path, status))
+                    failures += 1
+                    continue
+                portal = urllib.parse.urlsplit(location)
+                portal_host = portal.hostname or address
+                status, _, portal_time = get(portal_host, portal.port or args.http_port, portal.netloc or portal_host,
+                                             portal.path or "/", args.timeout)
+                if status != 200:
+                    print("%s: portal %s answered %d" % (name, location, status))
+                    failures += 1
+                    continue
+            except (OSError, http.client.HTTPException) as error:
+                print("%s%s: %s" % (name, path, error))
+                failures += 1
+                continue
+            stages["dns"].append(dns_time)
+            stages["probe"].append(probe_time)
+            stages["portal"].append(portal_time)
+            stages["total"].append(dns_time + probe_time + portal_time)
+
+    print("probes:  %d completed, %d failed" % (len(stages["total"]), failures))
+    print("stage      p50 ms   p99 ms   max ms")
+    for stage, values in stages.items():
+        values.sort()
+        print("%-8s %8.1f %8.1f %8.1f" % (stage, percentile(values, 50) * 1000, percentile(values, 99) * 1000,
+                                         (values[-1] if values else 0) * 1000))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,147 @@
+"""
+Load test for the live update stream.
+
+Opens a number of EventSource subscribers on port 81, then sends
+`PUT /api/state` commands one after another and times each from the request
+until its `led` event has reached every subscriber:
+
+    python tools/sse_load_test.py 192.168.4.1 --subscribers 4 --commands 200
+
+Each command sets a colour no other command in the run uses, so the event it
+caused can be told apart from snapshots and other traffic. Reports commands
+per second and p50/p99 latency. The device takes MAX_EVENT_SUBSCRIBERS (4)
+subscribers, so this also counts as a busy UI for anything else connected.
+Only the standard library is needed.
+"""
+
+import argparse
+import http.client
+import json
+import socket
+import threading
+import time
+
+
+class Subscriber(threading.Thread):
+    def __init__(self, args, index, pending, lock):
+        super().__init__(daemon=True)
+        self.args = args
+        self.index = index
+        self.pending = pending
+        self.lock = lock
+        self.ready = threading.Event()
+        self.error = None
+
+    def run(self):
+        try:
+            sock = socket.create_connection((self.args.host, self.args.event_port), timeout=self.args.timeout)
+            sock.sendall(b"GET /events HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n"
+                         % self.args.host.encode())
+            stream = sock.makefile("rb")
+            status = stream.readline()
+            if b" 200 " not in status:
+                raise OSError("stream answered %r" % status.strip())
+            while stream.readline() not in (b"\r\n", b"\n", b""):
+                pass
+            sock.settimeout(None)
+            self.ready.set()
+            name = None
+            for line in stream:
+                line = line.rstrip(b"\r\n")
+                if line.startswith(b"event: "):
+                    name = line[7:]
+                elif line.startswith(b"data: ") and name == b"led":
+                    self.seen(json.loads(line[6:]), time.perf_counter())
+                elif not line:
+                    name = None
+        except (OSError, ValueError) as error:
+            self.error = error
+            self.ready.set()
+
+    def seen(self, state, when):
+        key = (state.get("r"), state.get("g"), state.get("b"))
+        with self.lock:
+            command = self.pending.get(key)
+            if command is not None and self.index not in command["seen"]:
+                command["seen"].add(self.index)
+                if len(command["seen"]) == self.args.subscribers:
+                    command["done"] = when
+                    command["event"].set()
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def colour(i):
+    return (i & 0xFF, (i >> 8) & 0xFF, (i >> 16) & 0xFF)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("host", nargs="?", default="192.168.4.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--event-port", type=int, default=81)
+    parser.add_argument("--subscribers", type=int, default=4)
+    parser.add_argument("--commands", type=int, default=100)
+    parser.add_argument("--timeout", type=float, default=5.0, help="per command, seconds")
+    args = parser.parse_args()
+
+    pending = {}
+    lock = threading.Lock()
+    subscribers = [Subscriber(args, i, pending, lock) for i in range(args.subscribers)]
+    for subscriber in subscribers:
+        subscriber.start()
+    for subscriber in subscribers:
+        subscriber.ready.wait(args.timeout)
+        if subscriber.error is not None or not subscriber.ready.is_set():
+            print("subscriber %d: %s" % (subscriber.index, subscriber.error or "no handshake"))
+            return 1
+
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+    latencies = []
+    errors = 0
+    start = time.perf_counter()
+    for i in range(args.commands):
+        key = colour(i)
+        command = {"seen": set(), "done": None, "event": threading.Event()}
+        with lock:
+            pending[key] = command
+        body = json.dumps({"on": True, "color": list(key)}).encode()
+        sent = time.perf_counter()
+        try:
+            conn.request("PUT", "/api/state", body=body, headers={"Content-Type": "application/json"})
+            response = conn.getresponse()
+            response.read()
+            if response.status != 202:
+                raise OSError("HTTP %d" % response.status)
+        except (OSError, http.client.HTTPException) as error:
+            print("command %d: %s" % (i, error))
+            errors += 1
+            conn.close()
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+            continue
+        if command["event"].wait(args.timeout):
+            latencies.append(command["done"] - sent)
+        else:
+            print("command %d: %d of %d subscribers saw it" % (i, len(command["seen"]), args.subscribers))
+            errors += 1
+        with lock:
+            del pending[key]
+    elapsed = time.perf_counter() - start
+    conn.close()
+
+    latencies.sort()
+    print("commands:    %d delivered, %d failed in %.1f s" % (len(latencies), errors, elapsed))
+    print("throughput:  %.1f commands/s" % (len(latencies) / elapsed))
+    for p in (50, 99):
+        print("p%-2d latency: %.1f ms" % (p, percentile(latencies, p) * 1000))
+    print("max latency: %.1f ms" % ((latencies[-1] if latencies else 0) * 1000))
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,87 @@
+// Dark mode toggle
+const toggle = document.getElementById('dark-mode');
+const body = document.body;
+toggle.addEventListener('change', function() {
+  if (this.checked) {
+    body.classList.add('dark-mode');
+    localStorage.setItem('darkMode', 'enabled');
+  } else {
+    body.classList.remove('dark-mode');
+    localStorage.setItem('darkMode', 'disabled');
+  }
+});
+if (localStorage.getItem('darkMode') === 'enabled') {
+  body.classList.add('dark-mode');
+  toggle.checked = true;
+}
+
+// WiFi setup: the network list is rendered from /api/scan.json. A 202 means
+// the device is still scanning, so show what it has and ask again shortly.
+// Rows from the older /scan fragment carry their SSID in data-ssid.
+function selectNetwork(el, ssid = el.dataset.ssid) {
+  document.getElementById('selected-ssid').textContent = ssid;
+  document.getElementById('ssid').value = ssid;
+  document.getElementById('connection-form').style.display = 'block';
+  document.querySelectorAll('.network').forEach(n => n.classList.remove('selected'));
+  el.classList.add('selected');
+}
+function renderNetworks(list, networks) {
+  list.textContent = '';
+  networks.forEach(n => {
+    const row = document.createElement('div');
+    row.className = 'network';
+    const name = document.createElement('strong');
+    name.textContent = n.ssid;
+    row.appendChild(name);
+    row.appendChild(document.createTextNode(' (' + n.rssi + ' dBm) - ' + (n.open ? 'Open' : 'Secured')));
+    row.onclick = () => selectNetwork(row, n.ssid);
+    list.appendChild(row);
+  });
+}
+function loadNetworks() {
+  const list = document.getElementById('scan-results');
+  if (!list.children.length) list.textContent = 'Scanning...';
+  fetch('/api/scan.json').then(r => r.json().then(d => {
+    if (d.networks.length || r.status === 200) renderNetworks(list, d.networks);
+    if (r.status === 202) setTimeout(loadNetworks, 1000);
+    else if (!d.networks.length) list.textContent = 'No networks found.';
+  })).catch(() => list.textContent = 'Scan failed.');
+}
+
+// Live updates: the device pushes state over Server-Sent Events on port 81.
+// Elements marked data-live='<name>' are updated in place.
+function liveSet(name, text) {
+  document.querySelectorAll("[data-live='" + name + "']").forEach(e => e.textContent = text);
+}
+if (document.querySelector('[data-live]') && window.EventSource) {
+  const events = new EventSource('//' + location.hostname + ':81/events');
+  events.addEventListener('led', e => {
+    const d = JSON.parse(e.data);
+    liveSet('led-state', d.on ? 'ON' : 'OFF');
+    liveSet('led-toggle', d.on ? 'Turn OFF' : 'Turn ON');
+    liveSet('led-brightness', d.brightness);
+    liveSet('led-color', d.r + ', ' + d.g + ', ' + d.b);
+    liveSet('led-effect', d.effect);
+  });
+  events.addEventListener('wifi', e => {
+    const d = JSON.parse(e.data);
+    if (d.state === 'connected') liveSet('wifi-status', '✅ Connected (' + d.ip + ', ' + d.rssi + ' dBm)');
+    else if (d.state === 'failed') liveSet('wifi-status', '❌ Connection failed.');
+    else if (d.state === 'connecting') liveSet('wifi-status', 'Connecting...');
+    if ((d.state === 'connected' || d.state === 'failed') && document.querySelector("[data-live='wifi-status']")) {
+      setTimeout(() => { window.location.href = '/wifi-setup'; }, 3000);
+    }
+  });
+  events.addEventListener('heap', e => liveSet('heap-free', JSON.parse(e.data).free));
+}
+
+// Forms marked data-ajax post in the background instead of reloading
+document.querySelectorAll('form[data-ajax]').forEach(form => {
+  form.addEventListener('submit', ev => {
+    ev.preventDefault();
+    const body = new URLSearchParams(new FormData(form));
+    if (ev.submitter && ev.submitter.name) body.append(ev.submitter.name, ev.submitter.value);
+    body.append('ajax', '1');
+    fetch(form.action, { method: 'POST', body: body });
+  });
+});